@@ -24,6 +24,7 @@ FileAccessController::open(int hdr)
 	++facbs[hdr].referenceNum;
 	if(facbs[hdr].rwlock == NULL) {
 		facbs[hdr].rwlock = new RWLock();
+		facbs[hdr].rangeLock = new RangeLock();
 	}
 	(void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
@@ -132,3 +133,107 @@ FileAccessController::wunlock(int hdr)
 
 	//(void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
+
+
+void
+FileAccessController::lockRange(int hdr, int first, int last, bool writing)
+{
+	ASSERT(hdr >= 0 && hdr < NumSectors);
+	facbs[hdr].rangeLock->Acquire(first, last, writing);
+}
+
+
+void
+FileAccessController::unlockRange(int hdr, int first, int last, bool writing)
+{
+	ASSERT(hdr >= 0 && hdr < NumSectors);
+	facbs[hdr].rangeLock->Release(first, last, writing);
+}
+
+
+RangeLock::RangeLock()
+{
+	held = NULL;
+	waiting = NULL;
+}
+
+RangeLock::~RangeLock()
+{
+	ASSERT(waiting == NULL);
+	while(held != NULL) {
+		SectorRange* r = held;
+		held = r->next;
+		delete r;
+	}
+}
+
+bool
+RangeLock::Conflicts(SectorRange* r, SectorRange* from, SectorRange* to)
+{
+	for(SectorRange* p = from; p != to; p = p->next) {
+		if(p->first <= r->last && r->first <= p->last
+				&& (p->writing || r->writing))
+			return true;
+	}
+	return false;
+}
+
+void
+RangeLock::Acquire(int first, int last, bool writing)
+{
+	ASSERT(first <= last);
+	SectorRange* r = new SectorRange;
+	r->first = first;
+	r->last = last;
+	r->writing = writing;
+	r->waiter = NULL;
+	r->next = NULL;
+
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	if(!Conflicts(r, held, NULL) && !Conflicts(r, waiting, NULL)) {
+		r->next = held;
+		held = r;
+	} else {
+		// queue up behind the ranges already waiting; Release moves
+		// us to the held ranges before waking us up
+		stats->numRangeLockWaits++;
+		r->waiter = currentThread;
+		SectorRange** tail = &waiting;
+		while(*tail != NULL)
+			tail = &(*tail)->next;
+		*tail = r;
+		currentThread->Sleep();
+	}
+	(void) interrupt->SetLevel(oldLevel);
+}
+
+void
+RangeLock::Release(int first, int last, bool writing)
+{
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	SectorRange** pp = &held;
+	while(*pp != NULL && !((*pp)->first == first && (*pp)->last == last
+			&& (*pp)->writing == writing))
+		pp = &(*pp)->next;
+	ASSERT(*pp != NULL);
+	SectorRange* r = *pp;
+	*pp = r->next;
+	delete r;
+
+	// hand the lock to each waiting range that now fits, in order; a
+	// range still waiting keeps the later ones overlapping it out
+	pp = &waiting;
+	while(*pp != NULL) {
+		r = *pp;
+		if(!Conflicts(r, held, NULL) && !Conflicts(r, waiting, r)) {
+			*pp = r->next;
+			r->next = held;
+			held = r;
+			scheduler->ReadyToRun(r->waiter);
+			r->waiter = NULL;
+		} else {
+			pp = &r->next;
+		}
+	}
+	(void) interrupt->SetLevel(oldLevel);
+}
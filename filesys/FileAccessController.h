@@ -1,6 +1,10 @@
 // FileAccessController.h
 //	1. synchronize readers and writers when they request to access the same file
 //  2. delete the file if and only if all reference proocesses finish
+//  3. lock byte ranges of a file, at sector granularity, so that
+//     readers and writers of disjoint parts of a file don't wait for
+//     each other; the file's RWLock is only held briefly around header
+//     updates (length, times, ExtendAllocate)
 //  TODO not implement remove the file/derectory atomically
 
 #ifndef FAC_H
@@ -13,16 +17,49 @@
 
 //#define FILESYS // TODO add to Makefile, not here
 #ifdef FILESYS
+// A locked (or wanted) interval of sectors of a file, "first" to "last"
+// inclusive, counted from the start of the file.
+struct SectorRange {
+	int first, last;
+	bool writing;		// exclusive
+	Thread* waiter;		// the thread waiting for it, if not held yet
+	SectorRange* next;
+};
+
+// Sector-range lock of one file.  Ranges that overlap conflict unless
+// both are read ranges.  A range that has to wait also keeps out later
+// ranges that overlap it, so it can't starve; it is handed over
+// (added to the held ranges) by Release.  Guarded by disabling
+// interrupts, as RWLock.
+class RangeLock {
+public:
+	RangeLock();
+	~RangeLock();
+
+	void Acquire(int first, int last, bool writing);
+	void Release(int first, int last, bool writing);
+
+private:
+	bool Conflicts(SectorRange* r, SectorRange* from, SectorRange* to);
+				// does "r" conflict with a range in [from, to)?
+	SectorRange* held;	// ranges locked now
+	SectorRange* waiting;	// ranges waited for, in arrival order
+};
+
 struct FileAccCtrlBlock {
 	int referenceNum;
-	RWLock* rwlock;
+	RWLock* rwlock;		// file header
+	RangeLock* rangeLock;	// file data
 	bool toRemove;	// set TRUE when File::Remove was called (consider derectory remove?!)
 		// check this variable when some file close (~OpenFile())
-	FileAccCtrlBlock(): referenceNum(0), rwlock(NULL), toRemove(false) {}
+	FileAccCtrlBlock(): referenceNum(0), rwlock(NULL), rangeLock(NULL),
+		toRemove(false) {}
 	~FileAccCtrlBlock()
 	{
 		if(rwlock != NULL)
 			delete rwlock;
+		if(rangeLock != NULL)
+			delete rangeLock;
 	}
 };
 
@@ -41,6 +78,8 @@ public:
 	void runlock(int hdr);
 	void wlock(int hdr);
 	void wunlock(int hdr);
+	void lockRange(int hdr, int first, int last, bool writing);
+	void unlockRange(int hdr, int first, int last, bool writing);
 private:
 	FileAccCtrlBlock facbs[NumSectors];
 };
@@ -22,6 +22,7 @@
 #include "stats.h"
 #include "directory.h"
 #include "synch.h"
+#include "pipe.h"
 
 #define TransferSize 	10 	// make it small, just to be difficult
 
@@ -133,6 +134,7 @@ enum FStestCase {
 	FSTEST_MULTI_THREADS_READWRITE,
 	FSTEST_REMOVE,
 	FSTEST_PIPE,
+	FSTEST_RANGE_WRITERS,
 };
 
 static void
@@ -394,33 +396,108 @@ void TestRemove()
 }
 
 
-void TestReadPipe(int tmp)
+// in-place updater "which" rewrites its own W_BUF_SIZE part of the file
+// a few times; an appender adds parts at the end meanwhile.  The writers
+// lock different sectors, so none of them waits for another one.
+void RangeUpdater(int which)
 {
-	//for(int i = 0; i<2; i++) {
-		printf("read from pipe:\n");
-		char data[SectorSize + 1];
-		fileSystem->ReadPipe(data);
-		int len = strlen(data);
-		printf("[TestReadPipe] len:%d\n content:%s\n", len, data);
-	//}
+	OpenFile* file = fileSystem->Open(FileName);
+	char buf[W_BUF_SIZE];
+	memset(buf, 'a' + which, W_BUF_SIZE);
+	for(int i = 0; i < 3; i++) {
+		file->Write(buf, W_BUF_SIZE, which * W_BUF_SIZE);
+		currentThread->Yield();
+	}
+	delete file;
+	writerFinish->V();
+}
+
+void RangeAppender(int parts)
+{
+	OpenFile* file = fileSystem->Open(FileName);
+	char buf[W_BUF_SIZE];
+	memset(buf, 'z', W_BUF_SIZE);
+	for(int i = 0; i < parts; i++) {
+		file->Write(buf, W_BUF_SIZE, SEEK_POS_END);
+		currentThread->Yield();
+	}
+	delete file;
+	writerFinish->V();
+}
+
+void TestRangeWriters()
+{
+	printf("TestRangeWriters\n");
+	int updaters = 2, parts = 2;
+	if (!fileSystem->Create(FileName, updaters * W_BUF_SIZE)) {
+		printf("Perf test: can't create %s\n", FileName);
+	    return;
+	}
+	int waits = stats->numRangeLockWaits;
+	writerFinish = new Semaphore("writerFinish", 0);
+	for(int i = 0; i < updaters; i++)
+		Thread::getInstance("Updater")->Fork(RangeUpdater, i);
+	Thread::getInstance("Appender")->Fork(RangeAppender, parts);
+	for(int i = 0; i < updaters + 1; i++)
+		writerFinish->P();
+	delete writerFinish;
+
+	OpenFile* file = fileSystem->Open(FileName);
+	char buf[W_BUF_SIZE];
+	bool ok = file->Length() == (updaters + parts) * W_BUF_SIZE;
+	for(int i = 0; ok && i < updaters + parts; i++) {
+		char ch = (i < updaters) ? 'a' + i : 'z';
+		file->Read(buf, W_BUF_SIZE, i * W_BUF_SIZE);
+		for(int j = 0; j < W_BUF_SIZE; j++)
+			ok = ok && buf[j] == ch;
+	}
+	delete file;
+	printf("[TestRangeWriters] %s, range lock waits %d\n",
+		ok ? "ok" : "FAIL", stats->numRangeLockWaits - waits);
 }
 
-void TestWritePipe(int tmp)
+// the writer pushes a few pipe-fulls through in odd sized pieces, the
+// reader checks that they come out in order and then sees end of file
+#define PIPE_TEST_BYTES	(3 * PipeSize + 100)
+
+void TestReadPipe(int arg)
 {
-	printf("write to pipe:\n");
-	char data[SectorSize + 1];
-	scanf("%s", data);
-	int size = strlen(data);
-	int len = fileSystem->WritePipe(data, size+1);
-	printf("[TestWritePipe] len:%d\n", len);
+	PipeBuffer* pipe = (PipeBuffer *) arg;
+	char data[SectorSize];
+	int total = 0, n;
+	bool ok = true;
+	while((n = pipe->Read(data, SectorSize)) > 0) {
+		for(int i = 0; i < n; i++)
+			ok = ok && data[i] == 'a' + (total + i) % 26;
+		total += n;
+	}
+	pipe->CloseEnd(false);
+	printf("[TestReadPipe] read %d of %d bytes, %s\n", total,
+		PIPE_TEST_BYTES, (ok && total == PIPE_TEST_BYTES) ? "ok" : "FAIL");
+}
+
+void TestWritePipe(int arg)
+{
+	PipeBuffer* pipe = (PipeBuffer *) arg;
+	char data[100];
+	int done = 0;
+	while(done < PIPE_TEST_BYTES) {
+		int n = min(100, PIPE_TEST_BYTES - done);
+		for(int i = 0; i < n; i++)
+			data[i] = 'a' + (done + i) % 26;
+		done += pipe->Write(data, n);
+	}
+	pipe->CloseEnd(true);
+	printf("[TestWritePipe] wrote %d bytes\n", done);
 }
 
 void TestPipe()
 {
+	PipeBuffer* pipe = PipeBuffer::Open(NULL);
 	Thread* rp = Thread::getInstance("read pipe");
 	Thread* wp = Thread::getInstance("write pipe");
-	wp->Fork(TestWritePipe, 0);
-	rp->Fork(TestReadPipe, 1);
+	wp->Fork(TestWritePipe, (int) pipe);
+	rp->Fork(TestReadPipe, (int) pipe);
 }
 
 void
@@ -454,6 +531,9 @@ PerformanceTest()
 	case FSTEST_PIPE:
 		TestPipe();
 		break;
+	case FSTEST_RANGE_WRITERS:
+		TestRangeWriters();
+		break;
 	}
 }
 
@@ -83,6 +83,54 @@ OpenFile::Seek(int position)
     seekPosition = position;
 }	
 
+//----------------------------------------------------------------------
+// IoVecLength, CopyToIoVec, CopyFromIoVec
+// 	Helpers to walk a scattered buffer.  "*v" and "*vOff" are the
+//	current piece and the offset in it; they are advanced past the
+//	"numBytes" bytes copied.
+//----------------------------------------------------------------------
+
+static int
+IoVecLength(IoVec *iov, int iovCount)
+{
+    int len = 0;
+    for (int v = 0; v < iovCount; v++)
+	len += iov[v].len;
+    return len;
+}
+
+static void
+CopyToIoVec(IoVec *iov, int *v, int *vOff, char *from, int numBytes)
+{
+    while (numBytes > 0) {
+	int n = min(iov[*v].len - *vOff, numBytes);
+	bcopy(from, iov[*v].base + *vOff, n);
+	from += n;
+	numBytes -= n;
+	*vOff += n;
+	if (*vOff == iov[*v].len) {
+	    (*v)++;
+	    *vOff = 0;
+	}
+    }
+}
+
+static void
+CopyFromIoVec(IoVec *iov, int *v, int *vOff, char *into, int numBytes)
+{
+    while (numBytes > 0) {
+	int n = min(iov[*v].len - *vOff, numBytes);
+	bcopy(iov[*v].base + *vOff, into, n);
+	into += n;
+	numBytes -= n;
+	*vOff += n;
+	if (*vOff == iov[*v].len) {
+	    (*v)++;
+	    *vOff = 0;
+	}
+    }
+}
+
 //----------------------------------------------------------------------
 // OpenFile::Read/Write
 // 	Read/write a portion of a file, starting from seekPosition.
@@ -98,6 +146,38 @@ OpenFile::Seek(int position)
 
 int
 OpenFile::Read(char *into, int numBytes, int position)
+{
+	IoVec iov;
+	iov.base = into;
+	iov.len = numBytes;
+	return ReadV(&iov, 1, position);
+}
+
+int
+OpenFile::Write(char *into, int numBytes, int position)
+{
+	IoVec iov;
+	iov.base = into;
+	iov.len = numBytes;
+	return WriteV(&iov, 1, position);
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadV/WriteV
+// 	Read/Write, scattered over "iov".
+//
+//	The file header is read (and, to write past the end of the file,
+//	extended) under the file's header lock, which is then dropped:
+//	the data itself is only locked from the first to the last sector
+//	the request touches, so readers and writers of other parts of the
+//	file go on in parallel.  Another short header lock writes back the
+//	access/update times.
+//
+//	"position" -- SEEK_POS_SET/CUR/END, or an offset to seek to first
+//----------------------------------------------------------------------
+
+int
+OpenFile::ReadV(IoVec *iov, int iovCount, int position)
 {
 	if(position < SEEK_POS_END)
 		return -1;
@@ -119,18 +199,30 @@ OpenFile::Read(char *into, int numBytes, int position)
 		break;
 	}
 
-	int result = ReadAt(into, numBytes, seekPosition, true);
-	seekPosition += result;
+	int start = seekPosition;
+	int numBytes = min(IoVecLength(iov, iovCount), hdr->FileLength() - start);
+	fileAccessController->runlock(hdrSector);
 
+	int result = 0;
+	if(numBytes > 0) {
+		int first = start / SectorSize;
+		int last = (start + numBytes - 1) / SectorSize;
+		fileAccessController->lockRange(hdrSector, first, last, false);
+		result = ReadAtV(iov, iovCount, start, true);
+		fileAccessController->unlockRange(hdrSector, first, last, false);
+	}
+	seekPosition = start + result;
+
+	fileAccessController->wlock(hdrSector);
+	hdr->FetchFrom(hdrSector);
 	hdr->setAccessTime();
 	hdr->WriteBack(hdrSector);
-
-	fileAccessController->runlock(hdrSector);
+	fileAccessController->wunlock(hdrSector);
 	return result;
 }
 
 int
-OpenFile::Write(char *into, int numBytes, int position)
+OpenFile::WriteV(IoVec *iov, int iovCount, int position)
 {
 	if(position < SEEK_POS_END)
 		return -1;
@@ -152,35 +244,65 @@ OpenFile::Write(char *into, int numBytes, int position)
 			break;
 	}
 
-	int result = WriteAt(into, numBytes, seekPosition, true);
-	seekPosition += result;
+	// reserve our part of the file while we hold the header: two
+	// appenders get disjoint ranges
+	int start = seekPosition;
+	int numBytes = Reserve(start, IoVecLength(iov, iovCount));
+	fileAccessController->wunlock(hdrSector);
+
+	int result = 0;
+	if(numBytes > 0) {
+		int first = start / SectorSize;
+		int last = (start + numBytes - 1) / SectorSize;
+		fileAccessController->lockRange(hdrSector, first, last, true);
+		result = WriteAtV(iov, iovCount, start, true);
+		fileAccessController->unlockRange(hdrSector, first, last, true);
+	}
+	seekPosition = start + result;
 
+	fileAccessController->wlock(hdrSector);
+	hdr->FetchFrom(hdrSector);
 	hdr->setAccessTime();
 	hdr->setUpdateTime();
 	hdr->WriteBack(hdrSector);
-
 	fileAccessController->wunlock(hdrSector);
 	return result;
 }
 
+//----------------------------------------------------------------------
+// OpenFile::Reserve
+// 	Extend the file, if need be, so that "numBytes" bytes can be
+//	written at "position".  Return how many of them fit in the file.
+//----------------------------------------------------------------------
+
+int
+OpenFile::Reserve(int position, int numBytes)
+{
+    int fileLength = hdr->FileLength();
+
+    if ((numBytes <= 0) || (position + numBytes) <= fileLength)
+    	return numBytes;
+    if (fileSystem->ExtendFile(hdrSector, position + numBytes - fileLength)) {
+    	// if extend file successfully, we should update hdr here
+    	hdr->FetchFrom(hdrSector);
+    	printf("OpenFile::WriteAt: extend file from %d to %d\n", fileLength, hdr->FileLength());
+    	fileLength = hdr->FileLength();
+    } else if (position < fileLength) {
+    	printf("OpenFile::WriteAt: extend file fail. only %d bytes can be write\n", fileLength - position);
+    } else {
+    	printf("OpenFile::WriteAt: file to write");
+    	return 0;
+    }
+    return min(numBytes, fileLength - position);
+}
+
 //----------------------------------------------------------------------
 // OpenFile::ReadAt/WriteAt
 // 	Read/write a portion of a file, starting at "position".
 //	Return the number of bytes actually written or read, but has
 //	no side effects (except that Write modifies the file, of course).
 //
-//	There is no guarantee the request starts or ends on an even disk sector
-//	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
-//
-//	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
-//	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	Implemented using ReadAtV/WriteAtV, with a single buffer.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -191,13 +313,52 @@ OpenFile::Write(char *into, int numBytes, int position)
 
 int
 OpenFile::ReadAt(char *into, int numBytes, int position, bool locked)
+{
+	IoVec iov;
+	iov.base = into;
+	iov.len = numBytes;
+	return ReadAtV(&iov, 1, position, locked);
+}
+
+int
+OpenFile::WriteAt(char *from, int numBytes, int position, bool locked)
+{
+	IoVec iov;
+	iov.base = from;
+	iov.len = numBytes;
+	return WriteAtV(&iov, 1, position, locked);
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadAtV/WriteAtV
+// 	ReadAt/WriteAt for a buffer scattered over "iovCount" pieces
+//	"iov" -- for instance a user buffer, one piece per physical page.
+//
+//	The disk only knows how to read/write a whole sector at a time.
+//	A sector that is entirely part of the request, and falls on one
+//	piece of the buffer, is transferred straight between the disk and
+//	the buffer.  Since PageSize == SectorSize, that is every sector of
+//	a page aligned user buffer.  Other sectors go through a one sector
+//	bounce buffer:
+//
+//	For ReadAtV:
+//	   We read in the sector and copy the part we are interested in.
+//	For WriteAtV:
+//	   A partially written sector is read in first, so that we don't
+//	   overwrite the unmodified portion.  We then copy in the data that
+//	   will be modified, and write the sector back.
+//----------------------------------------------------------------------
+
+int
+OpenFile::ReadAtV(IoVec *iov, int iovCount, int position, bool locked)
 {
 	//if(!locked) // outside is not locked
 	//	fileAccessController->rlock(hdrSector);
 
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int numBytes = IoVecLength(iov, iovCount);
+    int done, v = 0, vOff = 0;
+    char buf[SectorSize];
 
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
@@ -206,87 +367,86 @@ OpenFile::ReadAt(char *into, int numBytes, int position, bool locked)
     DEBUG('f', "Reading %d bytes at %d, from file of length %d.\n", 	
 		numBytes, position, fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
+    for (done = 0; done < numBytes; ) {
+	int offset = (position + done) % SectorSize;
+	int chunk = min(SectorSize - offset, numBytes - done);
+	int sector = hdr->ByteToSector(position + done);
 
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	{
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+	while (vOff == iov[v].len) {	// skip empty pieces
+	    v++;
+	    vOff = 0;
+	}
+	if (chunk == SectorSize && iov[v].len - vOff >= SectorSize) {
+	    // a whole sector: read it in place
+	    synchDisk->ReadSector(sector, iov[v].base + vOff);
+	    vOff += SectorSize;
+	} else {
+	    // copy the part we want
+	    synchDisk->ReadSector(sector, buf);
+	    CopyToIoVec(iov, &v, &vOff, &buf[offset], chunk);
+	}
+	done += chunk;
 #ifdef FSTEST_MULTI_THREADS_READ_WRITE
     if(locked)
         currentThread->Yield();
 #endif
     }
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
 
     //if(!locked) // outside is not locked
     //	fileAccessController->runlock(hdrSector);
 
-    delete [] buf;
     return numBytes;
 }
 
 int
-OpenFile::WriteAt(char *from, int numBytes, int position, bool locked)
+OpenFile::WriteAtV(IoVec *iov, int iovCount, int position, bool locked)
 {
 	//if(!locked) // outside is not locked
 	//	fileAccessController->wlock(hdrSector);
 
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
-
-    if ((numBytes <= 0)) {// || (position >= fileLength))
-    	//fileAccessController->wunlock(hdrSector);
+    int numBytes = IoVecLength(iov, iovCount);
+    int done, v = 0, vOff = 0;
+    char buf[SectorSize];
+
+    if (locked)		// WriteV has reserved our part of the file
+    	numBytes = min(numBytes, fileLength - position);
+    else
+    	numBytes = Reserve(position, numBytes);
+    if (numBytes <= 0)
     	return 0;				// check request
-    }
-    if ((position + numBytes) > fileLength) {
-    	if(fileSystem->ExtendFile(hdrSector, position + numBytes - fileLength)) {
-    		// if extend file successfully, we should update hdr here
-    		hdr->FetchFrom(hdrSector);
-    		printf("OpenFile::WriteAt: extend file from %d to %d\n", fileLength, hdr->FileLength());
-    		fileLength = hdr->FileLength();
-    	} else if (position < fileLength) {
-    		numBytes = fileLength - position;
-    		printf("OpenFile::WriteAt: extend file fail. only %d bytes can be write\n", numBytes);
-    	} else {
-    		printf("OpenFile::WriteAt: file to write");
-    		//fileAccessController->wunlock(hdrSector);
-    		return 0;
-    	}
-    }
+    fileLength = hdr->FileLength();
+#ifdef USER_PROGRAM
+    // pages of the file cached as an executable no longer match it
+    if (memManager != NULL)
+    	memManager->ForgetExecFile(hdrSector);
+#endif
 
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
 			numBytes, position, fileLength);
 
-    firstSector = divRoundDown(position, SectorSize);
-    lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    buf = new char[numSectors * SectorSize];
+    for (done = 0; done < numBytes; ) {
+	int offset = (position + done) % SectorSize;
+	int chunk = min(SectorSize - offset, numBytes - done);
+	int sector = hdr->ByteToSector(position + done);
 
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
-
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
-
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
-
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	{
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+	while (vOff == iov[v].len) {	// skip empty pieces
+	    v++;
+	    vOff = 0;
+	}
+	if (chunk == SectorSize && iov[v].len - vOff >= SectorSize) {
+	    // a whole sector: write it from where it is
+	    synchDisk->WriteSector(sector, iov[v].base + vOff);
+	    vOff += SectorSize;
+	} else {
+	    // read in the sector if it is only partially modified, copy
+	    // in the bytes we want to change, and write it back
+	    if (chunk < SectorSize)
+		synchDisk->ReadSector(sector, buf);
+	    CopyFromIoVec(iov, &v, &vOff, &buf[offset], chunk);
+	    synchDisk->WriteSector(sector, buf);
+	}
+	done += chunk;
 #ifdef FSTEST_MULTI_THREADS_READ_WRITE
     if(locked)
         currentThread->Yield();
@@ -296,7 +456,6 @@ OpenFile::WriteAt(char *from, int numBytes, int position, bool locked)
     //if(!locked) // outside is not locked
     //	fileAccessController->wunlock(hdrSector);
 
-    delete [] buf;
     return numBytes;
 }
 
@@ -70,6 +70,13 @@ class OpenFile {
 #else // FILESYS
 class FileHeader;
 
+// One piece of a scattered buffer, e.g. the part of a user buffer that
+// lies in one physical page.  Used by ReadV/WriteV and ReadAtV/WriteAtV.
+struct IoVec {
+    char *base;
+    int len;
+};
+
 class OpenFile {
   public:
     OpenFile(int sector, int parSector = -1);		// Open a file whose header is located
@@ -90,17 +97,31 @@ class OpenFile {
 					// bypassing the implicit position.
     int WriteAt(char *from, int numBytes, int position, bool locked = false);
 
+    int ReadV(IoVec *iov, int iovCount, int position = SEEK_POS_CUR);
+    int WriteV(IoVec *iov, int iovCount, int position = SEEK_POS_CUR);
+    					// Read/Write, scattered over "iov"
+    int ReadAtV(IoVec *iov, int iovCount, int position, bool locked = false);
+    int WriteAtV(IoVec *iov, int iovCount, int position, bool locked = false);
+    					// ReadAt/WriteAt, scattered over "iov";
+					// whole sectors go straight between
+					// the disk and the buffer
+
     int Length(); 			// Return the number of bytes in the
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
     OpenFile* GetFileDescriptorCopy();
+    int GetHdrSector() { return hdrSector; }	// identifies the file, e.g.
+    					// for the executable page cache
     
   private:
     FileHeader *hdr;			// Header for this file 
     int seekPosition;			// Current position within the file
     int hdrSector;				// the location on disk of the file header for this file
     int parHdrSector;			// parent Dir file header TODO
+
+    int Reserve(int position, int numBytes);	// extend the file so that
+    					// numBytes fit at position
 };
 
 #endif // FILESYS
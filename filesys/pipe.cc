@@ -0,0 +1,153 @@
+// pipe.cc
+//	In-memory pipes, see pipe.h.
+
+#include "copyright.h"
+#include "pipe.h"
+#include "system.h"
+#include "synch.h"
+
+static List *namedPipes = NULL;		// pipes that have a name
+
+static int
+PipeNameComp(void *target, void *data)
+{
+    return strcmp(((PipeBuffer *) target)->GetName(), (char *) data) == 0;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Open
+// 	Return the pipe called "name", or a new pipe, with one more read
+//	and one more write end.  The lookup and the new ends are atomic,
+//	so a pipe whose last end is being closed can't be found again.
+//----------------------------------------------------------------------
+
+PipeBuffer *
+PipeBuffer::Open(char *name)
+{
+    PipeBuffer *pipe = NULL;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    if (name != NULL) {
+	if (namedPipes == NULL)
+	    namedPipes = new List;
+	pipe = (PipeBuffer *) namedPipes->RemoveByComp(PipeNameComp, name);
+	if (pipe == NULL)
+	    pipe = new PipeBuffer(name);
+	namedPipes->Append((void *) pipe);
+    } else {
+	pipe = new PipeBuffer(NULL);
+    }
+    pipe->readers++;
+    pipe->writers++;
+    (void) interrupt->SetLevel(oldLevel);
+    return pipe;
+}
+
+PipeBuffer::PipeBuffer(char *pipeName)
+{
+    name = NULL;
+    if (pipeName != NULL) {
+	name = new char[strlen(pipeName) + 1];
+	strcpy(name, pipeName);
+    }
+    head = count = 0;
+    readers = writers = 0;
+    lock = new Lock("pipe");
+    notEmpty = new Condition("pipe not empty");
+    notFull = new Condition("pipe not full");
+}
+
+PipeBuffer::~PipeBuffer()
+{
+    delete [] name;
+    delete lock;
+    delete notEmpty;
+    delete notFull;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Read
+// 	Wait until the pipe has data, or has no writers left, and read
+//	up to "numBytes" bytes of it into "into".
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Read(char *into, int numBytes)
+{
+    int n;
+
+    lock->Acquire();
+    while (count == 0 && writers > 0)
+	notEmpty->Wait(lock);
+    n = min(numBytes, count);
+    for (int i = 0; i < n; i++)
+	into[i] = buffer[(head + i) % PipeSize];
+    head = (head + n) % PipeSize;
+    count -= n;
+    stats->numPipeBytes += n;
+    if (n > 0)
+	notFull->Broadcast(lock);
+    lock->Release();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Write
+// 	Write "numBytes" bytes from "from", as much as fits at a time,
+//	waiting for a reader to make room for the rest.  Stop if there
+//	are no readers left.
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Write(char *from, int numBytes)
+{
+    int done = 0;
+
+    lock->Acquire();
+    while (done < numBytes) {
+	while (count == PipeSize && readers > 0) {
+	    stats->numPipeWaits++;
+	    notFull->Wait(lock);
+	}
+	if (readers == 0)
+	    break;
+	int n = min(numBytes - done, PipeSize - count);
+	for (int i = 0; i < n; i++)
+	    buffer[(head + count + i) % PipeSize] = from[done + i];
+	count += n;
+	done += n;
+	notEmpty->Broadcast(lock);
+    }
+    lock->Release();
+    if (done == 0 && numBytes > 0)
+	return -1;			// broken pipe
+    return done;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::CloseEnd
+// 	Closing an end wakes up the other side, which may now see end of
+//	file (or a broken pipe); closing the last one deletes the pipe.
+//----------------------------------------------------------------------
+
+void
+PipeBuffer::CloseEnd(bool writing)
+{
+    bool last;
+
+    lock->Acquire();
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    if (writing)
+	writers--;
+    else
+	readers--;
+    last = (readers == 0 && writers == 0);
+    if (last && name != NULL)
+	namedPipes->RemoveByComp(PipeNameComp, name);
+    (void) interrupt->SetLevel(oldLevel);
+    notEmpty->Broadcast(lock);
+    notFull->Broadcast(lock);
+    lock->Release();
+    if (last)
+	delete this;
+}
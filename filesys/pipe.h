@@ -0,0 +1,57 @@
+// pipe.h
+//	Pipes, the kernel side of the Pipe system call: bounded ring
+//	buffers in memory, one way from the threads writing to the threads
+//	reading.  A reader waits while the pipe is empty, a writer while it
+//	is full, so the two sides go at the speed of the slower one without
+//	ever touching the disk.
+//
+//	A pipe has a number of read and write ends (e.g. descriptors in
+//	a FdTable, shared by Fork and Exec).  Once every write end is
+//	closed, reading the empty pipe returns 0, end of file; once every
+//	read end is closed, writing fails.  The pipe goes away with its
+//	last end.
+//
+//	A pipe may have a name, so that unrelated processes can open the
+//	same one; anonymous pipes are only shared by inheritance.
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "copyright.h"
+
+#define PipeSize	512	// bytes buffered in a pipe
+
+class Lock;
+class Condition;
+
+class PipeBuffer {
+  public:
+    static PipeBuffer *Open(char *name);
+					// the pipe called "name", made if
+					// need be; a new anonymous pipe if
+					// "name" is NULL.  The caller gets
+					// one read and one write end.
+
+    int Read(char *into, int numBytes);	// wait for data, return the
+					// bytes read, 0 at end of file
+    int Write(char *from, int numBytes);// write it all, waiting for room;
+					// return the bytes written, -1 if
+					// there are no readers
+    void CloseEnd(bool writing);	// one read/write end less; may
+					// delete the pipe
+    char *GetName() { return name; }
+
+  private:
+    PipeBuffer(char *pipeName);
+    ~PipeBuffer();
+
+    char *name;				// NULL if anonymous
+    char buffer[PipeSize];
+    int head;				// first byte to read
+    int count;				// bytes in the buffer
+    int readers, writers;		// open ends
+    Lock *lock;
+    Condition *notEmpty, *notFull;
+};
+
+#endif // PIPE_H
@@ -4,8 +4,10 @@
 //	These are each simulated by operations on UNIX files.
 //	The simulated device is asynchronous,
 //	so we have to invoke the interrupt handler (after a simulated
-//	delay), to signal that a byte has arrived and/or that a written
-//	byte has departed.
+//	delay), to signal that bytes have arrived and/or that written
+//	bytes have departed.
+//
+//	Also the console driver, SynchConsole.
 //
 //  DO NOT CHANGE -- part of the machine emulation
 //
@@ -53,10 +55,9 @@ Console::Console(char *readFile, char *writeFile, VoidFunctionPtr readAvail,
     readHandler = readAvail;
     handlerArg = callArg;
     putBusy = FALSE;
-    incoming = EOF;
-
-    // start polling for incoming packets
-    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, ConsoleReadInt);
+    inHead = inCount = 0;
+    polling = atEOF = FALSE;
+    // the keyboard is polled once someone wants input, see WantInput
 }
 
 //----------------------------------------------------------------------
@@ -72,34 +73,55 @@ Console::~Console()
 	Close(writeFileNo);
 }
 
+//----------------------------------------------------------------------
+// Console::WantInput()
+// 	Start polling the simulated keyboard, if we aren't already.
+//	The poll goes on until there is input, or the input has ended;
+//	after that, it is just one read interrupt.
+//----------------------------------------------------------------------
+
+void
+Console::WantInput()
+{
+    if (polling)
+	return;
+    polling = TRUE;
+    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime,
+			ConsoleReadInt);
+}
+
 //----------------------------------------------------------------------
 // Console::CheckCharAvail()
-// 	Periodically called to check if a character is available for
-//	input from the simulated keyboard (eg, has it been typed?).
+// 	Called to check if characters are available for input from the
+//	simulated keyboard (eg, have they been typed?).
 //
-//	Only read it in if there is buffer space for it (if the previous
-//	character has been grabbed out of the buffer by the Nachos kernel).
-//	Invoke the "read" interrupt handler, once the character has been 
-//	put into the buffer. 
+//	Only read them in if the buffer is empty (if the previous
+//	characters have all been grabbed out of the buffer by the Nachos
+//	kernel), and then read all that fit.  Invoke the "read" interrupt
+//	handler, once the characters have been put into the buffer, or
+//	the input turned out to have ended; if there were none, poll
+//	again later.
 //----------------------------------------------------------------------
 
 void
 Console::CheckCharAvail()
 {
-    char c;
+    polling = FALSE;
 
-    // schedule the next time to poll for a packet
-    interrupt->Schedule(ConsoleReadPoll, (int)this, ConsoleTime, 
-			ConsoleReadInt);
-
-    // do nothing if character is already buffered, or none to be read
-    if ((incoming != EOF) || !PollFile(readFileNo))
-    	return;
-
-    // otherwise, read character and tell user about it
-    Read(readFileNo, &c, sizeof(char));
-    incoming = c ;
-    stats->numConsoleCharsRead++;
+    if (inCount == 0 && !atEOF && PollFile(readFileNo)) {
+	int n = ReadPartial(readFileNo, incoming, ConsoleFifoSize);
+	if (n > 0) {
+	    inHead = 0;
+	    inCount = n;
+	    stats->numConsoleCharsRead += n;
+	} else {
+	    atEOF = TRUE;	// readable, but nothing left
+	}
+    }
+    if (inCount == 0 && !atEOF) {
+	WantInput();		// nothing yet, poll again
+	return;
+    }
     (*readHandler)(handlerArg);	
 }
 
@@ -114,7 +136,7 @@ void
 Console::WriteDone()
 {
     putBusy = FALSE;
-    stats->numConsoleCharsWritten++;
+    stats->numConsoleWriteInts++;
     (*writeHandler)(handlerArg);
 }
 
@@ -127,66 +149,214 @@ Console::WriteDone()
 char
 Console::GetChar()
 {
-   char ch = incoming;
-
-   incoming = EOF;
-   return ch;
+   if (inCount == 0)
+	return EOF;
+   inCount--;
+   return incoming[inHead++];
 }
 
 //----------------------------------------------------------------------
-// Console::PutChar()
-// 	Write a character to the simulated display, schedule an interrupt 
-//	to occur in the future, and return.
+// Console::PutChar()/PutBuffer()
+// 	Write characters to the simulated display, schedule an interrupt 
+//	to occur in the future, and return.  The FIFO takes up to
+//	ConsoleFifoSize characters per interrupt.
 //----------------------------------------------------------------------
 
 void
 Console::PutChar(char ch)
+{
+    PutBuffer(&ch, 1);
+}
+
+void
+Console::PutBuffer(char *buf, int len)
 {
     ASSERT(putBusy == FALSE);
-    WriteFile(writeFileNo, &ch, sizeof(char));
+    ASSERT(len > 0 && len <= ConsoleFifoSize);
+    WriteFile(writeFileNo, buf, len);
+    stats->numConsoleCharsWritten += len;
     putBusy = TRUE;
     interrupt->Schedule(ConsoleWriteDone, (int)this, ConsoleTime,
 					ConsoleWriteInt);
 }
 
+// Dummy functions for the SynchConsole interrupt handlers
+static void SynchConsoleReadAvail(int c)
+{ SynchConsole *console = (SynchConsole *)c; console->ReadAvail(); }
+static void SynchConsoleWriteDone(int c)
+{ SynchConsole *console = (SynchConsole *)c; console->WriteDone(); }
 
-static Semaphore *readAvail;
-static Semaphore *writeDone;
-static void ReadAvail(int arg) { readAvail->V(); }
-static void WriteDone(int arg) { writeDone->V(); }
+//----------------------------------------------------------------------
+// SynchConsole::SynchConsole
+// 	Initialize the console driver, and the device under it.
+//
+//	"readFile", "writeFile" -- as for Console, NULL for stdin/stdout
+//----------------------------------------------------------------------
 
 SynchConsole::SynchConsole(char *readFile, char *writeFile)
 {
-    console = new Console(readFile, writeFile, ReadAvail, WriteDone, 0);
+    console = new Console(readFile, writeFile, SynchConsoleReadAvail,
+			SynchConsoleWriteDone, (int)this);
     readLock = new Lock("read lock");
     writeLock = new Lock("write lock");
+    lineAvail = new Semaphore("line avail", 0);
+    roomAvail = new Semaphore("room avail", 0);
+    readerWaiting = writerWaiting = FALSE;
+    outHead = outCount = outBusy = 0;
+    inHead = inCount = inLines = 0;
 }
 
 SynchConsole::~SynchConsole()
 {
 	delete console;
-	delete readAvail;
-	delete writeDone;
+	delete lineAvail;
+	delete roomAvail;
 	delete readLock;
 	delete writeLock;
 }
 
+//----------------------------------------------------------------------
+// SynchConsole::Write
+// 	Copy "numBytes" bytes into the output buffer, waiting only when
+//	it is full, and get the device going if it is idle.  The device
+//	takes them a FIFO-full per interrupt.
+//----------------------------------------------------------------------
+
+int
+SynchConsole::Write(char *from, int numBytes)
+{
+    int done = 0;
+
+    writeLock->Acquire();
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    while (done < numBytes) {
+	int n = min(numBytes - done, ConsoleBufferSize - outCount);
+	if (n == 0) {
+	    writerWaiting = TRUE;	// WriteDone wakes us up
+	    roomAvail->P();
+	    continue;
+	}
+	for (int i = 0; i < n; i++)
+	    outBuf[(outHead + outCount + i) % ConsoleBufferSize] = from[done + i];
+	outCount += n;
+	done += n;
+	if (outBusy == 0)
+	    StartOutput();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    writeLock->Release();
+    return done;
+}
+
+// Hand the device the next run of queued characters; interrupts are off
+void
+SynchConsole::StartOutput()
+{
+    outBusy = min(min(outCount, ConsoleBufferSize - outHead), ConsoleFifoSize);
+    if (outBusy > 0)
+	console->PutBuffer(&outBuf[outHead], outBusy);
+}
+
+void
+SynchConsole::WriteDone()
+{
+    outHead = (outHead + outBusy) % ConsoleBufferSize;
+    outCount -= outBusy;
+    StartOutput();
+    if (writerWaiting) {
+	writerWaiting = FALSE;
+	roomAvail->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Flush
+// 	Wait until everything written so far is on the display.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Flush()
+{
+    writeLock->Acquire();
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    while (outCount > 0) {
+	writerWaiting = TRUE;
+	roomAvail->P();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    writeLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Read
+// 	Wait for a complete line (or a full input buffer), and return up
+//	to "numBytes" bytes of it, the '\n' included.  The rest of the
+//	line is left for the next Read.  Once the input has ended, return
+//	what is left of it, without a '\n', and then 0.
+//----------------------------------------------------------------------
+
+int
+SynchConsole::Read(char *into, int numBytes)
+{
+    int n = 0;
+
+    readLock->Acquire();
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    while (inLines == 0 && inCount < ConsoleBufferSize
+	    && !console->AtEOF()) {
+	readerWaiting = TRUE;		// ReadAvail wakes us up
+	console->WantInput();
+	lineAvail->P();
+    }
+    while (n < numBytes && inCount > 0) {
+	char ch = inBuf[inHead];
+	inHead = (inHead + 1) % ConsoleBufferSize;
+	inCount--;
+	into[n++] = ch;
+	if (ch == '\n') {
+	    inLines--;
+	    break;
+	}
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    readLock->Release();
+    return n;
+}
+
+// Move what the device read in to the line buffer; wake up the reader
+// once there is a line or the input has ended, else keep the keyboard
+// polled for it
+void
+SynchConsole::ReadAvail()
+{
+    char ch;
+
+    while (inCount < ConsoleBufferSize && (ch = console->GetChar()) != EOF) {
+	inBuf[(inHead + inCount) % ConsoleBufferSize] = ch;
+	inCount++;
+	if (ch == '\n')
+	    inLines++;
+    }
+    if (!readerWaiting)
+	return;
+    if (inLines > 0 || inCount == ConsoleBufferSize || console->AtEOF()) {
+	readerWaiting = FALSE;
+	lineAvail->V();
+    } else {
+	console->WantInput();
+    }
+}
+
 void
 SynchConsole::PutChar(char ch)
 {
-	writeLock->Acquire();
-	console->PutChar(ch);
-	writeDone->P();
-	writeLock->Release();
+	Write(&ch, 1);
 }
 
 char
 SynchConsole::GetChar()
 {
 	char ch;
-	readLock->Acquire();
-	readAvail->P();
-	ch = console->GetChar();
-	readLock->Release();
+	Read(&ch, 1);
 	return ch;
 }
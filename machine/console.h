@@ -32,9 +32,17 @@
 // and writing to UNIX files ("readFile" and "writeFile").
 //
 // Since the device is asynchronous, the interrupt handler "readAvail" 
-// is called when a character has arrived, ready to be read in.
-// The interrupt handler "writeDone" is called when an output character 
-// has been "put", so that the next character can be written.
+// is called when characters have arrived, ready to be read in.
+// The interrupt handler "writeDone" is called when the characters
+// "put" have been output, so that the next ones can be written.
+//
+// The device has a FIFO each way: a write interrupt completes up to
+// ConsoleFifoSize characters, and a read interrupt brings in as many
+// as the keyboard had, up to ConsoleFifoSize.  The keyboard is only
+// polled while someone asked for input (WantInput) and none came yet;
+// once the input has ended, it is not polled any more.
+
+#define ConsoleFifoSize	64	// characters per read/write interrupt
 
 class Console {
   public:
@@ -47,11 +55,20 @@ class Console {
     void PutChar(char ch);	// Write "ch" to the console display, 
 				// and return immediately.  "writeHandler" 
 				// is called when the I/O completes. 
+    void PutBuffer(char *buf, int len);
+    				// Same for "len" (at most ConsoleFifoSize)
+				// characters, with one interrupt
 
     char GetChar();	   	// Poll the console input.  If a char is 
 				// available, return it.  Otherwise, return EOF.
-    				// "readHandler" is called whenever there is 
-				// a char to be gotten
+    				// "readHandler" is called whenever there 
+				// are chars to be gotten
+    void WantInput();		// Poll the keyboard until there is
+				// input, or it ends, then call
+				// "readHandler"
+    bool AtEOF() { return atEOF && inCount == 0; }
+				// the input has ended, and all of it
+				// was gotten
 
 // internal emulation routines -- DO NOT call these. 
     void WriteDone();	 	// internal routines to signal I/O completion
@@ -68,11 +85,20 @@ class Console {
 					// interrupt handlers
     bool putBusy;    			// Is a PutChar operation in progress?
 					// If so, you can't do another one!
-    char incoming;    			// Contains the character to be read,
-					// if there is one available. 
-					// Otherwise contains EOF.
+    char incoming[ConsoleFifoSize];	// Characters read in and not
+    int inHead, inCount;		// gotten yet
+    bool polling;			// a CheckCharAvail is scheduled
+    bool atEOF;				// the keyboard file has ended
 };
 
+// The console driver.  Output is queued in a ring buffer and handed to
+// the device as a whole FIFO at a time, so a writer only waits when the
+// buffer is full.  Input is line buffered: a Read waits for a whole
+// line (or a full buffer), the way a terminal in cooked mode does.
+// Once the input has ended, a Read gets the last, unterminated line,
+// and then 0.
+
+#define ConsoleBufferSize	512	// characters buffered each way
 
 class SynchConsole
 {
@@ -82,10 +108,30 @@ class SynchConsole
     ~SynchConsole();			// clean up console emulation
     void PutChar(char ch);
     char GetChar();
+    int Write(char *from, int numBytes);	// queue it for the display
+    int Read(char *into, int numBytes);	// the next line, at most
+    					// "numBytes" of it
+    void Flush();			// wait until all is displayed
+
+    void ReadAvail();			// interrupt handlers
+    void WriteDone();
+
   private:
+    void StartOutput();			// next FIFO-full to the device
+
     Console* console;
     Lock* readLock;
     Lock* writeLock;
+    Semaphore* lineAvail;		// for a reader waiting for a line
+    Semaphore* roomAvail;		// for a writer waiting for room
+    bool readerWaiting, writerWaiting;
+
+    char outBuf[ConsoleBufferSize];
+    int outHead, outCount;		// queued, including ...
+    int outBusy;			// ... these, being output
+    char inBuf[ConsoleBufferSize];
+    int inHead, inCount;
+    int inLines;			// complete lines in inBuf
 };
 
 #endif // CONSOLE_H
@@ -160,6 +160,8 @@ Interrupt::OneTick()
     } else {					// USER_PROGRAM
 	stats->totalTicks += UserTick;
 	stats->userTicks += UserTick;
+	if (stats->numAioInFlight > 0)	// the disk works for us meanwhile
+	    stats->aioOverlapTicks += UserTick;
     }
     DEBUG('i', "\n== Tick %d ==\n", stats->totalTicks);
 
@@ -10,6 +10,10 @@
 #include "copyright.h"
 #include "machine.h"
 #include "system.h"
+#ifdef NETWORK
+#include "dsm.h"
+#include "migrate.h"
+#endif
 
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging.
@@ -50,14 +54,21 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"tlbEntries" -- number of TLB entries
+//	"tlbAssoc" -- entries per TLB set, 0 for a fully associative TLB
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug, TLBSwapPolicy tlbPolicy, bool lazyLoadStrategy)
+Machine::Machine(bool debug, TLBSwapPolicy tlbPolicy, bool lazyLoadStrategy,
+		bool eagerSwitchStrategy, int tlbEntries, int tlbAssoc)
 {
     int i;
     tlbSwapPolicy = tlbPolicy;
     lazyLoad = lazyLoadStrategy;
-    nextFramePoint = 0;
+    eagerSwitch = eagerSwitchStrategy;
+    currentASID = -1;
+    currentSpace = NULL;
+    nextFramePoint = NULL;
+    userRegOwner = NULL;
 
     for (i = 0; i < NumTotalRegs; i++)
         registers[i] = 0;
@@ -65,17 +76,30 @@ Machine::Machine(bool debug, TLBSwapPolicy tlbPolicy, bool lazyLoadStrategy)
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
 #ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
+    ASSERT(tlbEntries > 0 && tlbAssoc >= 0);
+    tlbSize = tlbEntries;
+    tlbWays = (tlbAssoc == 0 || tlbAssoc > tlbEntries) ? tlbEntries : tlbAssoc;
+    ASSERT(tlbSize % tlbWays == 0);
+    tlbSets = tlbSize / tlbWays;
+    nextFramePoint = new int[tlbSets];
+    for (i = 0; i < tlbSets; i++)
+	nextFramePoint[i] = 0;
+    tlb = new TranslationEntry[tlbSize];
+    for (i = 0; i < tlbSize; i++) {
 	tlb[i].valid = FALSE;
-    tlb[i].lastUseTime = 0;
-    tlb[i].firstUseTime = 0;
-    tlb[i].clockUse = 0;
-    tlb[i].use = FALSE;
-    tlb[i].dirty = FALSE;
+	tlb[i].lastUseTime = 0;
+	tlb[i].firstUseTime = 0;
+	tlb[i].clockUse = 0;
+	tlb[i].use = FALSE;
+	tlb[i].dirty = FALSE;
+	tlb[i].readOnly = FALSE;
+	tlb[i].copyOnWrite = FALSE;
+	tlb[i].asid = -1;
+    }
     pageTable = NULL;
 #else	// use linear page table
     tlb = NULL;
+    tlbSize = tlbWays = tlbSets = 0;
     pageTable = NULL;
 #endif
 
@@ -93,6 +117,7 @@ Machine::~Machine()
     delete [] mainMemory;
     if (tlb != NULL)
         delete [] tlb;
+    delete [] nextFramePoint;
 }
 
 //----------------------------------------------------------------------
@@ -235,22 +260,116 @@ Machine::InvalidTLB()
 	if(tlb == NULL)
 		return;
 	int i;
-	TranslationEntry* e = NULL;
-	for(i = 0; i<TLBSize; i++)
+	for(i = 0; i<tlbSize; i++)
 	{
 		if(tlb[i].valid) {
-			e = &tlb[i];
-			pageTable[e->virtualPage] = *e;
+			WriteBackTLBEntry(&tlb[i]);
+			tlb[i].valid = FALSE;
+			++stats->numTLBFlushed;
+		}
+	}
+}
+
+/*
+ * Function:	drop every TLB entry tagged with "asid", without writing
+ * 				them back. Called when the address space goes away, so
+ * 				that a later owner of the same asid can't hit stale entries
+ * */
+void
+Machine::FlushTLB(int asid)
+{
+	if(tlb == NULL)
+		return;
+	for(int i = 0; i<tlbSize; i++)
+	{
+		if(tlb[i].valid && tlb[i].asid == asid) {
+			tlb[i].valid = FALSE;
+			++stats->numTLBFlushed;
+		}
+	}
+}
+
+/*
+ * Function:	push use/dirty bits of all valid TLB entries back into the
+ * 				page tables they were loaded from. Entries stay valid.
+ * */
+void
+Machine::SyncTLB()
+{
+	if(tlb == NULL)
+		return;
+	for(int i = 0; i<tlbSize; i++)
+	{
+		if(tlb[i].valid)
+			WriteBackTLBEntry(&tlb[i]);
+	}
+}
+
+/*
+ * Function:	write back and invalidate the TLB item mapping page "vpn"
+ * 				of address space "asid", if there is one. Used when the
+ * 				PTE behind it changes, e.g. a copy-on-write page gets
+ * 				its private frame.
+ * */
+void
+Machine::FlushTLBPage(int asid, int vpn)
+{
+	if(tlb == NULL)
+		return;
+	for(int i = 0; i<tlbSize; i++)
+	{
+		if(tlb[i].valid && tlb[i].asid == asid && tlb[i].virtualPage == vpn) {
+			WriteBackTLBEntry(&tlb[i]);
 			tlb[i].valid = FALSE;
+			++stats->numTLBFlushed;
 		}
 	}
 }
 
+/*
+ * Function:	copy the bits maintained by the TLB (use, dirty and the
+ * 				swap policy fields) into the owner's page table entry.
+ * 				The owner is found by asid, which is the thread id of
+ * 				the address space, so this works for entries that were
+ * 				loaded before the last context switch.
+ * */
+void
+Machine::WriteBackTLBEntry(TranslationEntry* entry)
+{
+	TranslationEntry *pte = NULL;
+	if(entry->asid == currentASID) {
+		pte = pageTable->Lookup(entry->virtualPage);
+	} else if(entry->asid >= 0 && entry->asid < MAX_THREADS_NUM
+			&& tid_pointer[entry->asid] != NULL
+			&& tid_pointer[entry->asid]->space != NULL) {
+		pte = tid_pointer[entry->asid]->space->GetPTE(entry->virtualPage);
+	}
+	if(pte == NULL)
+		return;
+	pte->use = entry->use;
+	pte->dirty = entry->dirty;
+	pte->lastUseTime = entry->lastUseTime;
+	pte->firstUseTime = entry->firstUseTime;
+	pte->clockUse = entry->clockUse;
+}
+
+
+/*
+ * Function:	return the TLB set a virtual page of the running address
+ * 				space maps to. The asid is mixed in, so that the same
+ * 				page of different processes does not fight for one set.
+ * 				Set "s" holds entries [s*tlbWays, (s+1)*tlbWays).
+ * */
+int
+Machine::TLBSet(int vpn)
+{
+	return ((unsigned) vpn ^ (unsigned) currentASID) % tlbSets;
+}
 
 void
 Machine::UpdateTLB(int idx)
 {
-	if(idx < 0 || idx > TLBSize)
+	if(idx < 0 || idx >= tlbSize)
 	{
 		printf("UpdateTLB: idx err\n");
 		return;
@@ -295,12 +414,13 @@ Machine::LRUSwap(int addr)
 	DEBUG('p',"TLB MISS,use LRU swap\n");
 	int idx = 0;
 	int vpn = addr/PageSize;
-	int offset = addr/PageSize;
-	TranslationEntry *entry = &tlb[0];
-	int min = tlb[0].lastUseTime;
+	int base = TLBSet(vpn) * tlbWays;
+	TranslationEntry *entry = &tlb[base];
+	int min = tlb[base].lastUseTime;
 	bool emptyTLB = false;
 
-	for(int i = 0; i<TLBSize; i++)
+	idx = base;
+	for(int i = base; i<base + tlbWays; i++)
 	{
 		if(!tlb[i].valid)
 		{
@@ -316,17 +436,14 @@ Machine::LRUSwap(int addr)
 		}
 	}
 
+	TRACE(TraceTLBRefill, idx, vpn, emptyTLB ? -1 : tlb[idx].virtualPage);
 	tlb[idx].valid = TRUE;
-	// test
-	//printf("B: TLB[%d] v:%d vpn:%d ppn:%d u:%d d:%d LRU:%d \n",
-	//		idx, tlb[idx].valid, tlb[idx].virtualPage, tlb[idx].physicalPage, tlb[idx].use, tlb[idx].dirty, tlb[idx].lastUseTime);
 	// update TLB
 	if(!emptyTLB)
-		pageTable[entry->virtualPage] = *entry;
-	*entry = pageTable[vpn];
+		WriteBackTLBEntry(entry);
+	*entry = *pageTable->Lookup(vpn);
+	entry->asid = currentASID;
 	entry->lastUseTime = stats->totalTicks;
-	//printf("A: TLB[%d] v:%d vpn:%d ppn:%d u:%d d:%d LRU:%d\n",
-	//			idx, tlb[idx].valid, tlb[idx].virtualPage, tlb[idx].physicalPage, tlb[idx].use, tlb[idx].dirty, tlb[idx].lastUseTime);
 
 	return idx;
 }
@@ -338,12 +455,13 @@ Machine::FIFOSwap(int addr)
 	DEBUG('p',"TLB MISS,use FIFO swap\n");
 	int idx = 0;
 	int vpn = addr/PageSize;
-	int offset = addr/PageSize;
-	TranslationEntry *entry = &tlb[0];
-	int min = tlb[0].firstUseTime;
+	int base = TLBSet(vpn) * tlbWays;
+	TranslationEntry *entry = &tlb[base];
+	int min = tlb[base].firstUseTime;
 	bool emptyTLB = false;
 
-	for(int i = 0; i<TLBSize; i++)
+	idx = base;
+	for(int i = base; i<base + tlbWays; i++)
 	{
 		if(!tlb[i].valid)
 		{
@@ -359,16 +477,13 @@ Machine::FIFOSwap(int addr)
 		}
 	}
 
-	// test
-	printf("B: TLB[%d] v:%d vpn:%d ppn:%d u:%d d:%d firstUseTime:%d \n",
-		idx, tlb[idx].valid, tlb[idx].virtualPage, tlb[idx].physicalPage, tlb[idx].use, tlb[idx].dirty, tlb[idx].firstUseTime);
+	TRACE(TraceTLBRefill, idx, vpn, emptyTLB ? -1 : tlb[idx].virtualPage);
 	// update TLB
 	if(!emptyTLB)
-		pageTable[entry->virtualPage] = *entry;
-	*entry = pageTable[vpn];
+		WriteBackTLBEntry(entry);
+	*entry = *pageTable->Lookup(vpn);
+	entry->asid = currentASID;
 	entry->firstUseTime = stats->totalTicks;
-	printf("A: TLB[%d] v:%d vpn:%d ppn:%d u:%d d:%d firstUseTime:%d\n",
-					idx, tlb[idx].valid, tlb[idx].virtualPage, tlb[idx].physicalPage, tlb[idx].use, tlb[idx].dirty, tlb[idx].firstUseTime);
 
 	return idx;
 }
@@ -380,36 +495,35 @@ Machine::ClockSwap(int addr)
 	DEBUG('p',"TLB MISS,use Clock swap\n");
 	int idx = -1;
 	int vpn = addr/PageSize;
-	int offset = addr/PageSize;
+	int set = TLBSet(vpn);
+	int base = set * tlbWays;
+	int *hand = &nextFramePoint[set];	// clock hand of this set
 	TranslationEntry *entry = NULL;
 	bool emptyTLB = false;
 	bool found = false;
 	do {
-		if(tlb[nextFramePoint].clockUse == 0)
+		if(tlb[base + *hand].clockUse == 0)
 		{
-			if(!tlb[nextFramePoint].valid)
+			if(!tlb[base + *hand].valid)
 				emptyTLB = true;
-			idx = nextFramePoint;
-			entry = &tlb[nextFramePoint];
+			idx = base + *hand;
+			entry = &tlb[base + *hand];
 			found = true;
-			printf("TLB[%d] clock expired \n", idx);
 		} else {
-			--tlb[nextFramePoint].clockUse;
-			printf("TLB[%d] clock second chance \n", nextFramePoint);
+			--tlb[base + *hand].clockUse;
+			TRACE(TraceTLBScan, base + *hand, tlb[base + *hand].clockUse,
+					tlb[base + *hand].dirty);
 		}
-		nextFramePoint = (nextFramePoint + 1)%TLBSize;
+		*hand = (*hand + 1)%tlbWays;
 	} while(!found);
 
-	// test
-	printf("B: TLB[%d] v:%d vpn:%d ppn:%d u:%d d:%d clockUse:%d \n",
-		idx, tlb[idx].valid, tlb[idx].virtualPage, tlb[idx].physicalPage, tlb[idx].use, tlb[idx].dirty, tlb[idx].clockUse);
+	TRACE(TraceTLBRefill, idx, vpn, emptyTLB ? -1 : tlb[idx].virtualPage);
 	// update TLB
 	if(!emptyTLB)
-		pageTable[entry->virtualPage] = *entry;
-	*entry = pageTable[vpn];
+		WriteBackTLBEntry(entry);
+	*entry = *pageTable->Lookup(vpn);
+	entry->asid = currentASID;
 	entry->clockUse = 1;
-	printf("A: TLB[%d] v:%d vpn:%d ppn:%d u:%d d:%d clockUse:%d\n",
-						idx, tlb[idx].valid, tlb[idx].virtualPage, tlb[idx].physicalPage, tlb[idx].use, tlb[idx].dirty, tlb[idx].clockUse);
 
 	return idx;
 }
@@ -421,49 +535,45 @@ Machine::NRUSwap(int addr)
 	DEBUG('p',"TLB MISS,use NRU swap\n");
 	int idx = -1;
 	int vpn = addr/PageSize;
-	int offset = addr/PageSize;
+	int set = TLBSet(vpn);
+	int base = set * tlbWays;
+	int *hand = &nextFramePoint[set];	// clock hand of this set
 	TranslationEntry *entry = NULL;
 	bool emptyTLB = false;
 	bool found = false;
 	int roundCount = 0;
 	do {
-		if ((roundCount/TLBSize)%2 == 0) {
-			if(tlb[nextFramePoint].use == 0 && tlb[nextFramePoint].dirty == 0)
+		if ((roundCount/tlbWays)%2 == 0) {
+			if(tlb[base + *hand].use == 0 && tlb[base + *hand].dirty == 0)
 			{
-				if(!tlb[nextFramePoint].valid)
+				if(!tlb[base + *hand].valid)
 					emptyTLB = true;
-				idx = nextFramePoint;
-				entry = &tlb[nextFramePoint];
+				idx = base + *hand;
+				entry = &tlb[base + *hand];
 				found = true;
-				printf("TLB[%d] found u:0 d:0 roundCount:%d \n", idx, roundCount);
 			}
-		} else if((roundCount/TLBSize)%2 == 1) {
-			if(tlb[nextFramePoint].use == 0 && tlb[nextFramePoint].dirty == 1)
+		} else if((roundCount/tlbWays)%2 == 1) {
+			if(tlb[base + *hand].use == 0 && tlb[base + *hand].dirty == 1)
 			{
-				idx = nextFramePoint;
-				entry = &tlb[nextFramePoint];
+				idx = base + *hand;
+				entry = &tlb[base + *hand];
 				found = true;
-				printf("TLB[%d] found u:0 d:1 roundCount:%d \n", idx, roundCount);
 			} else {
-				tlb[nextFramePoint].use = 0;
-				printf("TLB[%d] reset u:0 d:%d roundCount:%d \n", nextFramePoint, tlb[nextFramePoint].dirty, roundCount);
+				tlb[base + *hand].use = 0;
+				TRACE(TraceTLBScan, base + *hand, 0, tlb[base + *hand].dirty);
 			}
 		}
 		++roundCount;
-		nextFramePoint = (nextFramePoint + 1)%TLBSize;
+		*hand = (*hand + 1)%tlbWays;
 	} while(!found);
 
-	// test
-	printf("B: TLB[%d] v:%d vpn:%d ppn:%d u:%d d:%d \n",
-		idx, tlb[idx].valid, tlb[idx].virtualPage, tlb[idx].physicalPage, tlb[idx].use, tlb[idx].dirty);
+	TRACE(TraceTLBRefill, idx, vpn, emptyTLB ? -1 : tlb[idx].virtualPage);
 	// update TLB
 	if(!emptyTLB)
-		pageTable[entry->virtualPage] = *entry;
-	*entry = pageTable[vpn];
+		WriteBackTLBEntry(entry);
+	*entry = *pageTable->Lookup(vpn);
+	entry->asid = currentASID;
 	entry->clockUse = 1;
-	printf("A: TLB[%d] v:%d vpn:%d ppn:%d u:%d d:%d \n",
-		idx, tlb[idx].valid, tlb[idx].virtualPage, tlb[idx].physicalPage, tlb[idx].use, tlb[idx].dirty);
-
 
 	return idx;
 }
@@ -474,14 +584,12 @@ Machine::NRUSwap(int addr)
 /*
  * Function:	called when handling PageFault, swap page into memory
  * 				0. check if the page is in memory, then no need to swap, return 0
- * 				1. find a physical page to be swapped into "disk"(swap file)
- * 				2. swap physical page to "disk", and update the pageTable related to phyPageNum
- * 				3. if need, update TLB
- * 				4. find a physical page to be swapped into memory
- * 				5. check swappingPage:
+ * 				1. get a physical page, swapping some page into "disk"(swap
+ * 				   file) if memory is full (AllocFrame)
+ * 				2. check swappingPage:
  * 					1) if -1: lazy load from disk to memory
  * 					2) else : swap physical page from "disk"(swap file) to memory
- * 				6. set pageTable param(physicalPage and valid)
+ * 				3. set pageTable param(physicalPage and valid)
  * */
 int
 Machine::SwapPage(int addr)
@@ -489,97 +597,158 @@ Machine::SwapPage(int addr)
 	// 0. check if page is in memory(valid)
 	// in memory, return 0
 	int vpn = addr/PageSize;
-	if (pageTable[vpn].valid) {
+	TranslationEntry *pte = pageTable->Lookup(vpn);
+	if (pte != NULL && pte->valid) {
 	    DEBUG('a', "swap page %d: in mem!\n", vpn);
 	   	return 0;
  	}
 
-	printf("SwapPage: not in memory start swapping from 'disk'\n");
-	// not in memory, need swapping from "disk"(swap file)
-	// 1. find a physical page to be swapped into "disk"(swap file)
-	int phyPageNum = 0;
-	int virPageNum = 0;
-	int tid = 0;
-	int swappingPage = -1;
-	bool unused = false;
-	phyPageNum = LRUSwapPage(&unused);
-
-	// 2. swap physical page to "disk"
-	// update the pageTable related to phyPageNum
-	// get phyPageNum --- thread --- addr space --- pageTable --- vpn --- swappingPage
-	if(!unused) {
-		// page has been alloced to some thread, so it need swapping into disk
-		// (not consider dirty page or not)
-		virPageNum = memManager->GetVirPageNum(phyPageNum);
-		tid = memManager->GetThreadId(phyPageNum);
-		if(virPageNum < 0 || tid < 0 || tid_pointer[tid]->space == NULL)
-			return -1;
-		swappingPage = swapManager->swapIntoDisk(phyPageNum);
-		tid_pointer[tid]->setPTESwappingPage(virPageNum, swappingPage);// set swappingPage and set valid to false
-		printf("SwapPage: page to swap into 'disk': tid:%d vpn:%d ppn:%d swappage:%d\n", tid, virPageNum, phyPageNum, swappingPage);
-	}
+	// a page touched for the first time gets its page table entry (and
+	// maybe its second level table) only now. An image page another
+	// process running the same executable has in memory is shared, not
+	// loaded again
+	pte = pageTable->Map(vpn);
+#ifdef NETWORK
+	// a page of the DSM region comes from whichever machine has it
+	if(currentThread->space->IsDsmPage(vpn))
+		return dsm->Fault(currentThread->space, vpn, FALSE) ? 0 : -1;
+	// a page a migrated process left in the swap file of the machine
+	// it came from is fetched from there
+	if(currentThread->space->IsRemotePage(vpn))
+		return migrator->Fault(currentThread->space, vpn) ? 0 : -1;
+#endif
+	if(pte->swappingPage == -1 && currentThread->space->MapCachedPage(vpn))
+		return 0;
 
-	// 3. if need, update TLB
-	for(int i = 0; i<TLBSize; i++)
-	{
-		if(tlb[i].physicalPage == phyPageNum) {
-			tlb[i].valid = FALSE;
-			break;
-		}
-	}
+	// not in memory, need swapping from "disk"(swap file)
+	// 1. find a physical page
+	int phyPageNum = AllocFrame(vpn);
+	if(phyPageNum < 0)
+		return -1;
 
-	// 4. find physical page to be swapped into memory
-	swappingPage = pageTable[vpn].swappingPage;
+	// 2. find physical page to be swapped into memory
+	int swappingPage = pte->swappingPage;
 	if(swappingPage == -1)
 	{
-		// 5. lazy load from disk to memory
+		// lazy load from disk to memory
 		LazyLoad(phyPageNum, vpn);
-		printf("SwapPage: lazy load from disk to memory\n");
 	} else {
-		// 5. swap physical page from "disk"(swap file) to memory
+		// swap physical page from "disk"(swap file) to memory, this
+		// drops our reference to the swap page
 		swapManager->swapOutFromDisk(phyPageNum, swappingPage);
-		printf("SwapPage: swap physical page from 'disk''(swap file) to memory\n");
+		pte->swappingPage = -1;
 	}
+	TRACE(TracePageIn, vpn, phyPageNum, swappingPage);
+
+	// 3. set pageTable param
+	pte->physicalPage = phyPageNum;
+	pte->valid = TRUE;
+
+	return 0;
+}
+
+/*
+ * Function:	get a physical page for virtual page "vpn" of the current
+ * 				thread. If memory is full, the LRU page is swapped into
+ * 				"disk"(swap file) first.
+ * return:		physical page number, -1 if the swap file is full or
+ * 				every page is pinned
+ * */
+int
+Machine::AllocFrame(int vpn)
+{
+	bool unused = false;
+	int phyPageNum = LRUSwapPage(&unused);
 
-	if(unused)
-	{	// update global memory management structure
+	if(phyPageNum < 0) {
+		return -1;
+	} else if(unused) {
 		memManager->Mark(phyPageNum);
-		memManager->SetPhyMemPage(phyPageNum, currentThread->getTid(), vpn);
-		memManager->UpdateLastUsedTime(phyPageNum, stats->totalTicks);
+	} else if(EvictFrame(phyPageNum) < 0) {
+		return -1;
+	}
+
+	// update global memory management structure, the page now has a
+	// single owner
+	memManager->SetPhyMemPage(phyPageNum, currentThread->getTid(), vpn);
+	memManager->UpdateLastUsedTime(phyPageNum, stats->totalTicks);
+	return phyPageNum;
+}
+
+/*
+ * Function:	swap physical page "phyPageNum" into "disk"(swap file).
+ * 				After a copy-on-write Fork the page may be mapped by
+ * 				several address spaces, always at the same vpn, so every
+ * 				live address space is checked; all of them end up sharing
+ * 				the swap page. Their TLB items are invalidated.
+ * 				Pages of an Mmap region are written back to their file.
+ * return:		0, or -1 if the swap file is full
+ * */
+int
+Machine::EvictFrame(int phyPageNum)
+{
+	int virPageNum = memManager->GetVirPageNum(phyPageNum);
+	if(virPageNum < 0)
+		return -1;
+
+	// a page of an Mmap region goes back to its file instead; those
+	// are never shared, the page belongs to its last owner
+	int tid = memManager->GetThreadId(phyPageNum);
+	if(tid >= 0 && tid < MAX_THREADS_NUM && tid_flag[tid]
+			&& tid_pointer[tid] != NULL && tid_pointer[tid]->space != NULL
+			&& tid_pointer[tid]->space->IsMappedPage(virPageNum)) {
+		AddrSpace *owner = tid_pointer[tid]->space;
+		FlushTLBPage(owner->GetASID(), virPageNum);
+		owner->EvictMappedPage(virPageNum);
+		return 0;
+	}
+
+	int swappingPage = swapManager->swapIntoDisk(phyPageNum);
+	if(swappingPage < 0)
+		return -1;
+
+	int sharers = 0;
+	for(int t = 0; t<MAX_THREADS_NUM; t++) {
+		if(!tid_flag[t] || tid_pointer[t] == NULL || tid_pointer[t]->space == NULL)
+			continue;
+		TranslationEntry *pte = tid_pointer[t]->space->GetPTE(virPageNum);
+		if(pte == NULL || !pte->valid || pte->physicalPage != phyPageNum)
+			continue;
+		pte->valid = FALSE;		// set swappingPage and set valid to false
+		pte->swappingPage = swappingPage;
+		if(sharers++ > 0)
+			swapManager->Share(swappingPage);
 	}
+	TRACE(TracePageOut, virPageNum, phyPageNum, swappingPage);
 
-	// 6. set pageTable param
-	pageTable[vpn].physicalPage = phyPageNum;
-	pageTable[vpn].valid = TRUE;
+	if(sharers == 0)	// nobody maps the page any more
+		swapManager->Clear(swappingPage);
 
+	// if need, update TLB
+	for(int i = 0; i<tlbSize; i++)
+	{
+		if(tlb[i].valid && tlb[i].physicalPage == phyPageNum)
+			tlb[i].valid = FALSE;
+	}
 	return 0;
 }
 
 /* Function: 	 find a physical page in memory to swap into disk,
  * virtualPageNum:	virtualPageNum
- * return:		 physical page number
+ * return:		 physical page number, -1 if every page is pinned
  *
  * */
 int
 Machine::LRUSwapPage(bool* unused)
 {
-	// update pageTable by tlb
-	int vpn = 0;
-	int phyNum = 0;
-	int lastUsedTime = 0;
-	for(int i = 0; i<TLBSize; i++) {
-		if(tlb[i].valid) {
-			vpn = tlb[i].virtualPage;
-			pageTable[vpn] = tlb[i];
-		}
-	}
-	// update phyMemPageTable by pageTable
-	for(int i = 0; i<pageTableSize; i++) {
-		if(pageTable[i].valid) {
-			phyNum = pageTable[i].physicalPage;
-			lastUsedTime = pageTable[i].lastUseTime;
-			memManager->UpdateLastUsedTime(phyNum, lastUsedTime);
-		}
+	// update pageTables by tlb, entries of every address space
+	SyncTLB();
+	// update phyMemPageTable by pageTables. This is the use-bit harvesting
+	// context switches used to do for the outgoing space; doing it here
+	// for all live spaces keeps the switch O(1)
+	for(int t = 0; t<MAX_THREADS_NUM; t++) {
+		if(tid_flag[t] && tid_pointer[t] != NULL && tid_pointer[t]->space != NULL)
+			tid_pointer[t]->space->HarvestUseBits();
 	}
 	return memManager->FindSwapPage(unused);
 }
@@ -36,7 +36,8 @@
 
 #define NumPhysPages    32
 #define MemorySize 	(NumPhysPages * PageSize)
-#define TLBSize		4		// if there is a TLB, make it small
+#define DefaultTLBSize	4		// if there is a TLB, make it small;
+					// -tlb <entries>[:<ways>] changes it
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -75,6 +76,9 @@ enum ExceptionType { NoException,           // Everything ok!
 
 enum TLBSwapPolicy{LRU, NRU, FIFO_TLB, CLOCK, NumTLBSwapPolicy};
 
+class Thread;
+class AddrSpace;
+
 
 // The following class defines an instruction, represented in both
 // 	undecoded binary form
@@ -111,7 +115,9 @@ class Instruction {
 
 class Machine {
   public:
-    Machine(bool debug, TLBSwapPolicy tlbPolicy = LRU, bool lazyLoadStrategy = false);	// Initialize the simulation of the hardware
+    Machine(bool debug, TLBSwapPolicy tlbPolicy = LRU, bool lazyLoadStrategy = false,
+    		bool eagerSwitchStrategy = false, int tlbEntries = DefaultTLBSize,
+    		int tlbAssoc = 0);	// Initialize the simulation of the hardware
 				// for running user programs
     ~Machine();			// De-allocate the data structures
 
@@ -154,8 +160,16 @@ class Machine {
 
     void InvalidTLB(); 		// update pageTable by current TLB
     						// then, set all TLB item invalid
-    						// called when threads switch
-
+    						// called when threads switch (eager switch only)
+    void FlushTLB(int asid);	// set all TLB items of address space "asid" invalid,
+    						// called when the address space is torn down
+    void SyncTLB();			// write use/dirty bits of every valid TLB item
+    						// back to the owner's pageTable, keep them valid
+    void FlushTLBPage(int asid, int vpn);	// write back and invalidate the
+    						// TLB item of one page, after its PTE changed
+    void WriteBackTLBEntry(TranslationEntry* entry);
+
+    int TLBSet(int vpn);	// set index of vpn in the running address space
     void UpdateTLB(int idx); // when hit in tlb, base on the swap policy,
         						// update the param
     int TLBSwap(int addr); // handle TLB pageFault, choose subtaintial policy, swap page from pageTable
@@ -167,8 +181,13 @@ class Machine {
 #ifdef VM
     int SwapPage(int addr); 	// load page from "disk"(swap file)
     int LRUSwapPage(bool* unused);			// find a physical page in memory to swap into disk, return physical page number
+    int AllocFrame(int vpn);	// get a physical page for vpn of the current
+    						// thread, evicting one if memory is full
+    int EvictFrame(int phyPageNum);	// swap a physical page into "disk" and
+    						// point every PTE sharing it at the swap page
 #endif
     bool UseLazyLoad() { return lazyLoad; }
+    bool UseEagerSwitch() { return eagerSwitch; }
     int LazyLoad(int phyPageNum, int vpn);	// load page from disk
 #endif
 
@@ -203,10 +222,22 @@ class Machine {
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
-    int nextFramePoint;	// TLB clock
-
-    TranslationEntry *pageTable;
-    unsigned int pageTableSize;
+    int tlbSize;			// number of entries in "tlb"
+    int tlbWays;			// entries per set, tlbSize if fully
+    					// associative
+    int tlbSets;			// tlbSize / tlbWays
+    int *nextFramePoint;	// TLB clock hand, one per set
+
+    PageTable *pageTable;		// two-level table of the running space
+    unsigned int pageTableSize;		// number of virtual pages it covers
+    int currentASID;		// address space id of the running pageTable,
+    				// TLB entries are only hit with a matching asid
+    AddrSpace *currentSpace;	// the running address space, charged
+    				// with per-process TLB hits and misses
+
+    Thread *userRegOwner;	// the user thread whose state is live in
+    				// "registers"; saved lazily on a switch to
+    				// another user thread
 
   private:
     bool singleStep;		// drop back into the debugger after each
@@ -215,6 +246,8 @@ class Machine {
 				// time reaches this value
     TLBSwapPolicy tlbSwapPolicy;
     bool lazyLoad;
+    bool eagerSwitch;		// save registers, flush TLB and harvest use
+    				// bits on every context switch (old behaviour)
 };
 
 extern void ExceptionHandler(ExceptionType which);
@@ -37,7 +37,9 @@ Network::Network(NetworkAddress addr, double reliability,
     readHandler = readAvail;
     handlerArg = callArg;
     sendBusy = FALSE;
-    inHdr.length = 0;
+    numSending = outCount = 0;
+    inHead = inCount = 0;
+    pollInterval = NetworkTime;
     
     sock = OpenSocket();
     sprintf(sockName, "SOCKET_%d", (int)addr);
@@ -54,86 +56,133 @@ Network::~Network()
     DeAssignNameToSocket(sockName);
 }
 
-// if a packet is already buffered, we simply delay reading 
-// the incoming packet.  In real life, the incoming 
-// packet might be dropped if we can't read it in time.
+// read in as many waiting packets as there is room for, with one host
+// call, and interrupt once for all of them.  If the earlier ones are
+// still buffered, the rest wait in the socket; in real life, they
+// might be dropped if we can't read them in time.
+//
+// While nothing arrives, poll less and less often.
 void
 Network::CheckPktAvail()
 {
-    // schedule the next time to poll for a packet
-    interrupt->Schedule(NetworkReadPoll, (int)this, NetworkTime, NetworkRecvInt);
+    char buffer[NetworkBatchSize * MaxWireSize];
+    int n = 0;
 
-    if (inHdr.length != 0) 	// do nothing if packet is already buffered
-	return;		
-    if (!PollSocket(sock)) 	// do nothing if no packet to be read
-	return;
+    if (inCount < NetworkBatchSize && PollSocket(sock))
+	n = ReadBatchFromSocket(sock, buffer, MaxWireSize,
+				NetworkBatchSize - inCount);
+
+    if (n == 0) {
+	if (pollInterval < MaxPollInterval)
+	    pollInterval *= 2;
+    } else
+	pollInterval = NetworkTime;
+
+    // schedule the next time to poll for packets
+    interrupt->Schedule(NetworkReadPoll, (int)this, pollInterval, NetworkRecvInt);
 
-    // otherwise, read packet in
-    char *buffer = new char[MaxWireSize];
-    ReadFromSocket(sock, buffer, MaxWireSize);
+    if (n == 0)
+	return;
 
-    // divide packet into header and data
-    inHdr = *(PacketHeader *)buffer;
-    ASSERT((inHdr.to == ident) && (inHdr.length <= MaxPacketSize));
-    bcopy(buffer + sizeof(PacketHeader), inbox, inHdr.length);
-    delete []buffer ;
+    for (int i = 0; i < n; i++) {
+	char *packet = buffer + i * MaxWireSize;
+	PacketHeader *hdr = (PacketHeader *) packet;
 
-    DEBUG('n', "Network received packet from %d, length %d...\n",
-	  				(int) inHdr.from, inHdr.length);
-    stats->numPacketsRecvd++;
+	ASSERT((hdr->to == ident) && (hdr->length <= MaxPacketSize));
+	DEBUG('n', "Network received packet from %d, length %d...\n",
+	  				(int) hdr->from, hdr->length);
+	bcopy(packet, inbox[(inHead + inCount) % NetworkBatchSize], 
+	      MaxWireSize);
+	inCount++;
+    }
+    stats->numPacketsRecvd += n;
+    stats->numNetworkRecvInts++;
 
-    // tell post office that the packet has arrived
+    // tell post office that the packets have arrived
     (*readHandler)(handlerArg);	
 }
 
-// notify user that another packet can be sent
+// notify user that more packets can be sent, and send the ones
+// that were queued meanwhile
 void
 Network::SendDone()
 {
     sendBusy = FALSE;
-    stats->numPacketsSent++;
+    stats->numPacketsSent += numSending;
+    stats->numNetworkSendInts++;
+    numSending = 0;
+    if (outCount > 0)
+	StartSend();
     (*writeHandler)(handlerArg);
 }
 
-// send a packet by concatenating hdr and data, and schedule
-// an interrupt to tell the user when the next packet can be sent 
+// put the queued packets on the wire with one host call, dropping
+// some to emulate an unreliable link, and schedule one interrupt for
+// the batch, NetworkTime per packet from now
 //
 // Note we always pad out a packet to MaxWireSize before putting it into
 // the socket, because it's simpler at the receive end.
 void
-Network::Send(PacketHeader hdr, char* data)
+Network::StartSend()
 {
-    char toName[32];
+    char names[NetworkBatchSize][32];
+    char *toNames[NetworkBatchSize];
+    int kept = 0;
+
+    for (int i = 0; i < outCount; i++) {
+	PacketHeader *hdr = (PacketHeader *) outbox[i];
+
+	if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
+	    DEBUG('n', "Packet to %d lost\n", hdr->to);
+	    continue;
+	}
+	sprintf(names[kept], "SOCKET_%d", (int)hdr->to);
+	toNames[kept] = names[kept];
+	if (kept != i)
+	    bcopy(outbox[i], outbox[kept], MaxWireSize);
+	kept++;
+    }
+    SendBatchToSocket(sock, (char *) outbox, MaxWireSize, toNames, kept);
 
-    sprintf(toName, "SOCKET_%d", (int)hdr.to);
-    
-    ASSERT((sendBusy == FALSE) && (hdr.length > 0) 
+    sendBusy = TRUE;
+    numSending = outCount;
+    outCount = 0;
+    interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime * numSending,
+			NetworkSendInt);
+}
+
+// queue a packet by concatenating hdr and data; it goes out right away
+// if the wire is free, or with the next batch otherwise
+void
+Network::Send(PacketHeader hdr, char* data)
+{
+    ASSERT(!SendFull() && (hdr.length > 0) 
 		&& (hdr.length <= MaxPacketSize) && (hdr.from == ident));
     DEBUG('n', "Sending to addr %d, %d bytes... ", hdr.to, hdr.length);
 
-    interrupt->Schedule(NetworkSendDone, (int)this, NetworkTime, NetworkSendInt);
+    bzero(outbox[outCount], MaxWireSize);
+    *(PacketHeader *)outbox[outCount] = hdr;
+    bcopy(data, outbox[outCount] + sizeof(PacketHeader), hdr.length);
+    outCount++;
+    pollInterval = NetworkTime;		// expect an answer soon
 
-    if (Random() % 100 >= chanceToWork * 100) { // emulate a lost packet
-	DEBUG('n', "oops, lost it!\n");
-	return;
-    }
-
-    // concatenate hdr and data into a single buffer, and send it out
-    char *buffer = new char[MaxWireSize];
-    *(PacketHeader *)buffer = hdr;
-    bcopy(data, buffer + sizeof(PacketHeader), hdr.length);
-    SendToSocket(sock, buffer, MaxWireSize, toName);
-    delete []buffer;
+    if (!sendBusy)
+	StartSend();
 }
 
 // read a packet, if one is buffered
 PacketHeader
 Network::Receive(char* data)
 {
-    PacketHeader hdr = inHdr;
+    PacketHeader hdr;
 
-    inHdr.length = 0;
-    if (hdr.length != 0)
-    	bcopy(inbox, data, hdr.length);
+    if (inCount == 0) {
+	hdr.length = 0;
+	return hdr;
+    }
+    hdr = *(PacketHeader *)inbox[inHead];
+    bcopy(inbox[inHead] + sizeof(PacketHeader), data, hdr.length);
+    inHead = (inHead + 1) % NetworkBatchSize;
+    inCount--;
     return hdr;
 }
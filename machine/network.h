@@ -41,6 +41,11 @@ class PacketHeader {
 #define MaxPacketSize 	(MaxWireSize - sizeof(struct PacketHeader))	
 				// data "payload" of the largest packet
 
+#define NetworkBatchSize 8	// packets queued, or read, at a time
+#define MaxPollInterval	(8 * NetworkTime)
+				// longest wait between receive polls
+				// while the link is idle
+
 
 // The following class defines a physical network device.  The network
 // is capable of delivering fixed sized packets, in order but unreliably, 
@@ -51,6 +56,15 @@ class PacketHeader {
 // a packet.  Note that you can change the seed for the random number 
 // generator, by changing the arguments to RandomInit() in Initialize().
 // The random number generator is used to choose which packets to drop.
+//
+// Packets are moved in batches, as a real interface with a descriptor
+// ring would.  Send queues the packet; while a batch is on the wire,
+// up to NetworkBatchSize more packets can be queued, and they all go
+// out together when it's done, with one host call and one interrupt
+// NetworkTime per packet later.  Likewise, each receive poll reads all
+// the waiting packets it has room for, and interrupts once for all of
+// them.  The receive poll backs off, up to MaxPollInterval, while
+// nothing is arriving or being sent.
 
 class Network {
   public:
@@ -61,24 +75,28 @@ class Network {
     
     void Send(PacketHeader hdr, char* data);
     				// Send the packet data to a remote machine,
-				// specified by "hdr".  Returns immediately.
-    				// "writeHandler" is invoked once the next 
-				// packet can be sent.  Note that writeHandler 
-				// is called whether or not the packet is 
-				// dropped, and note that the "from" field of 
-				// the PacketHeader is filled in automatically 
-				// by Send().
+				// specified by "hdr".  Returns immediately,
+				// with the packet queued.  "writeHandler"
+				// is invoked each time a batch has been
+				// sent, so more packets can be queued.
+				// Note that writeHandler is called whether
+				// or not the packets are dropped, and note
+				// that the "from" field of the PacketHeader
+				// is filled in automatically by Send().
+    bool SendFull() { return outCount == NetworkBatchSize; }
+				// No room to queue another packet
 
     PacketHeader Receive(char* data);
-    				// Poll the network for incoming messages.  
+    				// Take the next packet that has arrived.
 				// If there is a packet waiting, copy the 
 				// packet into "data" and return the header.
 				// If no packet is waiting, return a header 
-				// with length 0.
+				// with length 0.  "readHandler" is invoked
+				// once for each batch that arrives.
 
     void SendDone();		// Interrupt handler, called when message is 
 				// sent
-    void CheckPktAvail();	// Check if there is an incoming packet
+    void CheckPktAvail();	// Check if there are incoming packets
 
   private:
     NetworkAddress ident;	// This machine's network address
@@ -91,11 +109,16 @@ class Network {
 				// 	arrived.
     int handlerArg;		// Argument to be passed to interrupt handler
 				//   (pointer to post office)
-    bool sendBusy;		// Packet is being sent.
-    bool packetAvail;		// Packet has arrived, can be pulled off of
-				//   network
-    PacketHeader inHdr;		// Information about arrived packet
-    char inbox[MaxPacketSize];  // Data for arrived packet
+    void StartSend();		// Put all queued packets on the wire
+
+    bool sendBusy;		// A batch is being sent.
+    int numSending;		// Packets in that batch
+    char outbox[NetworkBatchSize][MaxWireSize];
+    int outCount;		// Packets queued for the next batch
+    char inbox[NetworkBatchSize][MaxWireSize];
+				// Arrived packets, header and data
+    int inHead, inCount;	// The oldest is inbox[inHead]
+    int pollInterval;		// Ticks until the next receive poll
 };
 
 #endif // NETWORK_H
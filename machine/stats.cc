@@ -20,9 +20,26 @@ Statistics::Statistics()
 {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
-    numConsoleCharsRead = numConsoleCharsWritten = 0;
+    numConsoleCharsRead = numConsoleCharsWritten = numConsoleWriteInts = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numMailDropped = numNetworkSendInts = numNetworkRecvInts = 0;
     numTLBHit = numTLBMiss = 0;
+    numContextSwitches = numUserRegSaves = 0;
+    numTLBFlushed = numPTEScanned = 0;
+    numPagesShared = numPagesCopied = 0;
+    numExecPagesLoaded = numExecPagesShared = 0;
+    numMmapPagesRead = numMmapPagesWritten = 0;
+    numSyscallTraps = numSyscallsBatched = 0;
+    numAioRequests = numAioInFlight = aioOverlapTicks = 0;
+    numFutexWaits = numLockWaits = numRWLockWaits = 0;
+    numRangeLockWaits = 0;
+    numPipeBytes = numPipeWaits = 0;
+    numSegmentsSent = numRetransmits = 0;
+    numDsmReadFaults = numDsmWriteFaults = numDsmInvalidations = 0;
+    numRemoteCalls = numRemoteCacheHits = numRemoteCacheMisses = 0;
+    numLeaseRevokes = 0;
+    numMigrationsOut = numMigrationsIn = 0;
+    numMigratePagesPushed = numMigratePagesPulled = 0;
 }
 
 //----------------------------------------------------------------------
@@ -37,10 +54,45 @@ Statistics::Print()
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks, 
 	idleTicks, systemTicks, userTicks);
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
-    printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
-	numConsoleCharsWritten);
+    printf("Console I/O: reads %d, writes %d, write interrupts %d\n",
+	numConsoleCharsRead, numConsoleCharsWritten, numConsoleWriteInts);
     printf("Paging: faults %d\n", numPageFaults);
-    printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
-	numPacketsSent);
-    printf("TLB: hits %d, miss %d\n", numTLBHit, numTLBMiss);
+    printf("Network I/O: packets received %d, sent %d, dropped at a full "
+	"mailbox %d\n", numPacketsRecvd, numPacketsSent, numMailDropped);
+    printf("Network interrupts: receive %d, send %d\n", numNetworkRecvInts,
+	numNetworkSendInts);
+    printf("TLB: hits %d, miss %d, hit rate %.1f%%\n", numTLBHit, numTLBMiss,
+	numTLBHit + numTLBMiss > 0 ?
+	100.0 * numTLBHit / (numTLBHit + numTLBMiss) : 0.0);
+    printf("Context switches: %d, %.1f per simulated second\n",
+	numContextSwitches, totalTicks > 0 ?
+	(double) numContextSwitches * TicksPerSecond / totalTicks : 0.0);
+    printf("Switch overhead: register saves %d, TLB entries flushed %d, "
+	"PTEs scanned %d\n", numUserRegSaves, numTLBFlushed, numPTEScanned);
+    printf("Copy-on-write: pages shared %d, copied %d\n", numPagesShared,
+	numPagesCopied);
+    printf("Executable pages: loaded %d, shared from cache %d\n",
+	numExecPagesLoaded, numExecPagesShared);
+    printf("Mapped file pages: read %d, written back %d\n", numMmapPagesRead,
+	numMmapPagesWritten);
+    printf("Syscalls: traps %d, batched calls %d\n", numSyscallTraps,
+	numSyscallsBatched);
+    printf("Async I/O: requests %d, user ticks overlapped with them %d\n",
+	numAioRequests, aioOverlapTicks);
+    printf("Futex: waits that slept %d\n", numFutexWaits);
+    printf("Locks: contended acquires %d, contended rw locks %d, "
+	"contended file ranges %d\n", numLockWaits, numRWLockWaits,
+	numRangeLockWaits);
+    printf("Pipes: bytes passed %d, writes waiting for room %d\n",
+	numPipeBytes, numPipeWaits);
+    printf("Transport: segments sent %d, retransmitted %d\n",
+	numSegmentsSent, numRetransmits);
+    printf("DSM: read faults %d, write faults %d, pages given up %d\n",
+	numDsmReadFaults, numDsmWriteFaults, numDsmInvalidations);
+    printf("Remote files: calls %d, cached block reads %d, block reads from "
+	"the server %d, leases revoked %d\n", numRemoteCalls,
+	numRemoteCacheHits, numRemoteCacheMisses, numLeaseRevokes);
+    printf("Migration: processes out %d, in %d, pages sent along %d, "
+	"pages fetched %d\n", numMigrationsOut, numMigrationsIn,
+	numMigratePagesPushed, numMigratePagesPulled);
 }
@@ -32,13 +32,54 @@ class Statistics {
     int numDiskWrites;		// number of disk write requests
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
+    int numConsoleWriteInts;	// display interrupts, each for up to
+    				// ConsoleFifoSize characters
     int numPageFaults;		// number of virtual memory page faults
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
+    int numMailDropped;		// arrived mail dropped, its box was full
+    int numNetworkSendInts;	// network send interrupts, one per batch
+    int numNetworkRecvInts;	// network receive interrupts, one per batch
 
     int numTLBHit;			// number of TLB hit
     int numTLBMiss;			// number of TLB miss and throw PageFaultException
 
+    int numContextSwitches;	// number of calls to Scheduler::Run
+    int numUserRegSaves;	// number of user register sets saved
+    int numTLBFlushed;		// number of TLB entries invalidated
+    int numPTEScanned;		// number of PTEs scanned to harvest use bits
+    int numPagesShared;		// pages shared copy-on-write by Fork
+    int numPagesCopied;		// ... and copied on a later write
+    int numExecPagesLoaded;	// image pages read from executables
+    int numExecPagesShared;	// image pages found in the page cache
+    int numMmapPagesRead;	// Mmap pages read from their file
+    int numMmapPagesWritten;	// ... and dirty ones written back
+    int numSyscallTraps;	// syscall exceptions taken
+    int numSyscallsBatched;	// calls run from a ring by Submit, each
+    				// one a trap saved (less the Submit)
+    int numAioRequests;		// AioRead/AioWrite requests made
+    int numAioInFlight;		// ... and not done yet
+    int aioOverlapTicks;	// user ticks run while one was in flight
+    int numFutexWaits;		// FutexWaits that slept
+    int numLockWaits;		// Lock::Acquire calls that had to wait
+    int numRWLockWaits;		// RWLock rlock/wlock calls that had to wait
+    int numRangeLockWaits;	// file sector-range locks that had to wait
+    int numPipeBytes;		// bytes passed through pipes
+    int numPipeWaits;		// pipe writes that waited for room
+    int numSegmentsSent;	// stream segments sent, counting resends
+    int numRetransmits;		// stream segments sent again on a timeout
+    int numDsmReadFaults;	// DSM pages asked for to read
+    int numDsmWriteFaults;	// DSM pages asked for to write
+    int numDsmInvalidations;	// DSM pages given up for another machine
+    int numRemoteCalls;		// requests sent to the file server
+    int numRemoteCacheHits;	// remote file blocks read from our cache
+    int numRemoteCacheMisses;	// remote file blocks read from the server
+    int numLeaseRevokes;	// file leases the server took back
+    int numMigrationsOut;	// processes moved to another machine
+    int numMigrationsIn;	// processes moved here
+    int numMigratePagesPushed;	// pages sent along with a process
+    int numMigratePagesPulled;	// pages fetched by a process moved here
+
     Statistics(); 		// initialize everything to zero
 
     void Print();		// print collected statistics
@@ -59,5 +100,6 @@ class Statistics {
 #define ConsoleTime 	100	// time to read or write one character
 #define NetworkTime 	100   	// time to send or receive one packet
 #define TimerTicks 	50//100    	// (average) time between timer interrupts
+#define TicksPerSecond	1000000	// a tick taken as a microsecond, for rates
 
 #endif // STATS_H
@@ -390,6 +390,96 @@ SendToSocket(int sockID, char *buffer, int packetSize, char *toName)
     ASSERT(retVal == packetSize);
 }
 
+#define MaxSocketBatch	32	// most packets moved by one batch call
+
+//----------------------------------------------------------------------
+// ReadBatchFromSocket
+// 	Read as many fixed size packets as are waiting on the IPC port,
+//	up to "maxPackets", into consecutive "packetSize" slots of
+//	"buffers", without waiting.  Returns how many were read.
+//
+//	On Linux this is a single recvmmsg call; elsewhere we fall back
+//	to one recvfrom per packet.
+//----------------------------------------------------------------------
+int
+ReadBatchFromSocket(int sockID, char *buffers, int packetSize, int maxPackets)
+{
+#ifdef __linux__
+    struct mmsghdr msgs[MaxSocketBatch];
+    struct iovec iovs[MaxSocketBatch];
+    int retVal;
+
+    if (maxPackets > MaxSocketBatch)
+	maxPackets = MaxSocketBatch;
+    bzero((char *) msgs, sizeof(msgs));
+    for (int i = 0; i < maxPackets; i++) {
+	iovs[i].iov_base = buffers + i * packetSize;
+	iovs[i].iov_len = packetSize;
+	msgs[i].msg_hdr.msg_iov = &iovs[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    retVal = recvmmsg(sockID, msgs, maxPackets, MSG_DONTWAIT, NULL);
+    if (retVal < 0) {
+	ASSERT(errno == EAGAIN || errno == EWOULDBLOCK);
+	return 0;
+    }
+    for (int i = 0; i < retVal; i++)
+	ASSERT((int) msgs[i].msg_len == packetSize);
+    return retVal;
+#else
+    int n = 0;
+
+    while (n < maxPackets && PollFile(sockID)) {
+	ReadFromSocket(sockID, buffers + n * packetSize, packetSize);
+	n++;
+    }
+    return n;
+#endif
+}
+
+//----------------------------------------------------------------------
+// SendBatchToSocket
+// 	Transmit "numPackets" fixed size packets, kept in consecutive
+//	"packetSize" slots of "buffers", to the IPC ports named in
+//	"toNames".  Abort on error.
+//
+//	On Linux this is a single sendmmsg call; elsewhere we fall back
+//	to one sendto per packet.
+//----------------------------------------------------------------------
+void
+SendBatchToSocket(int sockID, char *buffers, int packetSize,
+		  char **toNames, int numPackets)
+{
+#ifdef __linux__
+    struct mmsghdr msgs[MaxSocketBatch];
+    struct iovec iovs[MaxSocketBatch];
+    struct sockaddr_un uNames[MaxSocketBatch];
+    int sent = 0, retVal;
+
+    ASSERT(numPackets <= MaxSocketBatch);
+    if (numPackets == 0)
+	return;
+    bzero((char *) msgs, sizeof(msgs));
+    for (int i = 0; i < numPackets; i++) {
+	InitSocketName(&uNames[i], toNames[i]);
+	iovs[i].iov_base = buffers + i * packetSize;
+	iovs[i].iov_len = packetSize;
+	msgs[i].msg_hdr.msg_name = &uNames[i];
+	msgs[i].msg_hdr.msg_namelen = sizeof(uNames[i]);
+	msgs[i].msg_hdr.msg_iov = &iovs[i];
+	msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while (sent < numPackets) {		// sendmmsg may stop short
+	retVal = sendmmsg(sockID, msgs + sent, numPackets - sent, 0);
+	ASSERT(retVal > 0);
+	sent += retVal;
+    }
+#else
+    for (int i = 0; i < numPackets; i++)
+	SendToSocket(sockID, buffers + i * packetSize, packetSize, toNames[i]);
+#endif
+}
+
 
 //----------------------------------------------------------------------
 // CallOnUserAbort
@@ -37,6 +37,10 @@ extern void DeAssignNameToSocket(char *socketName);
 extern bool PollSocket(int sockID);
 extern void ReadFromSocket(int sockID, char *buffer, int packetSize);
 extern void SendToSocket(int sockID, char *buffer, int packetSize,char *toName);
+extern int ReadBatchFromSocket(int sockID, char *buffers, int packetSize,
+			       int maxPackets);
+extern void SendBatchToSocket(int sockID, char *buffers, int packetSize,
+			      char **toNames, int numPackets);
 
 // Process control: abort, exit, and sleep
 extern void Abort();
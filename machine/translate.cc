@@ -71,6 +71,85 @@ unsigned short
 ShortToMachine(unsigned short shortword) { return ShortToHost(shortword); }
 
 
+//----------------------------------------------------------------------
+// PageTable::PageTable
+// 	Initialize an empty two-level page table for an address space of
+//	"size" virtual pages.  Only the directory is allocated here.
+//----------------------------------------------------------------------
+
+PageTable::PageTable(int size)
+{
+    numPages = size;
+    numTables = divRoundUp(numPages, PTEsPerTable);
+    numAllocated = 0;
+    directory = new TranslationEntry *[numTables];
+    for (int t = 0; t < numTables; t++)
+	directory[t] = NULL;
+}
+
+//----------------------------------------------------------------------
+// PageTable::~PageTable
+// 	De-allocate the second level tables and the directory.
+//----------------------------------------------------------------------
+
+PageTable::~PageTable()
+{
+    for (int t = 0; t < numTables; t++)
+	delete [] directory[t];
+    delete [] directory;
+}
+
+//----------------------------------------------------------------------
+// PageTable::Lookup
+// 	Return the entry mapping "vpn", or NULL if vpn is out of range or
+//	no page in its second level table has been mapped yet (in which
+//	case the page is certainly not valid).
+//----------------------------------------------------------------------
+
+TranslationEntry *
+PageTable::Lookup(int vpn)
+{
+    if (vpn < 0 || vpn >= numPages || directory[vpn / PTEsPerTable] == NULL)
+	return NULL;
+    return &directory[vpn / PTEsPerTable][vpn % PTEsPerTable];
+}
+
+//----------------------------------------------------------------------
+// PageTable::Map
+// 	Return the entry mapping "vpn", allocating the second level table
+//	covering it on first use.  New entries are invalid and have no
+//	copy in the swap file.
+//----------------------------------------------------------------------
+
+TranslationEntry *
+PageTable::Map(int vpn)
+{
+    if (vpn < 0 || vpn >= numPages)
+	return NULL;
+
+    int t = vpn / PTEsPerTable;
+    if (directory[t] == NULL) {
+	directory[t] = new TranslationEntry[PTEsPerTable];
+	for (int j = 0; j < PTEsPerTable; j++) {
+	    TranslationEntry *entry = &directory[t][j];
+	    entry->virtualPage = t * PTEsPerTable + j;
+	    entry->physicalPage = -1;
+	    entry->valid = FALSE;
+	    entry->readOnly = FALSE;
+	    entry->copyOnWrite = FALSE;
+	    entry->use = FALSE;
+	    entry->dirty = FALSE;
+	    entry->lastUseTime = 0;
+	    entry->firstUseTime = 0;
+	    entry->clockUse = 0;
+	    entry->swappingPage = -1;
+	    entry->asid = -1;
+	}
+	numAllocated++;
+    }
+    return &directory[t][vpn % PTEsPerTable];
+}
+
 //----------------------------------------------------------------------
 // Machine::ReadMem
 //      Read "size" (1, 2, or 4) bytes of virtual memory at "addr" into 
@@ -186,7 +265,7 @@ Machine::WriteMem(int addr, int size, int value)
 ExceptionType
 Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 {
-    int i;
+    int i, base;
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
@@ -222,7 +301,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     	}
     	entry = &pageTable[vpn];
     } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
+        for (entry = NULL, i = 0; i < tlbSize; i++)
     	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
     	    	entry = &tlb[i];			// FOUND!
     	    	break;
@@ -235,28 +314,38 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
         }
     }*/
 
-    // check virtAddr
+    // check virtAddr, walking the two-level page table; a missing second
+    // level table means the page was never touched
 	if (vpn >= pageTableSize) {
 	    DEBUG('a', "virtual page # %d too large for page table size %d!\n",
 	    		virtAddr, pageTableSize);
 	    return AddressErrorException;
-	} else if (!pageTable[vpn].valid) {
-	    DEBUG('a', "virtual page # %d too large for page table size %d!\n",
-	    		virtAddr, pageTableSize);
+	}
+	entry = pageTable->Lookup(vpn);
+	if (entry == NULL || !entry->valid) {
+	    DEBUG('a', "virtual page # %d not in memory!\n", vpn);
 	   	return PageFaultException;
  	}
 
     // translate version 1: handle exception TLB pageFault
-    for (entry = NULL, i = 0; i < TLBSize; i++)
-        if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
+    // entries are tagged by asid, so they survive context switches,
+    // and only the ways of the set vpn maps to are searched
+    base = TLBSet(vpn) * tlbWays;
+    for (entry = NULL, i = base; i < base + tlbWays; i++)
+        if (tlb[i].valid && (tlb[i].virtualPage == vpn)
+        		&& (tlb[i].asid == currentASID)) {
         	UpdateTLB(i);				// tlb[i].lastUseTime = stats->totalTicks;
         	entry = &tlb[i];			// FOUND!
         	++stats->numTLBHit;
+        	if (currentSpace != NULL)
+        	    ++currentSpace->numTLBHit;
         	break;
         }
     if (entry == NULL) {				// not found
         DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
         ++stats->numTLBMiss;
+        if (currentSpace != NULL)
+            ++currentSpace->numTLBMiss;
         return PageFaultException;		// really, this is a TLB fault,
     				// the page may be in memory,
     				// but not in the TLB
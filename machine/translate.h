@@ -36,6 +36,8 @@ class TranslationEntry {
 			// (In other words, the entry hasn't been initialized.)
     bool readOnly;	// If this bit is set, the user program is not allowed
 			// to modify the contents of the page.
+    bool copyOnWrite;	// The page is shared after a Fork; readOnly is set
+			// too, and the first write gets a private copy.
     bool use;           // This bit is set by the hardware every time the
 			// page is referenced or modified.
     bool dirty;         // This bit is set by the hardware every time the
@@ -45,6 +47,40 @@ class TranslationEntry {
     int clockUse;		// clock
     int swappingPage; 	// The page number in "disk" (swap file), when valid
     		//bit is false, this field is valid
+    int asid;			// address space id of the owner, only meaningful
+    		// in the TLB, so entries can survive a context switch
+};
+
+// The following class defines a two-level page table.  A virtual page
+// number is split into an index into the top level "directory", and an
+// index into a second level table of PTEsPerTable entries.  Second level
+// tables are only allocated when a page in their range is first mapped,
+// so a sparse address space (code at the bottom, the stack at the top,
+// a heap in between) only pays for the regions it actually touches.
+
+#define PTEsPerTable	32	// entries per second level table
+
+class PageTable {
+  public:
+    PageTable(int size);		// an empty table covering "size" pages
+    ~PageTable();		// free the second level tables
+
+    TranslationEntry *Lookup(int vpn);	// entry for vpn, NULL if no page
+    					// in its range was ever mapped
+    TranslationEntry *Map(int vpn);	// entry for vpn, allocating its
+    					// second level table if need be
+
+    int NumTables() { return numTables; }	// size of the directory
+    TranslationEntry *Table(int t) { return directory[t]; }
+    					// t-th second level table, or NULL;
+    					// entry j maps t * PTEsPerTable + j
+    int NumAllocated() { return numAllocated; }
+
+  private:
+    TranslationEntry **directory;	// top level, numTables pointers
+    int numTables;
+    int numPages;			// vpns beyond this are illegal
+    int numAllocated;			// second level tables in use
 };
 
 #endif
@@ -0,0 +1,436 @@
+// dsm.cc
+//	Routines keeping the distributed shared memory region coherent.
+//	See dsm.h for the protocol.
+//
+//	On every machine, a thread takes the manager's messages: pages it
+//	asked for, and requests to give pages up.  It changes the page
+//	table of the attached process directly, so the frames of the
+//	region are pinned while we hold them; Machine::EvictFrame never
+//	sees them.
+//
+//	On the manager, there is a thread per machine taking its messages.
+//	They hold dirLock while they update the directory and send the
+//	answers, and never wait for anything else, so an ack is always
+//	taken even while requests for the page are queued.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "dsm.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ClientHelper, DirectoryHelper
+// 	Dummy functions because C++ can't indirectly invoke member functions.
+//	"arg" -- for DirectoryHelper, the machine whose messages it takes
+//----------------------------------------------------------------------
+
+static void ClientHelper(int arg)
+{ dsm->ClientLoop(); }
+static void DirectoryHelper(int arg)
+{ dsm->DirectoryLoop(arg); }
+
+//----------------------------------------------------------------------
+// ReceiveAll
+// 	Read exactly "numBytes" from "conn".
+//----------------------------------------------------------------------
+
+static void
+ReceiveAll(Connection *conn, char *into, int numBytes)
+{
+    int done = 0;
+
+    while (done < numBytes)
+	done += conn->Receive(into + done, numBytes - done);
+}
+
+// Does message "m" carry a page?
+static bool
+HasPage(DsmMessage *m)
+{
+    return m->op == DsmData || (m->flag
+		&& (m->op == DsmRecallReply || m->op == DsmRelease));
+}
+
+//----------------------------------------------------------------------
+// Dsm::Dsm
+// 	Connect this machine to the manager.  On the manager, also set
+//	up an empty directory (all pages zero, nobody holding them) and a
+//	Connection to every machine.
+//
+//	The threads started here use the global "dsm", so they must not
+//	run before it is set, which they don't: Fork only makes them ready.
+//
+//	"node" -- this machine
+//	"manager" -- the machine keeping the directory
+//	"numNodes" -- machines sharing the region
+//----------------------------------------------------------------------
+
+Dsm::Dsm(NetworkAddress me, NetworkAddress mgr, int nodes)
+{
+    ASSERT(nodes > 0 && nodes <= MaxDsmNodes);
+    ASSERT(me >= 0 && me < nodes && mgr >= 0 && mgr < nodes);
+    node = me;
+    manager = mgr;
+    numNodes = nodes;
+    space = NULL;
+    faultLock = new Lock("dsm fault lock");
+    granted = new Semaphore("dsm granted", 0);
+    pendingFrame = -1;
+    dirLock = NULL;
+
+    toManager = new Connection(manager, DsmClientBox, DsmDirectoryBox + node,
+			       DsmWindow);
+    Thread *t = Thread::getInstance("dsm client");
+    t->Fork(ClientHelper, 0);
+
+    if (node != manager)
+	return;
+    dirLock = new Lock("dsm directory lock");
+    bzero((char *) home, sizeof(home));
+    for (int i = 0; i < MaxDsmPages; i++) {
+	dir[i].owner = -1;
+	dir[i].sharers = 0;
+	dir[i].busy = FALSE;
+	dir[i].waiting = new List;
+    }
+    for (int n = 0; n < numNodes; n++) {
+	clients[n] = new Connection(n, DsmDirectoryBox + n, DsmClientBox,
+				    DsmWindow);
+	t = Thread::getInstance("dsm directory");
+	t->Fork(DirectoryHelper, n);
+    }
+}
+
+//----------------------------------------------------------------------
+// Dsm::SendMessage
+// 	Send a message, and the page "data" after it if it carries one,
+//	with a single Send so no other thread's message gets in between.
+//----------------------------------------------------------------------
+
+void
+Dsm::SendMessage(Connection *conn, int op, int page, int flag, char *data)
+{
+    char buffer[sizeof(DsmMessage) + PageSize];
+    DsmMessage *m = (DsmMessage *) buffer;
+
+    m->op = op;
+    m->page = page;
+    m->flag = flag;
+    if (HasPage(m))
+	bcopy(data, buffer + sizeof(DsmMessage), PageSize);
+    conn->Send(buffer, sizeof(DsmMessage) + (HasPage(m) ? PageSize : 0));
+}
+
+//----------------------------------------------------------------------
+// Dsm::Attach, Dsm::Detach
+// 	Only one process per machine has the region, and not while an
+//	Mmap region of it lies where the DSM region goes.  When it exits,
+//	a page it could write goes back to the manager; the others are
+//	just dropped, the manager only has to forget it had them.
+//----------------------------------------------------------------------
+
+bool
+Dsm::Attach(AddrSpace *s)
+{
+    if (space != NULL)
+	return FALSE;
+    for (int vpn = s->DsmBase(); vpn < s->DsmBase() + MaxDsmPages; vpn++)
+	if (s->IsMappedPage(vpn))
+	    return FALSE;
+    space = s;
+    space->SetDsmAttached(TRUE);
+    DEBUG('n', "DSM: node %d of %d, region at vpn %d-%d\n", node, numNodes,
+	  space->DsmBase(), space->DsmBase() + MaxDsmPages - 1);
+    return TRUE;
+}
+
+void
+Dsm::Detach(AddrSpace *s)
+{
+    if (space != s)
+	return;
+    faultLock->Acquire();
+    for (int page = 0; page < MaxDsmPages; page++) {
+	TranslationEntry *pte = space->GetPTE(space->DsmBase() + page);
+
+	if (pte == NULL || !pte->valid)
+	    continue;
+	SendMessage(toManager, DsmRelease, page, !pte->readOnly,
+		    &machine->mainMemory[pte->physicalPage * PageSize]);
+	Drop(page);
+    }
+    space->SetDsmAttached(FALSE);
+    space = NULL;
+    faultLock->Release();
+}
+
+//----------------------------------------------------------------------
+// Dsm::Fault
+// 	Called from Machine::SwapPage (read) and AddrSpace::CopyOnWrite
+//	(write) for a page of the region.  Get a pinned frame for the
+//	page, ask the manager for it, and wait until the client thread
+//	has put it in the frame.  A write on a read-only copy gets a new
+//	frame too: the old copy may be invalidated before our turn comes.
+//----------------------------------------------------------------------
+
+bool
+Dsm::Fault(AddrSpace *s, int vpn, bool writing)
+{
+    int page = vpn - s->DsmBase();
+    TranslationEntry *pte;
+
+    ASSERT(s == space && page >= 0 && page < MaxDsmPages);
+    faultLock->Acquire();
+    pte = space->GetPTE(vpn);
+    ASSERT(pte != NULL);		// the caller has mapped it
+    if (pte->valid && (!writing || !pte->readOnly)) {
+	faultLock->Release();		// someone got it meanwhile
+	return TRUE;
+    }
+
+    pendingFrame = machine->AllocFrame(vpn);
+    if (pendingFrame < 0) {
+	faultLock->Release();
+	return FALSE;
+    }
+    memManager->Pin(pendingFrame);
+    if (writing)
+	stats->numDsmWriteFaults++;
+    else
+	stats->numDsmReadFaults++;
+    SendMessage(toManager, writing ? DsmWriteReq : DsmReadReq, page, 0, NULL);
+    granted->P();
+    faultLock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Dsm::Drop
+// 	Free our copy of "page": unpin its frame and let ReleasePages
+//	give it back, so the next touch faults.
+//----------------------------------------------------------------------
+
+void
+Dsm::Drop(int page)
+{
+    int vpn = space->DsmBase() + page;
+    TranslationEntry *pte = space->GetPTE(vpn);
+
+    if (pte == NULL || !pte->valid)
+	return;
+    machine->FlushTLBPage(space->GetASID(), vpn);
+    memManager->Unpin(pte->physicalPage);
+    space->ReleasePages(vpn, vpn + 1);
+}
+
+//----------------------------------------------------------------------
+// Dsm::ClientLoop
+// 	Take the manager's messages.  A page we asked for goes into the
+//	pending frame, replacing the read-only copy we may still have.
+//	An Invalidate or Recall for a page we no longer have (the process
+//	exited, and sent it back already) is answered without a page.
+//----------------------------------------------------------------------
+
+void
+Dsm::ClientLoop()
+{
+    DsmMessage m;
+    char data[PageSize];
+
+    for (;;) {
+	ReceiveAll(toManager, (char *) &m, sizeof(DsmMessage));
+	if (HasPage(&m))
+	    ReceiveAll(toManager, data, PageSize);
+
+	int vpn = (space != NULL) ? space->DsmBase() + m.page : -1;
+	TranslationEntry *pte = (space != NULL) ? space->GetPTE(vpn) : NULL;
+	bool present = (pte != NULL && pte->valid);
+
+	switch (m.op) {
+	  case DsmData:
+	    ASSERT(space != NULL && pendingFrame >= 0);
+	    Drop(m.page);
+	    bcopy(data, &machine->mainMemory[pendingFrame * PageSize],
+		  PageSize);
+	    pte = space->GetPTE(vpn);
+	    pte->physicalPage = pendingFrame;
+	    pte->valid = TRUE;
+	    pte->readOnly = !m.flag;
+	    pte->copyOnWrite = FALSE;
+	    pte->use = FALSE;
+	    pte->dirty = FALSE;
+	    pendingFrame = -1;
+	    granted->V();
+	    break;
+	  case DsmInvalidate:
+	    if (present) {
+		Drop(m.page);
+		stats->numDsmInvalidations++;
+	    }
+	    SendMessage(toManager, DsmInvalAck, m.page, 0, NULL);
+	    break;
+	  case DsmRecall:
+	    if (!present) {
+		SendMessage(toManager, DsmRecallReply, m.page, 0, NULL);
+		break;
+	    }
+	    // no more writes through the TLB from here on
+	    machine->FlushTLBPage(space->GetASID(), vpn);
+	    SendMessage(toManager, DsmRecallReply, m.page, 1,
+			&machine->mainMemory[pte->physicalPage * PageSize]);
+	    if (m.flag)
+		pte->readOnly = TRUE;
+	    else
+		Drop(m.page);
+	    stats->numDsmInvalidations++;
+	    break;
+	  default:
+	    ASSERT(FALSE);
+	}
+    }
+}
+
+//----------------------------------------------------------------------
+// Dsm::DirectoryLoop
+// 	On the manager, take the messages of machine "from".
+//----------------------------------------------------------------------
+
+void
+Dsm::DirectoryLoop(int from)
+{
+    DsmMessage m;
+    char data[PageSize];
+    unsigned bit = 1 << from;
+
+    for (;;) {
+	ReceiveAll(clients[from], (char *) &m, sizeof(DsmMessage));
+	if (HasPage(&m))
+	    ReceiveAll(clients[from], data, PageSize);
+	ASSERT(m.page >= 0 && m.page < MaxDsmPages);
+
+	DsmDirEntry *e = &dir[m.page];
+	dirLock->Acquire();
+	switch (m.op) {
+	  case DsmReadReq:
+	  case DsmWriteReq:
+	    Request(from, m.page, m.op == DsmWriteReq);
+	    break;
+	  case DsmInvalAck:
+	    e->sharers &= ~bit;
+	    Ack(m.page);
+	    break;
+	  case DsmRecallReply:
+	    if (m.flag)
+		bcopy(data, home[m.page], PageSize);
+	    if (e->owner == from)
+		e->owner = -1;
+	    if (m.flag && e->recallKeep)
+		e->sharers |= bit;
+	    else
+		e->sharers &= ~bit;
+	    Ack(m.page);
+	    break;
+	  case DsmRelease:
+	    if (m.flag)
+		bcopy(data, home[m.page], PageSize);
+	    if (e->owner == from)
+		e->owner = -1;
+	    e->sharers &= ~bit;
+	    break;
+	  default:
+	    ASSERT(FALSE);
+	}
+	dirLock->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// Dsm::Request
+// 	Machine "from" wants "page"; if the page is busy, it waits its
+//	turn.  Called with dirLock held.
+//----------------------------------------------------------------------
+
+void
+Dsm::Request(int from, int page, bool writing)
+{
+    DsmDirEntry *e = &dir[page];
+
+    if (e->busy)
+	e->waiting->Append((void *) new DsmWaiter(from, writing));
+    else
+	Begin(from, page, writing);
+}
+
+//----------------------------------------------------------------------
+// Dsm::Begin
+// 	Take "page" back from whoever must give it up for the request,
+//	and grant it right away if that's nobody.
+//----------------------------------------------------------------------
+
+void
+Dsm::Begin(int from, int page, bool writing)
+{
+    DsmDirEntry *e = &dir[page];
+
+    e->requester = from;
+    e->requestWrite = writing;
+    e->acksLeft = 0;
+    if (e->owner >= 0 && e->owner != from) {
+	e->recallKeep = !writing;
+	SendMessage(clients[e->owner], DsmRecall, page, e->recallKeep, NULL);
+	e->acksLeft++;
+    }
+    if (writing)
+	for (int n = 0; n < numNodes; n++)
+	    if ((e->sharers & (1 << n)) && n != from && n != e->owner) {
+		SendMessage(clients[n], DsmInvalidate, page, 0, NULL);
+		e->acksLeft++;
+	    }
+
+    if (e->acksLeft == 0)
+	Grant(page);
+    else
+	e->busy = TRUE;
+}
+
+// One of the answers Begin waits for has come in.
+void
+Dsm::Ack(int page)
+{
+    DsmDirEntry *e = &dir[page];
+
+    ASSERT(e->busy && e->acksLeft > 0);
+    if (--e->acksLeft == 0)
+	Grant(page);
+}
+
+//----------------------------------------------------------------------
+// Dsm::Grant
+// 	Send the home copy of "page" to the requester, note who has it
+//	now, and start on the next waiting request.
+//----------------------------------------------------------------------
+
+void
+Dsm::Grant(int page)
+{
+    DsmDirEntry *e = &dir[page];
+    int from = e->requester;
+
+    if (e->requestWrite) {
+	e->owner = from;
+	e->sharers = 1 << from;
+    } else
+	e->sharers |= 1 << from;
+    SendMessage(clients[from], DsmData, page, e->requestWrite, home[page]);
+
+    e->busy = FALSE;
+    if (!e->waiting->IsEmpty()) {
+	DsmWaiter *next = (DsmWaiter *) e->waiting->Remove();
+
+	Begin(next->node, page, next->writing);
+	delete next;
+    }
+}
@@ -0,0 +1,123 @@
+// dsm.h
+//	Distributed shared memory: a region of MaxDsmPages pages, at the
+//	same place in the address space of one process on each of several
+//	Nachos machines, kept coherent over the network.
+//
+//	Each page is either held writable by a single machine (its owner)
+//	or read-only by any number of machines (its sharers).  A manager
+//	machine keeps the directory of who holds which page, and the home
+//	copy of the page.  A page fault sends a request to the manager,
+//	which first takes the page back from the owner (Recall) or, for a
+//	write, has every sharer throw its copy away (Invalidate); only when
+//	they all have answered does it send the page to the requester.
+//	Requests for a page that is in the middle of this wait their turn.
+//
+//	A write fault on a page that isn't there yet first brings it in
+//	read-only, the write then faults again and asks for ownership.
+//
+//	Each machine talks to the manager over a Connection (transport.h),
+//	the manager itself too, so messages are reliable and in order.
+//	Machines are numbered 0 to numNodes - 1, as given by -m.
+
+#ifndef DSM_H
+#define DSM_H
+
+#include "copyright.h"
+#include "transport.h"
+#include "addrspace.h"
+#include "machine.h"
+#include "list.h"
+
+#define MaxDsmNodes	6	// machines sharing the region, at most
+#define DsmClientBox	3	// mailbox of a machine's Connection
+#define DsmDirectoryBox	4	// manager's mailbox for machine n is
+				// DsmDirectoryBox + n
+#define DsmWindow	8	// of the Connections
+
+enum DsmOp {
+    DsmReadReq, DsmWriteReq,	// machine to manager, on a fault
+    DsmData,			// manager to machine: here's the page,
+				//   "flag" says writable
+    DsmInvalidate, DsmInvalAck,	// drop your read-only copy
+    DsmRecall, DsmRecallReply,	// send back your writable copy, keep a
+				//   read-only one if "flag"; the reply
+				//   has the page if "flag"
+    DsmRelease			// the process exits; the page follows
+				//   if "flag", it was writable
+};
+
+// Sent ahead of every message, and followed by the page for DsmData,
+// and for DsmRecallReply and DsmRelease when "flag" is set.
+struct DsmMessage {
+    int op;
+    int page;			// 0 to MaxDsmPages - 1
+    int flag;
+};
+
+// What the manager knows about a page.
+struct DsmDirEntry {
+    int owner;			// machine with the writable copy, or -1
+    unsigned sharers;		// bit per machine with a read-only copy
+    bool busy;			// waiting for acks to the request of
+    int requester;		//   "requester"
+    bool requestWrite;
+    bool recallKeep;		// our Recall let the owner keep a copy
+    int acksLeft;
+    List *waiting;		// DsmWaiters, the requests that
+				//   arrived meanwhile
+};
+
+// A request waiting for its page to be free.
+struct DsmWaiter {
+    DsmWaiter(int n, bool w) { node = n; writing = w; }
+    int node;
+    bool writing;
+};
+
+class Dsm {
+  public:
+    Dsm(NetworkAddress node, NetworkAddress manager, int numNodes);
+				// start this machine's part, and the
+				// directory if we are "manager"
+
+    bool Attach(AddrSpace *space);	// give "space" the region;
+					// FALSE if another has it
+    void Detach(AddrSpace *space);	// at exit, hand its pages back
+    bool Fault(AddrSpace *space, int vpn, bool writing);
+				// bring page "vpn" of the region in,
+				// writable if "writing"; FALSE if no
+				// memory is left
+    int GetNode() { return node; }
+    int GetNumNodes() { return numNodes; }
+
+    void ClientLoop();		// body of the thread taking the
+				// manager's messages
+    void DirectoryLoop(int from);	// body of the manager's thread
+				// for the messages of machine "from"
+
+  private:
+    void SendMessage(Connection *conn, int op, int page, int flag,
+		     char *data);
+    void Drop(int page);	// free our copy of "page"
+
+    NetworkAddress node, manager;
+    int numNodes;
+    Connection *toManager;
+    AddrSpace *space;		// attached process, or NULL
+    Lock *faultLock;		// one fault at a time
+    Semaphore *granted;		// V'ed when the page we asked for is in
+    int pendingFrame;		// where it goes
+
+    // on the manager only
+    void Request(int from, int page, bool writing);
+    void Begin(int from, int page, bool writing);
+    void Ack(int page);
+    void Grant(int page);
+
+    Connection *clients[MaxDsmNodes];
+    DsmDirEntry dir[MaxDsmPages];
+    char home[MaxDsmPages][PageSize];
+    Lock *dirLock;		// guards dir and home
+};
+
+#endif // DSM_H
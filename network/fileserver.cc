@@ -0,0 +1,721 @@
+// fileserver.cc
+//	Routines to serve the file system to other machines, and to use
+//	it from them with a leased block cache.  See fileserver.h.
+//
+//	On the server, a thread per client takes its messages: a revoke
+//	ack is counted right away, requests go to a second thread that
+//	serves them.  So an ack is never stuck behind a request that
+//	waits for acks itself, e.g. two clients writing the same file.
+//
+//	On the client, one thread takes the server's messages: replies
+//	wake up the waiting caller, revokes are answered right away.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "fileserver.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ServerReceiveHelper, ServerServeHelper, ClientReceiveHelper
+// 	Dummy functions because C++ can't indirectly invoke member functions.
+//	They use the globals, which are set before the threads run.
+//
+//	"arg" -- for the server, the client whose messages it takes
+//----------------------------------------------------------------------
+
+static void ServerReceiveHelper(int arg)
+{ fileServer->ReceiveLoop(arg); }
+static void ServerServeHelper(int arg)
+{ fileServer->ServeLoop(arg); }
+static void ClientReceiveHelper(int arg)
+{ fileClient->ReceiveLoop(); }
+
+// Does message "m" have data after it?
+static bool
+HasData(FsMessage *m)
+{
+    return m->op == FsCreate || m->op == FsOpen || m->op == FsWrite
+		|| m->op == FsReadReply;
+}
+
+//----------------------------------------------------------------------
+// ReceiveMessage, SendMessage
+// 	Move a message and its data over "conn".  Data beyond FsMaxData
+//	is refused by the sender, so "data" always has room.
+//----------------------------------------------------------------------
+
+static void
+ReceiveAll(Connection *conn, char *into, int numBytes)
+{
+    int done = 0;
+
+    while (done < numBytes)
+	done += conn->Receive(into + done, numBytes - done);
+}
+
+static void
+ReceiveMessage(Connection *conn, FsMessage *m, char *data)
+{
+    ReceiveAll(conn, (char *) m, sizeof(FsMessage));
+    if (HasData(m)) {
+	ASSERT(m->length >= 0 && m->length <= FsMaxData);
+	ReceiveAll(conn, data, m->length);
+    }
+}
+
+static void
+SendMessage(Connection *conn, FsMessage *m, char *data)
+{
+    char buffer[sizeof(FsMessage) + FsMaxData];
+    int length = sizeof(FsMessage);
+
+    if (HasData(m)) {
+	ASSERT(m->length >= 0 && m->length <= FsMaxData);
+	bcopy(data, buffer + length, m->length);
+	length += m->length;
+    }
+    bcopy((char *) m, buffer, sizeof(FsMessage));
+    conn->Send(buffer, length);		// one Send, nothing gets between
+}
+
+//----------------------------------------------------------------------
+// FileServer::FileServer
+// 	Set up a Connection to every possible client, and the threads
+//	taking and serving their messages.
+//----------------------------------------------------------------------
+
+FileServer::FileServer()
+{
+    lock = new Lock("file server lock");
+    revoked = new Condition("lease revoked");
+    for (int i = 0; i < MaxFsOpenFiles; i++)
+	files[i] = NULL;
+    for (int i = 0; i < MaxFsLeases; i++)
+	leases[i].fileId = -1;
+
+    for (int c = 0; c < MaxFsClients; c++) {
+	clients[c] = new Connection(c, FsServerBox + c, FsClientBox, FsWindow);
+	requests[c] = new SynchList;
+	Thread *t = Thread::getInstance("file server receiver");
+	t->Fork(ServerReceiveHelper, c);
+	t = Thread::getInstance("file server");
+	t->Fork(ServerServeHelper, c);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileServer::ReceiveLoop
+// 	Take the messages of "client": count revoke acks, queue requests.
+//----------------------------------------------------------------------
+
+void
+FileServer::ReceiveLoop(int client)
+{
+    for (;;) {
+	FsMessage *m = (FsMessage *) new char[sizeof(FsMessage) + FsMaxData];
+
+	ReceiveMessage(clients[client], m, (char *) (m + 1));
+	if (m->op != FsRevokeAck) {
+	    requests[client]->Append((void *) m);
+	    continue;
+	}
+	lock->Acquire();
+	FsLease *l = FindLease(m->fileId, FALSE);
+	if (l != NULL && l->acksPending > 0) {
+	    l->acksPending--;
+	    revoked->Broadcast(lock);
+	}
+	lock->Release();
+	delete [] (char *) m;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileServer::ServeLoop
+// 	Serve the requests of "client", in order.
+//----------------------------------------------------------------------
+
+void
+FileServer::ServeLoop(int client)
+{
+    for (;;) {
+	FsMessage *m = (FsMessage *) requests[client]->Remove();
+
+	Serve(client, m);
+	delete [] (char *) m;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileServer::FindLease
+// 	The lease entry of "fileId", or NULL.  If "create", make one when
+//	there is none, reusing an entry nobody holds.  Called with the
+//	lock held.
+//----------------------------------------------------------------------
+
+FsLease *
+FileServer::FindLease(int fileId, bool create)
+{
+    FsLease *free = NULL;
+
+    for (int i = 0; i < MaxFsLeases; i++) {
+	if (leases[i].fileId == fileId)
+	    return &leases[i];
+	if (free == NULL && (leases[i].fileId == -1
+			|| (leases[i].holders == 0 && leases[i].acksPending == 0)))
+	    free = &leases[i];
+    }
+    if (!create || free == NULL)
+	return NULL;
+    free->fileId = fileId;
+    free->holders = 0;
+    free->acksPending = 0;
+    return free;
+}
+
+//----------------------------------------------------------------------
+// FileServer::Revoke
+// 	Take the leases on "fileId" from every client but "client", and
+//	wait until they all have dropped their cached blocks.  The lock is
+//	let go while we wait, so a reader may pick up a lease meanwhile;
+//	we go around until nobody else holds one.  Called with the lock
+//	held, returns with it held.
+//----------------------------------------------------------------------
+
+void
+FileServer::Revoke(int client, int fileId)
+{
+    FsLease *l;
+    unsigned others;
+
+    while ((l = FindLease(fileId, FALSE)) != NULL
+		&& (others = l->holders & ~(1 << client)) != 0) {
+	FsMessage m;
+
+	m.op = FsRevoke;
+	m.fileId = fileId;
+	for (int c = 0; c < MaxFsClients; c++)
+	    if (others & (1 << c)) {
+		SendMessage(clients[c], &m, NULL);
+		l->acksPending++;
+		stats->numLeaseRevokes++;
+	    }
+	l->holders &= ~others;
+	while (l->acksPending > 0)
+	    revoked->Wait(lock);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileServer::Reply
+// 	Answer "client"; a reply about an open file carries its id and
+//	length, and grants the client a lease on it.  Called with the
+//	lock held.
+//----------------------------------------------------------------------
+
+void
+FileServer::Reply(int client, int op, int result, OpenFile *file,
+		  char *data, int length)
+{
+    FsMessage m;
+
+    m.op = op;
+    m.result = result;
+    m.length = length;
+    m.fileId = -1;
+    m.fileLength = 0;
+    if (file != NULL) {
+	FsLease *l = FindLease(file->GetHdrSector(), TRUE);
+
+	m.fileId = file->GetHdrSector();
+	m.fileLength = file->Length();
+	if (l != NULL)
+	    l->holders |= 1 << client;
+	else
+	    m.fileId = -1;		// no room to track it: don't cache
+    }
+    SendMessage(clients[client], &m, data);
+}
+
+//----------------------------------------------------------------------
+// FileServer::Serve
+// 	Carry out request "m" of "client" on our file system.  Reads and
+//	writes hold the lock, so no read sees a write halfway, and no
+//	lease is granted on data a write is about to change.
+//----------------------------------------------------------------------
+
+void
+FileServer::Serve(int client, FsMessage *m)
+{
+    char *data = (char *) (m + 1);
+    char name[FsMaxName];
+    OpenFile *file = NULL;
+    int n;
+
+    lock->Acquire();
+    if (m->op == FsCreate || m->op == FsOpen) {
+	n = min(m->length, FsMaxName - 1);
+	bcopy(data, name, n);
+	name[n] = '\0';
+    } else if (m->handle < 0 || m->handle >= MaxFsOpenFiles
+			|| files[m->handle] == NULL) {
+	Reply(client, FsReply, -1, NULL, NULL, 0);
+	lock->Release();
+	return;
+    } else
+	file = files[m->handle];
+
+    switch (m->op) {
+      case FsCreate:
+	Reply(client, FsReply, fileSystem->Create(name, m->position) ? 0 : -1,
+	      NULL, NULL, 0);
+	break;
+      case FsOpen:
+	n = -1;
+	for (int i = 0; i < MaxFsOpenFiles && n < 0; i++)
+	    if (files[i] == NULL)
+		n = i;
+	if (n >= 0)
+	    file = files[n] = fileSystem->Open(name);
+	if (file == NULL)
+	    n = -1;
+	Reply(client, FsReply, n, file, NULL, 0);
+	break;
+      case FsRead:
+	n = file->ReadAt(data, min(m->length, FsMaxData), m->position);
+	Reply(client, FsReadReply, n, file, data, max(n, 0));
+	break;
+      case FsWrite:
+	Revoke(client, file->GetHdrSector());
+	n = file->WriteAt(data, m->length, m->position);
+	Reply(client, FsReply, n, file, NULL, 0);
+	break;
+      case FsClose:
+	delete file;
+	files[m->handle] = NULL;
+	Reply(client, FsReply, 0, NULL, NULL, 0);
+	break;
+      default:
+	Reply(client, FsReply, -1, NULL, NULL, 0);
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// FileClient::FileClient
+// 	Connect to the file server on machine "server", with an empty
+//	cache.
+//----------------------------------------------------------------------
+
+FileClient::FileClient(NetworkAddress serverAddr)
+{
+    ASSERT(postOffice != NULL);
+    callLock = new Lock("file client call lock");
+    replied = new Semaphore("file client replied", 0);
+    cacheLock = new Lock("file client cache lock");
+    for (int i = 0; i < FsCacheBlocks; i++)
+	cache[i].fileId = -1;
+    for (int i = 0; i < MaxFsLeases; i++)
+	leases[i].fileId = -1;
+
+    server = new Connection(serverAddr, FsClientBox, FsServerBox, FsWindow);
+    Thread *t = Thread::getInstance("file client receiver");
+    t->Fork(ClientReceiveHelper, 0);
+}
+
+//----------------------------------------------------------------------
+// FileClient::ReceiveLoop
+// 	Take the server's messages.  A reply goes to the caller waiting
+//	for it; a revoke drops the file from the cache and is answered.
+//
+//	The lease and the blocks a reply brings are put in the cache
+//	here, before the caller runs: a revoke the server sends after
+//	the reply is handled after them, so it always finds them to drop.
+//----------------------------------------------------------------------
+
+void
+FileClient::ReceiveLoop()
+{
+    FsMessage m;
+    char data[FsMaxData];
+
+    for (;;) {
+	ReceiveMessage(server, &m, data);
+	if (m.op == FsRevoke) {
+	    Drop(m.fileId);
+	    m.op = FsRevokeAck;
+	    SendMessage(server, &m, NULL);
+	    continue;
+	}
+	reply = m;
+	if (HasData(&m))
+	    bcopy(data, replyData, m.length);
+	if (m.fileId >= 0)
+	    Settle(&m, data);
+	replied->V();
+    }
+}
+
+//----------------------------------------------------------------------
+// FileClient::Call
+// 	Send a request and wait for the reply, which is put in "*r"; the
+//	data of a read reply goes to "into".  Returns the result.
+//----------------------------------------------------------------------
+
+int
+FileClient::Call(int op, int handle, int position, char *data, int length,
+		 char *into, FsMessage *r)
+{
+    callLock->Acquire();
+    request.op = op;
+    request.handle = handle;
+    request.position = position;
+    request.length = length;
+    requestData = data;
+    sentAt = stats->totalTicks;
+    SendMessage(server, &request, data);
+    replied->P();
+    *r = reply;
+    if (into != NULL && r->op == FsReadReply)
+	bcopy(replyData, into, r->length);
+    callLock->Release();
+    stats->numRemoteCalls++;
+    return r->result;
+}
+
+//----------------------------------------------------------------------
+// FileClient::Settle
+// 	A reply "r" about file "r->fileId" to "request" came in, with
+//	"data".  Take the lease, and bring the cache up to date: a whole
+//	block read goes in (in place of the least recently used), the
+//	bytes written go into the blocks we have.
+//----------------------------------------------------------------------
+
+void
+FileClient::Settle(FsMessage *r, char *data)
+{
+    Granted(r);
+
+    cacheLock->Acquire();
+    if (request.op == FsRead && r->op == FsReadReply && r->result >= 0
+	    && request.length == FsBlockSize) {
+	int block = request.position / FsBlockSize;
+	FsCacheBlock *b = FindBlock(r->fileId, block);
+
+	for (int i = 0; i < FsCacheBlocks && b == NULL; i++)
+	    if (cache[i].fileId == -1)
+		b = &cache[i];
+	if (b == NULL) {		// the least recently used
+	    b = &cache[0];
+	    for (int i = 1; i < FsCacheBlocks; i++)
+		if (cache[i].lastUse < b->lastUse)
+		    b = &cache[i];
+	}
+	b->fileId = r->fileId;
+	b->block = block;
+	b->lastUse = stats->totalTicks;
+	bcopy(data, b->data, r->result);
+	bzero(b->data + r->result, FsBlockSize - r->result);
+    } else if (request.op == FsWrite && r->result > 0) {
+	for (int i = 0; i < r->result; ) {
+	    int pos = request.position + i;
+	    int offset = pos % FsBlockSize;
+	    int k = min(r->result - i, FsBlockSize - offset);
+	    FsCacheBlock *b = FindBlock(r->fileId, pos / FsBlockSize);
+
+	    if (b != NULL)
+		bcopy(requestData + i, b->data + offset, k);
+	    i += k;
+	}
+    }
+    cacheLock->Release();
+}
+
+//----------------------------------------------------------------------
+// FileClient::Granted
+// 	A reply about file "r->fileId" came in: we hold a lease on it
+//	now, counted from when we asked, the earliest the server can
+//	have granted it.
+//----------------------------------------------------------------------
+
+void
+FileClient::Granted(FsMessage *r)
+{
+    FsClientLease *l = NULL;
+
+    cacheLock->Acquire();
+    for (int i = 0; i < MaxFsLeases && l == NULL; i++)
+	if (leases[i].fileId == r->fileId)
+	    l = &leases[i];
+    for (int i = 0; i < MaxFsLeases && l == NULL; i++)
+	if (leases[i].fileId == -1 || leases[i].expires <= stats->totalTicks)
+	    l = &leases[i];
+    if (l != NULL) {
+	if (l->fileId != r->fileId) {
+	    int old = l->fileId;
+
+	    l->fileId = -1;		// its blocks can't be trusted
+	    cacheLock->Release();	// any more
+	    Drop(old);
+	    cacheLock->Acquire();
+	}
+	l->fileId = r->fileId;
+	l->expires = sentAt + LeaseTime;
+	l->fileLength = r->fileLength;
+    }
+    cacheLock->Release();
+}
+
+// The lease we hold on "fileId" if it hasn't run out, else NULL.
+// Called with cacheLock held.
+FsClientLease *
+FileClient::FindLease(int fileId)
+{
+    for (int i = 0; i < MaxFsLeases; i++)
+	if (leases[i].fileId == fileId)
+	    return leases[i].expires > stats->totalTicks ? &leases[i] : NULL;
+    return NULL;
+}
+
+// Block "block" of "fileId" if it is cached, else NULL.
+// Called with cacheLock held.
+FsCacheBlock *
+FileClient::FindBlock(int fileId, int block)
+{
+    for (int i = 0; i < FsCacheBlocks; i++)
+	if (cache[i].fileId == fileId && cache[i].block == block)
+	    return &cache[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// FileClient::Drop
+// 	Forget the lease on "fileId", and its cached blocks.
+//----------------------------------------------------------------------
+
+void
+FileClient::Drop(int fileId)
+{
+    cacheLock->Acquire();
+    for (int i = 0; i < MaxFsLeases; i++)
+	if (leases[i].fileId == fileId)
+	    leases[i].fileId = -1;
+    for (int i = 0; i < FsCacheBlocks; i++)
+	if (cache[i].fileId == fileId)
+	    cache[i].fileId = -1;
+    cacheLock->Release();
+}
+
+//----------------------------------------------------------------------
+// FileClient::Create, Open, Close
+// 	Like the FileSystem and OpenFile calls, on the server's file
+//	system.  Open returns the server's handle for the file, and its
+//	id for the cache in "*fileId".
+//----------------------------------------------------------------------
+
+bool
+FileClient::Create(char *name, int initialSize)
+{
+    FsMessage r;
+
+    return Call(FsCreate, -1, initialSize, name, strlen(name) + 1,
+		NULL, &r) == 0;
+}
+
+int
+FileClient::Open(char *name, int *fileId)
+{
+    FsMessage r;
+    int handle = Call(FsOpen, -1, 0, name, strlen(name) + 1, NULL, &r);
+
+    *fileId = r.fileId;
+    return handle;
+}
+
+void
+FileClient::Close(int handle)
+{
+    FsMessage r;
+
+    Call(FsClose, handle, 0, NULL, 0, NULL, &r);
+}
+
+//----------------------------------------------------------------------
+// FileClient::Length
+// 	The length of the file, from the lease if we have one.
+//----------------------------------------------------------------------
+
+int
+FileClient::Length(int handle, int fileId)
+{
+    FsMessage r;
+    FsClientLease *l;
+
+    cacheLock->Acquire();
+    l = FindLease(fileId);
+    if (l != NULL) {
+	int length = l->fileLength;
+
+	cacheLock->Release();
+	return length;
+    }
+    cacheLock->Release();
+    Call(FsRead, handle, 0, NULL, 0, NULL, &r);
+    return r.fileLength;
+}
+
+//----------------------------------------------------------------------
+// FileClient::Read
+// 	Read "numBytes" at "position" a block at a time: from the cache
+//	while we hold a lease on the file, else from the server, which
+//	leaves the block in the cache for next time (see Settle).
+//	Returns the number of bytes read.
+//----------------------------------------------------------------------
+
+int
+FileClient::Read(int handle, int fileId, char *into, int numBytes,
+		 int position)
+{
+    int done = 0;
+
+    while (done < numBytes) {
+	int pos = position + done;
+	int block = pos / FsBlockSize;
+	int offset = pos % FsBlockSize;
+	int n = min(numBytes - done, FsBlockSize - offset);
+	FsCacheBlock *b = NULL;
+	FsClientLease *l;
+
+	cacheLock->Acquire();
+	l = FindLease(fileId);
+	if (fileId >= 0 && l != NULL && (b = FindBlock(fileId, block)) != NULL) {
+	    n = min(n, l->fileLength - pos);
+	    if (n > 0)
+		bcopy(b->data + offset, into + done, n);
+	    b->lastUse = stats->totalTicks;
+	    cacheLock->Release();
+	    stats->numRemoteCacheHits++;
+	    if (n <= 0)
+		break;
+	    done += n;
+	    continue;
+	}
+	cacheLock->Release();
+
+	FsMessage r;
+	char data[FsBlockSize];
+	int got = Call(FsRead, handle, block * FsBlockSize, NULL, FsBlockSize,
+		       data, &r);
+
+	stats->numRemoteCacheMisses++;
+	if (got < 0)
+	    return done > 0 ? done : -1;
+	n = min(n, got - offset);
+	if (n <= 0)
+	    break;
+	bcopy(data + offset, into + done, n);
+	done += n;
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// FileClient::Write
+// 	Write through to the server, FsMaxData at a time; each reply
+//	updates the blocks we have cached (see Settle).  The server has
+//	revoked everybody else's lease by the time it answers.  Returns
+//	the number of bytes written.
+//----------------------------------------------------------------------
+
+int
+FileClient::Write(int handle, char *from, int numBytes, int position)
+{
+    int done = 0;
+
+    while (done < numBytes) {
+	FsMessage r;
+	int n = min(numBytes - done, FsMaxData);
+	int wrote = Call(FsWrite, handle, position + done, from + done, n,
+			 NULL, &r);
+
+	if (wrote <= 0)
+	    break;
+	done += wrote;
+    }
+    return done;
+}
+
+//----------------------------------------------------------------------
+// RemoteFile::RemoteFile, RemoteFile::~RemoteFile, RemoteFile::Open
+// 	A file opened through the FileClient, and closed on the server
+//	when deleted.
+//----------------------------------------------------------------------
+
+RemoteFile::RemoteFile(int h, int id)
+{
+    handle = h;
+    fileId = id;
+    seekPosition = 0;
+}
+
+RemoteFile::~RemoteFile()
+{
+    fileClient->Close(handle);
+}
+
+RemoteFile *
+RemoteFile::Open(char *name)
+{
+    int id;
+    int h = fileClient->Open(name, &id);
+
+    if (h < 0)
+	return NULL;
+    return new RemoteFile(h, id);
+}
+
+//----------------------------------------------------------------------
+// RemoteFile::Read, Write, ReadAt, WriteAt, Length
+// 	As in OpenFile.
+//----------------------------------------------------------------------
+
+int
+RemoteFile::Read(char *into, int numBytes)
+{
+    int n = ReadAt(into, numBytes, seekPosition);
+
+    if (n > 0)
+	seekPosition += n;
+    return n;
+}
+
+int
+RemoteFile::Write(char *from, int numBytes)
+{
+    int n = WriteAt(from, numBytes, seekPosition);
+
+    if (n > 0)
+	seekPosition += n;
+    return n;
+}
+
+int
+RemoteFile::ReadAt(char *into, int numBytes, int position)
+{
+    return fileClient->Read(handle, fileId, into, numBytes, position);
+}
+
+int
+RemoteFile::WriteAt(char *from, int numBytes, int position)
+{
+    return fileClient->Write(handle, from, numBytes, position);
+}
+
+int
+RemoteFile::Length()
+{
+    return fileClient->Length(handle, fileId);
+}
@@ -0,0 +1,174 @@
+// fileserver.h
+//	Sharing one Nachos file system among several Nachos machines.
+//
+//	The machine with the DISK runs a FileServer, which serves Create,
+//	Open, Read, Write and Close requests of the other machines out of
+//	its fileSystem.  Every other machine (and the server itself, if
+//	it wants) runs a FileClient, and opens RemoteFiles through it.
+//	Each client talks to the server over a Connection (transport.h).
+//
+//	Clients cache the file blocks they read.  A block may be served
+//	from the cache only while the client holds a lease on the file:
+//	any reply about the file grants one, good for LeaseTime ticks of
+//	the client's clock.  Before the server lets a client write a file,
+//	it revokes the leases of all the other clients that have read it,
+//	and waits until they have dropped their cached blocks; the writer
+//	keeps its lease and updates its own cache.  (The machines' clocks
+//	don't agree, so the server can't simply wait for leases to run
+//	out; the lease term only bounds how long a client trusts its
+//	cache without hearing from the server.)
+
+#ifndef FILESERVER_H
+#define FILESERVER_H
+
+#include "copyright.h"
+#include "transport.h"
+#include "synchlist.h"
+#include "openfile.h"
+
+#define MaxFsClients	4	// machines 0 to MaxFsClients - 1
+#define FsClientBox	10	// mailbox of a client's Connection
+#define FsServerBox	11	// server's mailbox for machine n is
+				// FsServerBox + n
+#define FsWindow	8	// of the Connections
+#define FsBlockSize	SectorSize	// unit of caching
+#define FsMaxData	(4 * FsBlockSize)	// data in one message
+#define FsMaxName	64	// path names, with the '\0'
+#define MaxFsOpenFiles	32	// files open on the server
+#define FsCacheBlocks	32	// blocks cached by a client
+#define MaxFsLeases	16	// files a client holds leases on
+#define LeaseTime	100000	// ticks a lease lasts on the client
+
+enum FsOp {
+    FsCreate,			// data: name, "position": initial size
+    FsOpen,			// data: name
+    FsRead,			// "length" bytes at "position"
+    FsWrite,			// data at "position"
+    FsClose,
+    FsReply,			// "result", "fileId", "fileLength"
+    FsReadReply,		// same, data: "length" bytes read
+    FsRevoke,			// server to client: drop file "fileId"
+    FsRevokeAck
+};
+
+// Ahead of every message; "length" bytes of data follow for FsCreate,
+// FsOpen, FsWrite and FsReadReply.
+struct FsMessage {
+    int op;
+    int handle;			// the server's number for an open file
+    int position;
+    int length;
+    int result;			// of the request
+    int fileId;			// header sector: the file, whoever opened it
+    int fileLength;
+};
+
+// Who has read a file, on the server.
+struct FsLease {
+    int fileId;			// -1 if the slot is free
+    unsigned holders;		// bit per client
+    int acksPending;		// FsRevokes not answered yet
+};
+
+class FileServer {
+  public:
+    FileServer();		// start serving machines 0 to
+				// MaxFsClients - 1
+
+    void ReceiveLoop(int client);	// body of the thread taking the
+				// messages of "client"
+    void ServeLoop(int client);	// body of the thread serving its
+				// requests, one at a time
+
+  private:
+    void Serve(int client, FsMessage *m);
+    void Reply(int client, int op, int result, OpenFile *file,
+	       char *data, int length);
+    FsLease *FindLease(int fileId, bool create);
+    void Revoke(int client, int fileId);	// from all but "client"
+
+    Connection *clients[MaxFsClients];
+    SynchList *requests[MaxFsClients];	// from ReceiveLoop to ServeLoop
+    OpenFile *files[MaxFsOpenFiles];	// by handle, NULL if free
+    FsLease leases[MaxFsLeases];
+    Lock *lock;			// guards files and leases, and keeps
+				// reads out while a write revokes
+    Condition *revoked;		// an FsRevokeAck came in
+};
+
+// A cached block of a remote file, on the client.
+struct FsCacheBlock {
+    int fileId;			// -1 if the slot is free
+    int block;
+    int lastUse;
+    char data[FsBlockSize];
+};
+
+// A lease the client holds.
+struct FsClientLease {
+    int fileId;			// -1 if the slot is free
+    int expires;		// in our ticks
+    int fileLength;
+};
+
+class FileClient {
+  public:
+    FileClient(NetworkAddress server);	// connect to the server
+
+    bool Create(char *name, int initialSize);
+    int Open(char *name, int *fileId);	// server handle, or -1
+    void Close(int handle);
+    int Read(int handle, int fileId, char *into, int numBytes,
+	     int position);
+    int Write(int handle, char *from, int numBytes, int position);
+    int Length(int handle, int fileId);
+
+    void ReceiveLoop();		// body of the thread taking the
+				// server's messages
+
+  private:
+    int Call(int op, int handle, int position, char *data, int length,
+	     char *into, FsMessage *reply);	// send a request, wait
+				// for the reply; data read goes to "into"
+    void Settle(FsMessage *reply, char *data);	// take the lease,
+				// and cache what the reply brings
+    void Granted(FsMessage *reply);	// note the lease
+    FsClientLease *FindLease(int fileId);	// valid lease, or NULL
+    FsCacheBlock *FindBlock(int fileId, int block);
+    void Drop(int fileId);	// forget its lease and blocks
+
+    Connection *server;
+    Lock *callLock;		// one request at a time
+    FsMessage request;		// the request waiting for its reply,
+    char *requestData;		//   its data,
+    int sentAt;			//   and when it was sent
+    Semaphore *replied;		// V'ed when the reply is in
+    FsMessage reply;		// the reply, and its data
+    char replyData[FsMaxData];
+    Lock *cacheLock;		// guards cache and leases
+    FsCacheBlock cache[FsCacheBlocks];
+    FsClientLease leases[MaxFsLeases];
+};
+
+// A file on the server, opened through the FileClient; like OpenFile,
+// but reads are served from the client's cache when it can.
+class RemoteFile {
+  public:
+    RemoteFile(int handle, int fileId);	// see FileClient::Open
+    ~RemoteFile();			// close it on the server
+
+    void Seek(int position) { seekPosition = position; }
+    int Read(char *into, int numBytes);
+    int Write(char *from, int numBytes);
+    int ReadAt(char *into, int numBytes, int position);
+    int WriteAt(char *from, int numBytes, int position);
+    int Length();
+
+    static RemoteFile *Open(char *name);	// NULL if it can't be
+
+  private:
+    int handle, fileId;
+    int seekPosition;
+};
+
+#endif // FILESERVER_H
@@ -0,0 +1,515 @@
+// migrate.cc
+//	Routines to move a running user process to another machine, and
+//	to take in the processes moved here.  See migrate.h.
+//
+//	A thread per other machine takes its messages, in both roles: as
+//	target it makes and fills in the processes arriving, and hands
+//	them the pages they fetch; as source it serves those fetches out
+//	of the stub's address space, and wakes the stub.  It never waits
+//	for another message, only for the disk.
+//
+//	The migrating process's own thread does the sending, and becomes
+//	the stub.  On the target, the process's thread fetches its remote
+//	pages itself, like Dsm::Fault, so their frames belong to it.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "migrate.h"
+#include "system.h"
+
+#include <stdio.h>
+
+extern void ThreadFuncForUserProg(int arg);	// in exception.cc
+
+//----------------------------------------------------------------------
+// ReceiveHelper
+// 	Dummy function because C++ can't indirectly invoke member functions.
+//	"arg" -- the machine whose messages it takes
+//----------------------------------------------------------------------
+
+static void ReceiveHelper(int arg)
+{ migrator->ReceiveLoop(arg); }
+
+//----------------------------------------------------------------------
+// DropHelper
+// 	Body of the thread of a migrant that could not be started: it
+//	gives back what it has and finishes, without running user code.
+//----------------------------------------------------------------------
+
+static void DropHelper(int arg)
+{ currentThread->DeleteAddrSpace(); currentThread->Finish(); }
+
+//----------------------------------------------------------------------
+// ReceiveAll
+// 	Read exactly "numBytes" from "conn".
+//----------------------------------------------------------------------
+
+static void
+ReceiveAll(Connection *conn, char *into, int numBytes)
+{
+    int done = 0;
+
+    while (done < numBytes)
+	done += conn->Receive(into + done, numBytes - done);
+}
+
+//----------------------------------------------------------------------
+// Migrator::Migrator
+// 	Connect this machine to every other one, and start taking their
+//	messages.  The threads started here use the global "migrator",
+//	which is set before they run.
+//
+//	"node" -- this machine
+//	"numNodes" -- machines taking part
+//----------------------------------------------------------------------
+
+Migrator::Migrator(NetworkAddress me, int nodes)
+{
+    ASSERT(nodes > 0 && nodes <= MaxMigrateNodes);
+    ASSERT(me >= 0 && me < nodes);
+    node = me;
+    numNodes = nodes;
+    for (int i = 0; i < MaxMigrants; i++) {
+	migrants[i].from = -1;
+	emigrants[i].to = -1;
+	emigrants[i].answer = new Semaphore("migrate answer", 0);
+    }
+    for (int n = 0; n < MaxMigrateNodes; n++) {
+	links[n] = NULL;
+	if (n == node || n >= numNodes)
+	    continue;
+	links[n] = new Connection(n, MigrateBox + n, MigrateBox + node,
+				  MigrateWindow);
+	Thread *t = Thread::getInstance("migrate receive");
+	t->Fork(ReceiveHelper, n);
+    }
+}
+
+//----------------------------------------------------------------------
+// Migrator::SendMessage
+// 	Send a message and its data to machine "to", with a single Send
+//	so no other thread's message gets in between.
+//----------------------------------------------------------------------
+
+void
+Migrator::SendMessage(int to, int op, int id, int vpn, char *data,
+		      int length)
+{
+    char *buffer = new char[sizeof(MigrateMessage) + length];
+    MigrateMessage *m = (MigrateMessage *) buffer;
+
+    m->op = op;
+    m->id = id;
+    m->vpn = vpn;
+    m->length = length;
+    if (length > 0)
+	bcopy(data, buffer + sizeof(MigrateMessage), length);
+    links[to]->Send(buffer, sizeof(MigrateMessage) + length);
+    delete [] buffer;
+}
+
+Migrant *
+Migrator::FindMigrant(int from, int id)
+{
+    for (int i = 0; i < MaxMigrants; i++)
+	if (migrants[i].from == from && (from == -1 || migrants[i].id == id))
+	    return &migrants[i];
+    return NULL;
+}
+
+Migrant *
+Migrator::FindMigrant(AddrSpace *space)
+{
+    for (int i = 0; i < MaxMigrants; i++)
+	if (migrants[i].from != -1 && migrants[i].space == space)
+	    return &migrants[i];
+    return NULL;
+}
+
+Emigrant *
+Migrator::FindEmigrant(int to, int id)
+{
+    for (int i = 0; i < MaxMigrants; i++)
+	if (emigrants[i].to == to && (to == -1 || emigrants[i].id == id))
+	    return &emigrants[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Migrator::Migrate
+// 	Called from the Migrate system call.  Send the current process
+//	to machine "to": its registers as they are once the call has
+//	returned 0, its break and its executable; once the target has
+//	made the process, every page in memory, and the numbers of the
+//	pages in the swap file.  The pages sent are freed once the target
+//	has started the process.  Then wait, serving page fetches in the
+//	receive thread, until the process has exited over there.
+//
+//	A process that came here by migrating fetches its remote pages
+//	first, so the target only ever fetches from the machine it came
+//	from.
+//
+//	Return FALSE if the process can't move, or the target dropped
+//	it, and it goes on here; else set "*exitStatus" to its exit
+//	status on the target.
+//----------------------------------------------------------------------
+
+bool
+Migrator::Migrate(int to, int *exitStatus)
+{
+    AddrSpace *space = currentThread->space;
+    int id = currentThread->getTid();
+    Emigrant *e;
+
+    if (to < 0 || to >= numNodes || to == node || space->HasMmaps()
+	    || space->IsDsmAttached() || !FetchAll(space))
+	return FALSE;
+    e = FindEmigrant(-1, 0);
+    if (e == NULL)
+	return FALSE;
+    e->to = to;
+    e->id = id;
+    e->space = space;
+    space->GetPrintBuffer()->Flush();
+
+    // registers as the syscall leaves them, see Machine::PCForward
+    MigrateState state;
+    for (int i = 0; i < NumTotalRegs; i++)
+	state.registers[i] = machine->ReadRegister(i);
+    state.registers[2] = 0;
+    state.registers[PrevPCReg] = state.registers[PCReg];
+    state.registers[PCReg] = state.registers[NextPCReg];
+    state.registers[NextPCReg] += sizeof(int);
+    state.brk = space->GetBreak();
+
+    OpenFile *executable = space->getExecFileCopy();
+    state.execLength = executable->Length();
+    int length = sizeof(MigrateState) + state.execLength;
+    char *image = new char[length];
+    bcopy((char *) &state, image, sizeof(MigrateState));
+    executable->ReadAt(image + sizeof(MigrateState), state.execLength, 0);
+    delete executable;
+    SendMessage(to, MigrateImage, id, 0, image, length);
+    delete [] image;
+
+    e->answer->P();
+    if (!e->status) {
+	printf("Migrate: machine %d refused thread %d\n", to, id);
+	e->to = -1;
+	return FALSE;
+    }
+
+    // the stub doesn't run, so only eviction changes its pages meanwhile;
+    // SendMessage copies the page before it waits
+    BitMap *pushed = new BitMap(space->GetNumPages());
+    machine->FlushTLB(space->GetASID());
+    for (int vpn = 0; vpn < space->GetNumPages(); vpn++) {
+	TranslationEntry *pte = space->GetPTE(vpn);
+	if (pte == NULL)
+	    continue;
+	if (pte->valid) {
+	    SendMessage(to, MigratePage, id, vpn,
+			&machine->mainMemory[pte->physicalPage * PageSize],
+			PageSize);
+	    pushed->Mark(vpn);
+	    stats->numMigratePagesPushed++;
+	} else if (pte->swappingPage != -1) {
+	    SendMessage(to, MigrateRemote, id, vpn, NULL, 0);
+	}
+    }
+    SendMessage(to, MigrateStart, id, 0, NULL, 0);
+
+    e->answer->P();
+    if (!e->status) {
+	printf("Migrate: machine %d dropped thread %d\n", to, id);
+	delete pushed;
+	e->to = -1;
+	return FALSE;
+    }
+    for (int vpn = 0; vpn < space->GetNumPages(); vpn++)
+	if (pushed->Test(vpn))
+	    space->ReleasePages(vpn, vpn + 1);
+    delete pushed;
+    stats->numMigrationsOut++;
+    printf("Migrate: thread %d moved to machine %d\n", id, to);
+
+    e->answer->P();
+    e->to = -1;
+    printf("Migrate: thread %d exited on machine %d, status %d\n", id, to,
+	   e->status);
+    *exitStatus = e->status;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Migrator::Arrive
+// 	A process is moving here from machine "from": write its executable
+//	into our file system, make a thread and address space for it, and
+//	set its registers and break.  It runs on MigrateStart, see Start.
+//	Tell the source whether that worked.
+//----------------------------------------------------------------------
+
+void
+Migrator::Arrive(int from, int id, char *image, int length)
+{
+    MigrateState *state = (MigrateState *) image;
+    Migrant *m = FindMigrant(-1, 0);
+    OpenFile *executable = NULL;
+    Thread *t = NULL;
+    AddrSpace *space;
+    char name[32];
+
+    ASSERT(length == (int) sizeof(MigrateState) + state->execLength);
+    sprintf(name, "migrant.%d.%d", from, id);
+    fileSystem->Remove(name);		// left by an earlier migrant
+    if (m != NULL && fileSystem->Create(name, state->execLength))
+	executable = fileSystem->Open(name);
+    if (executable != NULL) {
+	executable->WriteAt(image + sizeof(MigrateState), state->execLength,
+			    0);
+	t = Thread::getInstance("migrant");
+    }
+    if (t == NULL) {
+	delete executable;
+	SendMessage(from, MigrateAccept, id, 0, NULL, 0);
+	return;
+    }
+
+    // the program ran on the source, so it fits here too
+    space = new AddrSpace(executable);
+    space->AllocAddrSpace(t->getTid());
+    t->space = space;
+    space->Sbrk(state->brk - space->GetBreak());
+    for (int i = 0; i < NumTotalRegs; i++)
+	t->WriteRegister(i, state->registers[i]);
+    m->from = from;
+    m->id = id;
+    m->thread = t;
+    m->space = space;
+    m->execSector = executable->GetHdrSector();
+    m->failed = FALSE;
+    m->fetched = new Semaphore("migrate fetched", 0);
+    m->pendingVpn = m->pendingFrame = -1;
+    SendMessage(from, MigrateAccept, id, 1, NULL, 0);
+}
+
+//----------------------------------------------------------------------
+// Migrator::Install
+// 	A page the source sent along: it takes a frame of the migrant now.
+//	If there is no room for it, the migrant won't be started.
+//----------------------------------------------------------------------
+
+void
+Migrator::Install(Migrant *m, int vpn, char *data)
+{
+    if (m->failed || m->space->InstallPage(vpn, data))
+	return;
+    printf("Migrate: no room for page %d of thread %d\n", vpn,
+	   m->thread->getTid());
+    m->failed = TRUE;
+}
+
+//----------------------------------------------------------------------
+// Migrator::Start
+// 	All of the migrant's pages are in: run it, or drop it if one of
+//	them didn't fit, and tell the source which.
+//----------------------------------------------------------------------
+
+void
+Migrator::Start(Migrant *m)
+{
+    int from = m->from, id = m->id;
+    Thread *t = m->thread;
+
+    if (m->failed) {
+	printf("Migrate: thread %d of machine %d dropped\n", id, from);
+	Forget(m);
+	t->Fork(DropHelper, 0);
+	SendMessage(from, MigrateAccept, id, 0, NULL, 0);
+	return;
+    }
+    stats->numMigrationsIn++;
+    printf("Migrate: thread %d of machine %d runs here as thread %d\n",
+	   id, from, t->getTid());
+    t->Fork(ThreadFuncForUserProg, 0);
+    SendMessage(from, MigrateAccept, id, 1, NULL, 0);
+}
+
+//----------------------------------------------------------------------
+// Migrator::Forget
+// 	Free the slot of migrant "m", and remove its copy of the
+//	executable; the file goes once its address space has closed it.
+//----------------------------------------------------------------------
+
+void
+Migrator::Forget(Migrant *m)
+{
+    char name[32];
+
+    memManager->ForgetExecFile(m->execSector);
+    sprintf(name, "migrant.%d.%d", m->from, m->id);
+    fileSystem->Remove(name);
+    delete m->fetched;
+    m->from = -1;
+}
+
+//----------------------------------------------------------------------
+// Migrator::Serve
+// 	On the source, send machine "to" the page "vpn" of the stub "id",
+//	out of the swap file, and free it: it is only fetched once.
+//----------------------------------------------------------------------
+
+void
+Migrator::Serve(int to, int id, int vpn)
+{
+    Emigrant *e = FindEmigrant(to, id);
+    char page[PageSize];
+
+    ASSERT(e != NULL);
+    TranslationEntry *pte = e->space->GetPTE(vpn);
+    if (pte != NULL && pte->valid)
+	bcopy(&machine->mainMemory[pte->physicalPage * PageSize], page,
+	      PageSize);
+    else if (pte != NULL && pte->swappingPage != -1)
+	swapManager->ReadPage(pte->swappingPage, page);
+    else
+	bzero(page, PageSize);
+    e->space->ReleasePages(vpn, vpn + 1);
+    SendMessage(to, MigratePage, id, vpn, page, PageSize);
+}
+
+//----------------------------------------------------------------------
+// Migrator::Fault
+// 	Called from Machine::SwapPage for a remote page of a process that
+//	migrated here, in its own thread.  Get a pinned frame, ask the
+//	source for the page, and wait until the receive thread has put it
+//	in the frame.
+//----------------------------------------------------------------------
+
+bool
+Migrator::Fault(AddrSpace *space, int vpn)
+{
+    Migrant *m = FindMigrant(space);
+    TranslationEntry *pte = space->GetPTE(vpn);
+    int frame;
+
+    ASSERT(m != NULL && pte != NULL);	// the caller has mapped it
+    frame = machine->AllocFrame(vpn);
+    if (frame < 0)
+	return FALSE;
+    memManager->Pin(frame);
+    m->pendingFrame = frame;
+    m->pendingVpn = vpn;
+    SendMessage(m->from, MigrateFetch, m->id, vpn, NULL, 0);
+    m->fetched->P();
+    m->pendingVpn = m->pendingFrame = -1;
+    memManager->Unpin(frame);
+
+    pte->physicalPage = frame;
+    pte->valid = TRUE;
+    pte->readOnly = FALSE;
+    pte->copyOnWrite = FALSE;
+    pte->use = FALSE;
+    pte->dirty = FALSE;
+    space->SetRemotePage(vpn, FALSE);
+    stats->numMigratePagesPulled++;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Migrator::FetchAll
+// 	Fetch every remote page of "space", in its thread: a Fork child
+//	shares the pages, and a process moving on takes them along.
+//	FALSE if no memory is left.
+//----------------------------------------------------------------------
+
+bool
+Migrator::FetchAll(AddrSpace *space)
+{
+    for (int vpn = 0; vpn < space->GetNumPages(); vpn++)
+	if (space->IsRemotePage(vpn) && !Fault(space, vpn))
+	    return FALSE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Migrator::Exited
+// 	Called as a process exits.  If it migrated here, its stub on the
+//	source exits too, with "status".
+//----------------------------------------------------------------------
+
+void
+Migrator::Exited(AddrSpace *space, int status)
+{
+    Migrant *m = FindMigrant(space);
+
+    if (m == NULL)
+	return;
+    SendMessage(m->from, MigrateExit, m->id, status, NULL, 0);
+    Forget(m);
+}
+
+//----------------------------------------------------------------------
+// Migrator::ReceiveLoop
+// 	Take the messages of machine "from".
+//----------------------------------------------------------------------
+
+void
+Migrator::ReceiveLoop(int from)
+{
+    MigrateMessage msg;
+    Migrant *m;
+    Emigrant *e;
+
+    for (;;) {
+	ReceiveAll(links[from], (char *) &msg, sizeof(MigrateMessage));
+	char *data = NULL;
+	if (msg.length > 0) {
+	    data = new char[msg.length];
+	    ReceiveAll(links[from], data, msg.length);
+	}
+
+	switch (msg.op) {
+	  case MigrateImage:
+	    Arrive(from, msg.id, data, msg.length);
+	    break;
+	  case MigratePage:
+	    m = FindMigrant(from, msg.id);
+	    ASSERT(m != NULL && msg.length == PageSize);
+	    if (m->pendingVpn == msg.vpn) {
+		bcopy(data, &machine->mainMemory[m->pendingFrame * PageSize],
+		      PageSize);
+		m->fetched->V();
+	    } else {
+		Install(m, msg.vpn, data);
+	    }
+	    break;
+	  case MigrateRemote:
+	    m = FindMigrant(from, msg.id);
+	    ASSERT(m != NULL);
+	    m->space->SetRemotePage(msg.vpn, TRUE);
+	    break;
+	  case MigrateStart:
+	    m = FindMigrant(from, msg.id);
+	    ASSERT(m != NULL);
+	    Start(m);
+	    break;
+	  case MigrateFetch:
+	    Serve(from, msg.id, msg.vpn);
+	    break;
+	  case MigrateAccept:
+	  case MigrateExit:
+	    e = FindEmigrant(from, msg.id);
+	    ASSERT(e != NULL);
+	    e->status = msg.vpn;
+	    e->answer->V();
+	    break;
+	  default:
+	    ASSERT(FALSE);
+	}
+	delete [] data;
+    }
+}
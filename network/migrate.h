@@ -0,0 +1,133 @@
+// migrate.h
+//	Moving a running user process to another Nachos machine.
+//
+//	Migrate(node) sends the process's registers and its executable
+//	to "node", then every page it has in memory; there a new process
+//	is made of them, and runs on from the Migrate call.  The pages it
+//	had in the swap file are only listed: the new process asks for
+//	each one when it first touches it.  Image pages it never touched
+//	load from its copy of the executable, as usual.
+//
+//	The source frees the pages it sent once the process runs on the
+//	target.  If one of them doesn't fit there, the process is dropped
+//	on the target instead, and stays on the source as if Migrate had
+//	been refused.
+//
+//	The process's thread stays behind as a stub, serving those page
+//	requests, until the process exits on the other machine; then the
+//	stub exits with the same status, so a Join on it still works.
+//	Open files, Mmap regions and the DSM region don't move, a process
+//	with either of the latter two may not migrate.
+//
+//	Each pair of machines talks over a Connection (transport.h), the
+//	same one in both directions.  Machines are numbered 0 to
+//	numNodes - 1, as given by -m.
+
+#ifndef MIGRATE_H
+#define MIGRATE_H
+
+#include "copyright.h"
+#include "transport.h"
+#include "addrspace.h"
+#include "machine.h"
+
+#define MaxMigrateNodes	4	// machines taking part, at most
+#define MigrateBox	16	// our mailbox for machine n is
+				// MigrateBox + n
+#define MigrateWindow	8	// of the Connections
+#define MaxMigrants	8	// processes moved here, and moved away
+				// from here, at the same time
+
+enum MigrateOp {
+    MigrateImage,		// source to target: a MigrateState and the
+				//   executable follow
+    MigrateAccept,		// target to source, after MigrateImage:
+				//   "vpn" is 1 if the process could be
+				//   made, 0 if not; after MigrateStart: 1
+				//   if it runs, 0 if a page didn't fit and
+				//   it was dropped
+    MigratePage,		// source to target: the page "vpn" follows
+    MigrateRemote,		// source to target: page "vpn" is in the
+				//   source's swap file
+    MigrateStart,		// source to target: that's all, run it
+    MigrateFetch,		// target to source: send page "vpn"
+    MigrateExit			// target to source: the process exited
+				//   with status "vpn"
+};
+
+// Ahead of every message, "length" bytes of data follow.
+struct MigrateMessage {
+    int op;
+    int id;			// the process's thread id on the source
+    int vpn;
+    int length;
+};
+
+// After the MigrateImage message.
+struct MigrateState {
+    int registers[NumTotalRegs];	// to resume with
+    int brk;			// end of the heap
+    int execLength;		// bytes of executable that follow
+};
+
+// A process moved here, on the target.
+struct Migrant {
+    int from;			// source machine, -1 if the slot is free
+    int id;
+    Thread *thread;
+    AddrSpace *space;
+    int execSector;		// header of its copy of the executable
+    bool failed;		// a page didn't fit, don't start it
+    Semaphore *fetched;		// V'ed when page "pendingVpn" is in
+    int pendingVpn;		//   frame "pendingFrame", -1 if we
+    int pendingFrame;		//   aren't waiting
+};
+
+// A process moved away, on the source.
+struct Emigrant {
+    int to;			// target machine, -1 if the slot is free
+    int id;
+    AddrSpace *space;		// the stub's, holding the remote pages
+    Semaphore *answer;		// V'ed on MigrateAccept and MigrateExit
+    int status;			// accepted, then exit status
+};
+
+class Migrator {
+  public:
+    Migrator(NetworkAddress node, int numNodes);	// connect to
+				// every other machine
+
+    bool Migrate(int to, int *exitStatus);	// move the current
+				// process to machine "to" and wait until
+				// it exits there; FALSE if it stays here
+    bool Fault(AddrSpace *space, int vpn);	// fetch remote page
+				// "vpn"; FALSE if no memory is left
+    bool FetchAll(AddrSpace *space);	// every remote page, before a
+				// Fork or moving on; FALSE if no
+				// memory is left
+    void Exited(AddrSpace *space, int status);	// a process is
+				// exiting; tell its source
+
+    void ReceiveLoop(int from);	// body of the thread taking the
+				// messages of machine "from"
+
+  private:
+    void SendMessage(int to, int op, int id, int vpn, char *data,
+		     int length);
+    void Arrive(int from, int id, char *image, int length);
+    void Install(Migrant *m, int vpn, char *data);
+    void Start(Migrant *m);
+    void Forget(Migrant *m);	// free the slot and the executable copy
+    void Serve(int to, int id, int vpn);
+    Migrant *FindMigrant(int from, int id);	// from -1: a free slot
+    Migrant *FindMigrant(AddrSpace *space);
+    Emigrant *FindEmigrant(int to, int id);	// to -1: a free slot
+
+    NetworkAddress node;
+    int numNodes;
+    Connection *links[MaxMigrateNodes];	// NULL for ourselves
+    Migrant migrants[MaxMigrants];
+    Emigrant emigrants[MaxMigrants];
+};
+
+#endif // MIGRATE_H
@@ -21,6 +21,8 @@
 #include "system.h"
 #include "network.h"
 #include "post.h"
+#include "transport.h"
+#include "fileserver.h"
 #include "interrupt.h"
 
 // Test out message delivery, by doing the following:
@@ -70,3 +72,113 @@ MailTest(int farAddr)
     // Then we're done!
     interrupt->Halt();
 }
+
+// Stream TransportBytes to the machine with ID "farAddr" over a
+// Connection (mailbox 2 at both ends), while taking the same amount
+// from it, and report how long that took.  Run both machines with
+// the same window, e.g.
+//	./nachos -m 0 -tp 1 8 &
+//	./nachos -m 1 -tp 0 8 &
+// and compare the throughput for different windows.
+
+#define TransportBytes	4096
+#define TransportBox	2
+
+static Semaphore *lingerDone;
+
+static void
+LingerOver(int arg)
+{
+    lingerDone->V();
+}
+
+static void
+TransportSender(int arg)
+{
+    Connection *conn = (Connection *) arg;
+    char data[TransportBytes];
+
+    for (int i = 0; i < TransportBytes; i++)
+	data[i] = 'a' + i % 26;
+    conn->Send(data, TransportBytes);
+    conn->Flush();
+}
+
+void
+TransportTest(int farAddr, int window)
+{
+    Connection *conn = new Connection(farAddr, TransportBox, TransportBox,
+				      window);
+    char buffer[TransportBytes];
+    int start = stats->totalTicks;
+    int got = 0, bad = 0;
+
+    Thread *t = Thread::getInstance("transport sender");
+    t->Fork(TransportSender, (int) conn);
+
+    while (got < TransportBytes) {
+	int n = conn->Receive(buffer, TransportBytes - got);
+
+	for (int i = 0; i < n; i++)
+	    if (buffer[i] != 'a' + (got + i) % 26)
+		bad++;
+	got += n;
+    }
+    conn->Flush();
+
+    int ticks = stats->totalTicks - start;
+    printf("Transport: window %d, %d bytes each way in %d ticks, "
+	"%d bytes out of order, %.0f bytes/second\n", window, got, ticks,
+	bad, ticks > 0 ? (double) got * TicksPerSecond / ticks : 0.0);
+    fflush(stdout);
+
+    // The other machine may still be waiting for our last ACK, and its
+    // retransmissions need us around to answer them; stay a while.
+    lingerDone = new Semaphore("linger", 0);
+    interrupt->Schedule(LingerOver, 0, 4 * RetransmitTime, NetworkRecvInt);
+    lingerDone->P();
+
+    interrupt->Halt();
+}
+
+// Write a file on the file server through the FileClient (-fc), then
+// read it back three times.  Only the first reading should go to the
+// server; run with -fs on the server, e.g.
+//	./nachos -m 0 -fs &
+//	./nachos -m 1 -fc 0 -rf foo
+// and look at the "Remote files" statistics.  A second client writing
+// the same file meanwhile revokes our lease, and we read it again.
+
+#define RemoteFileBytes	1000
+
+void
+RemoteFileTest(char *name)
+{
+    char data[RemoteFileBytes], buffer[RemoteFileBytes];
+    int bad = 0;
+
+    ASSERT(fileClient != NULL);
+    for (int i = 0; i < RemoteFileBytes; i++)
+	data[i] = 'a' + i % 26;
+    if (!fileClient->Create(name, 0))
+	printf("RemoteFileTest: %s exists already\n", name);
+    RemoteFile *file = RemoteFile::Open(name);
+    if (file == NULL) {
+	printf("RemoteFileTest: can't open %s\n", name);
+	interrupt->Halt();
+    }
+    file->Write(data, RemoteFileBytes);
+
+    for (int pass = 0; pass < 3; pass++) {
+	int start = stats->totalTicks;
+	int n = file->ReadAt(buffer, RemoteFileBytes, 0);
+
+	for (int i = 0; i < n; i++)
+	    if (buffer[i] != data[i])
+		bad++;
+	printf("RemoteFileTest: read %d bytes in %d ticks, %d wrong\n", n,
+	       stats->totalTicks - start, bad);
+    }
+    delete file;
+    interrupt->Halt();
+}
@@ -10,7 +10,10 @@
 //	device.
 //
 // 	The implementation synchronizes incoming messages with threads
-//	waiting for those messages.
+//	waiting for those messages.  Incoming messages are delivered by
+//	the receive interrupt handler into rings preallocated in each
+//	mailbox, so there is no thread hand-off and no allocation per
+//	packet; the rings are only touched with interrupts off.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -18,12 +21,13 @@
 
 #include "copyright.h"
 #include "post.h"
+#include "system.h"
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
 //----------------------------------------------------------------------
-// Mail::Mail
-//      Initialize a single mail message, by concatenating the headers to
+// Mail::Set
+//      Fill in a single mail message, by concatenating the headers to
 //	the data.
 //
 //	"pktH" -- source, destination machine ID's
@@ -31,7 +35,8 @@
 //	"data" -- payload data
 //----------------------------------------------------------------------
 
-Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
+void
+Mail::Set(PacketHeader pktH, MailHeader mailH, char *msgData)
 {
     ASSERT(mailH.length <= MaxMailSize);
 
@@ -45,13 +50,14 @@ Mail::Mail(PacketHeader pktH, MailHeader mailH, char *msgData)
 //      Initialize a single mail box within the post office, so that it
 //	can receive incoming messages.
 //
-//	Just initialize a list of messages, representing the mailbox.
+//	The ring of messages is part of the mailbox; it starts empty.
 //----------------------------------------------------------------------
 
 
 MailBox::MailBox()
 { 
-    messages = new SynchList(); 
+    head = count = 0;
+    available = new Semaphore("mail available", 0);
 }
 
 //----------------------------------------------------------------------
@@ -64,7 +70,7 @@ MailBox::MailBox()
 
 MailBox::~MailBox()
 { 
-    delete messages; 
+    delete available; 
 }
 
 //----------------------------------------------------------------------
@@ -86,24 +92,28 @@ PrintHeader(PacketHeader pktHdr, MailHeader mailHdr)
 //----------------------------------------------------------------------
 // MailBox::Put
 // 	Add a message to the mailbox.  If anyone is waiting for message
-//	arrival, wake them up!
+//	arrival, wake them up!  If the ring is full, the message is
+//	dropped and we return FALSE.
 //
-//	We need to reconstruct the Mail message (by concatenating the headers
-//	to the data), to simplify queueing the message on the SynchList.
+//	This is called by the receive interrupt handler, so interrupts
+//	are already off; that's what keeps the ring consistent.
 //
 //	"pktHdr" -- source, destination machine ID's
 //	"mailHdr" -- source, destination mailbox ID's
 //	"data" -- payload message data
 //----------------------------------------------------------------------
 
-void 
+bool 
 MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, char *data)
 { 
-    Mail *mail = new Mail(pktHdr, mailHdr, data); 
-
-    messages->Append((void *)mail);	// put on the end of the list of 
-					// arrived messages, and wake up 
-					// any waiters
+    ASSERT(interrupt->getLevel() == IntOff);
+    if (count == MailBoxSlots)
+	return FALSE;
+
+    slots[(head + count) % MailBoxSlots].Set(pktHdr, mailHdr, data);
+    count++;
+    available->V();			// wake up a waiter on this box
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -122,8 +132,10 @@ void
 MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data) 
 { 
     DEBUG('n', "Waiting for mail in mailbox\n");
-    Mail *mail = (Mail *) messages->Remove();	// remove message from list;
-						// will wait if list is empty
+    available->P();			// wait until there is a message
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    Mail *mail = &slots[head];
 
     *pktHdr = mail->pktHdr;
     *mailHdr = mail->mailHdr;
@@ -134,21 +146,19 @@ MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data)
     bcopy(mail->data, data, mail->mailHdr.length);
 					// copy the message data into
 					// the caller's buffer
-    delete mail;			// we've copied out the stuff we
-					// need, we can now discard the message
+    head = (head + 1) % MailBoxSlots;	// we've copied out the stuff we
+    count--;				// need, we can now free the slot
+    (void) interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
-// PostalHelper, ReadAvail, WriteDone
+// ReadAvail, WriteDone
 // 	Dummy functions because C++ can't indirectly invoke member functions
-//	The first is forked as part of the "postal worker thread; the
-//	later two are called by the network interrupt handler.
+//	They are called by the network interrupt handler.
 //
 //	"arg" -- pointer to the Post Office managing the Network
 //----------------------------------------------------------------------
 
-static void PostalHelper(int arg)
-{ PostOffice* po = (PostOffice *) arg; po->PostalDelivery(); }
 static void ReadAvail(int arg)
 { PostOffice* po = (PostOffice *) arg; po->IncomingPacket(); }
 static void WriteDone(int arg)
@@ -160,10 +170,9 @@ static void WriteDone(int arg)
 //	Also initialize the network device, to allow post offices
 //	on different machines to deliver messages to one another.
 //
-//      We use a separate thread "the postal worker" to wait for messages 
-//	to arrive, and deliver them to the correct mailbox.  Note that
-//	delivering messages to the mailboxes can't be done directly
-//	by the interrupt handlers, because it requires a Lock.
+//      Messages are delivered to the correct mailbox directly by the
+//	receive interrupt handler; mailboxes don't need a Lock, only
+//	interrupts off, so there is no need for a separate thread.
 //
 //	"addr" is this machine's network ID 
 //	"reliability" is the probability that a network packet will
@@ -176,8 +185,8 @@ static void WriteDone(int arg)
 PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
 {
 // First, initialize the synchronization with the interrupt handlers
-    messageAvailable = new Semaphore("message available", 0);
     messageSent = new Semaphore("message sent", 0);
+    sendWaiting = FALSE;
     sendLock = new Lock("message send lock");
 
 // Second, initialize the mailboxes
@@ -187,13 +196,6 @@ PostOffice::PostOffice(NetworkAddress addr, double reliability, int nBoxes)
 
 // Third, initialize the network; tell it which interrupt handlers to call
     network = new Network(addr, reliability, ReadAvail, WriteDone, (int) this);
-
-
-// Finally, create a thread whose sole job is to wait for incoming messages,
-//   and put them in the right mailbox. 
-    Thread *t = Thread::getInstance("postal worker");//new Thread("postal worker");
-
-    t->Fork(PostalHelper, (int) this);
 }
 
 //----------------------------------------------------------------------
@@ -205,46 +207,10 @@ PostOffice::~PostOffice()
 {
     delete network;
     delete [] boxes;
-    delete messageAvailable;
     delete messageSent;
     delete sendLock;
 }
 
-//----------------------------------------------------------------------
-// PostOffice::PostalDelivery
-// 	Wait for incoming messages, and put them in the right mailbox.
-//
-//      Incoming messages have had the PacketHeader stripped off,
-//	but the MailHeader is still tacked on the front of the data.
-//----------------------------------------------------------------------
-
-void
-PostOffice::PostalDelivery()
-{
-    PacketHeader pktHdr;
-    MailHeader mailHdr;
-    char *buffer = new char[MaxPacketSize];
-
-    for (;;) {
-        // first, wait for a message
-        messageAvailable->P();	
-        pktHdr = network->Receive(buffer);
-
-        mailHdr = *(MailHeader *)buffer;
-        if (DebugIsEnabled('n')) {
-	    printf("Putting mail into mailbox: ");
-	    PrintHeader(pktHdr, mailHdr);
-        }
-
-	// check that arriving message is legal!
-	ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
-	ASSERT(mailHdr.length <= MaxMailSize);
-
-	// put into mailbox
-        boxes[mailHdr.to].Put(pktHdr, mailHdr, buffer + sizeof(MailHeader));
-    }
-}
-
 //----------------------------------------------------------------------
 // PostOffice::Send
 // 	Concatenate the MailHeader to the front of the data, and pass 
@@ -261,8 +227,8 @@ PostOffice::PostalDelivery()
 void
 PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
 {
-    char* buffer = new char[MaxPacketSize];	// space to hold concatenated
-						// mailHdr + data
+    char buffer[MaxPacketSize];		// space to hold concatenated
+					// mailHdr + data
 
     if (DebugIsEnabled('n')) {
 	printf("Post send: ");
@@ -279,15 +245,16 @@ PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, char* data)
     bcopy(&mailHdr, buffer, sizeof(MailHeader));
     bcopy(data, buffer + sizeof(MailHeader), mailHdr.length);
 
-    sendLock->Acquire();   		// only one message can be sent
-					// to the network at any one time
-    network->Send(pktHdr, buffer);
-    messageSent->P();			// wait for interrupt to tell us
-					// ok to send the next message
+    sendLock->Acquire();   		// only one thread at a time
+					// queues messages on the network
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    while (network->SendFull()) {	// wait for interrupt to tell us
+	sendWaiting = TRUE;		// there's room for the next message
+	messageSent->P();
+    }
+    network->Send(pktHdr, buffer);	// goes out with the next batch
+    (void) interrupt->SetLevel(oldLevel);
     sendLock->Release();
-
-    delete [] buffer;			// we've sent the message, so
-					// we can delete our buffer
 }
 
 //----------------------------------------------------------------------
@@ -317,30 +284,59 @@ PostOffice::Receive(int box, PacketHeader *pktHdr,
 
 //----------------------------------------------------------------------
 // PostOffice::IncomingPacket
-// 	Interrupt handler, called when a packet arrives from the network.
+// 	Interrupt handler, called when a batch of packets arrives from
+//	the network.  Pull each off the network and put it in the right
+//	mailbox.
 //
-//	Signal the PostalDelivery routine that it is time to get to work!
+//      Incoming messages have had the PacketHeader stripped off,
+//	but the MailHeader is still tacked on the front of the data.
 //----------------------------------------------------------------------
 
 void
 PostOffice::IncomingPacket()
 { 
-    messageAvailable->V(); 
+    PacketHeader pktHdr;
+    MailHeader mailHdr;
+
+    for (;;) {
+	pktHdr = network->Receive(inBuffer);
+	if (pktHdr.length == 0)
+	    break;
+	mailHdr = *(MailHeader *)inBuffer;
+	if (DebugIsEnabled('n')) {
+	    printf("Putting mail into mailbox: ");
+	    PrintHeader(pktHdr, mailHdr);
+	}
+
+	// check that arriving message is legal!
+	ASSERT(0 <= mailHdr.to && mailHdr.to < numBoxes);
+	ASSERT(mailHdr.length <= MaxMailSize);
+
+	// put into mailbox
+	if (!boxes[mailHdr.to].Put(pktHdr, mailHdr,
+				   inBuffer + sizeof(MailHeader))) {
+	    DEBUG('n', "Mailbox %d full, mail dropped\n", mailHdr.to);
+	    stats->numMailDropped++;
+	}
+    }
 }
 
 //----------------------------------------------------------------------
 // PostOffice::PacketSent
-// 	Interrupt handler, called when the next packet can be put onto the 
-//	network.
+// 	Interrupt handler, called when a batch of packets has gone out
+//	and more can be queued on the network.
 //
 //	The name of this routine is a misnomer; if "reliability < 1",
-//	the packet could have been dropped by the network, so it won't get
-//	through.
+//	the packets could have been dropped by the network, so they won't
+//	get through.
 //----------------------------------------------------------------------
 
 void 
 PostOffice::PacketSent()
 { 
-    messageSent->V();
+    if (sendWaiting) {
+	sendWaiting = FALSE;
+	messageSent->V();
+    }
 }
 
@@ -13,6 +13,12 @@
 // 	Thus, the service our post office provides is to de-multiplex 
 // 	incoming packets, delivering them to the appropriate thread.
 //
+//	Delivery happens right in the network's receive interrupt: the
+//	packet is copied into a free slot of its mailbox, and only the
+//	threads waiting on that mailbox are woken up.  A mailbox holds
+//	MailBoxSlots messages; mail arriving at a full box is dropped,
+//	just as the network itself may drop it.
+//
 //      With each message, you get a return address, which consists of a "from
 // 	address", which is the id of the machine that sent the message, and
 // 	a "from box", which is the number of a mailbox on the sending machine 
@@ -29,7 +35,7 @@
 #define POST_H
 
 #include "network.h"
-#include "synchlist.h"
+#include "synch.h"
 
 // Mailbox address -- uniquely identifies a mailbox on a given machine.
 // A mailbox is just a place for temporary storage for messages.
@@ -52,6 +58,8 @@ class MailHeader {
 
 #define MaxMailSize 	(MaxPacketSize - sizeof(MailHeader))
 
+#define MailBoxSlots	32	// messages a mailbox can hold
+
 
 // The following class defines the format of an incoming/outgoing 
 // "Mail" message.  The message format is layered: 
@@ -61,8 +69,8 @@ class MailHeader {
 
 class Mail {
   public:
-     Mail(PacketHeader pktH, MailHeader mailH, char *msgData);
-				// Initialize a mail message by
+     void Set(PacketHeader pktH, MailHeader mailH, char *msgData);
+				// Fill in a mail message by
 				// concatenating the headers to the data
 
      PacketHeader pktHdr;	// Header appended by Network
@@ -80,14 +88,19 @@ class MailBox {
     MailBox();			// Allocate and initialize mail box
     ~MailBox();			// De-allocate mail box
 
-    void Put(PacketHeader pktHdr, MailHeader mailHdr, char *data);
-   				// Atomically put a message into the mailbox
+    bool Put(PacketHeader pktHdr, MailHeader mailHdr, char *data);
+   				// Atomically put a message into the mailbox;
+				// FALSE if it is full.  Called with
+				// interrupts off.
     void Get(PacketHeader *pktHdr, MailHeader *mailHdr, char *data); 
    				// Atomically get a message out of the 
 				// mailbox (and wait if there is no message 
 				// to get!)
   private:
-    SynchList *messages;	// A mailbox is just a list of arrived messages
+    Mail slots[MailBoxSlots];	// A mailbox is just a ring of arrived
+    int head;			//   messages: the oldest is slots[head]
+    int count;
+    Semaphore *available;	// one count per message in the ring
 };
 
 // The following class defines a "Post Office", or a collection of 
@@ -117,25 +130,22 @@ class PostOffice {
     				// Retrieve a message from "box".  Wait if
 				// there is no message in the box.
 
-    void PostalDelivery();	// Wait for incoming messages, 
-				// and then put them in the correct mailbox
-
     void PacketSent();		// Interrupt handler, called when outgoing 
 				// packet has been put on network; next 
 				// packet can now be sent
     void IncomingPacket();	// Interrupt handler, called when incoming
-   				// packet has arrived and can be pulled
-				// off of network (i.e., time to call 
-				// PostalDelivery)
+   				// packet has arrived; put it in the
+				// correct mailbox
 
   private:
     Network *network;		// Physical network connection
     NetworkAddress netAddr;	// Network address of this machine
     MailBox *boxes;		// Table of mail boxes to hold incoming mail
     int numBoxes;		// Number of mail boxes
-    Semaphore *messageAvailable;// V'ed when message has arrived from network
+    char inBuffer[MaxPacketSize];// Arrived packet, while it is delivered
     Semaphore *messageSent;	// V'ed when next message can be sent to network
-    Lock *sendLock;		// Only one outgoing message at a time
+    bool sendWaiting;		// A sender is waiting on messageSent
+    Lock *sendLock;		// Only one sender queues messages at a time
 };
 
 #endif
@@ -0,0 +1,328 @@
+// transport.cc
+//	Routines for reliable, ordered, windowed byte streams over the
+//	Post Office.  See transport.h for the protocol.
+//
+//	Sequence numbers only grow; segment "seq" is kept in slot
+//	seq % MaxWindow until it is ACKed, so the window can never be
+//	larger than MaxWindow.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "transport.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// ReceiverHelper, RetransmitHelper, TimerHelper
+// 	Dummy functions because C++ can't indirectly invoke member functions.
+//	The first two are forked as the connection's threads, the last
+//	is the retransmit timer's interrupt handler.
+//
+//	"arg" -- pointer to the Connection
+//----------------------------------------------------------------------
+
+static void ReceiverHelper(int arg)
+{ Connection *c = (Connection *) arg; c->ReceiveSegments(); }
+static void RetransmitHelper(int arg)
+{ Connection *c = (Connection *) arg; c->Retransmit(); }
+static void TimerHelper(int arg)
+{ Connection *c = (Connection *) arg; c->TimerExpired(); }
+
+//----------------------------------------------------------------------
+// Connection::Connection
+// 	Set up one end of a stream, and start its receiver and
+//	retransmit threads.  The other machine has to set up the
+//	matching end, with "box" and "farBox" swapped.
+//
+//	"farAddr" -- the other machine
+//	"box" -- our mailbox; nobody else may Receive from it
+//	"farBox" -- the other end's mailbox
+//	"window" -- segments allowed in flight, 1 to MaxWindow
+//----------------------------------------------------------------------
+
+Connection::Connection(NetworkAddress far, MailBoxAddress myBox,
+		       MailBoxAddress otherBox, int win)
+{
+    farAddr = far;
+    box = myBox;
+    farBox = otherBox;
+    if (win < 1)
+	win = 1;
+    if (win > MaxWindow)
+	win = MaxWindow;
+    window = win;
+
+    sendLock = new Lock("connection send lock");
+    lock = new Lock("connection lock");
+    windowOpen = new Condition("window open");
+    dataAvail = new Condition("data available");
+    timeout = new Semaphore("retransmit timeout", 0);
+
+    sendBase = nextSeq = 0;
+    sendWaiting = timerPending = FALSE;
+    lastProgress = 0;
+    expectedSeq = 0;
+    streamHead = streamCount = 0;
+
+    Thread *t = Thread::getInstance("transport receiver");
+    t->Fork(ReceiverHelper, (int) this);
+    t = Thread::getInstance("transport retransmitter");
+    t->Fork(RetransmitHelper, (int) this);
+}
+
+//----------------------------------------------------------------------
+// Connection::SendSegment
+// 	Put segment "seq" on the wire, with the latest cumulative ACK
+//	riding along.  Called with the lock held.
+//----------------------------------------------------------------------
+
+void
+Connection::SendSegment(int seq)
+{
+    PacketHeader outPktHdr;
+    MailHeader outMailHdr;
+    char buffer[MaxMailSize];
+    SegmentHeader seg;
+    int slot = seq % MaxWindow;
+
+    seg.seq = seq;
+    seg.ack = expectedSeq;
+    seg.length = lengths[slot];
+    bcopy((char *) &seg, buffer, sizeof(SegmentHeader));
+    bcopy(segments[slot], buffer + sizeof(SegmentHeader), seg.length);
+
+    outPktHdr.to = farAddr;
+    outMailHdr.to = farBox;
+    outMailHdr.from = box;
+    outMailHdr.length = sizeof(SegmentHeader) + seg.length;
+    postOffice->Send(outPktHdr, outMailHdr, buffer);
+    stats->numSegmentsSent++;
+}
+
+//----------------------------------------------------------------------
+// Connection::SendAck
+// 	Tell the other end we have everything before segment "ack".
+//----------------------------------------------------------------------
+
+void
+Connection::SendAck(int ack)
+{
+    PacketHeader outPktHdr;
+    MailHeader outMailHdr;
+    SegmentHeader seg;
+
+    seg.seq = -1;
+    seg.ack = ack;
+    seg.length = 0;
+    outPktHdr.to = farAddr;
+    outMailHdr.to = farBox;
+    outMailHdr.from = box;
+    outMailHdr.length = sizeof(SegmentHeader);
+    postOffice->Send(outPktHdr, outMailHdr, (char *) &seg);
+}
+
+//----------------------------------------------------------------------
+// Connection::StartTimer
+// 	Make sure a retransmit timer is pending, unless one already is.
+//	A pending timer re-arms itself as long as something is unACKed,
+//	so there is never more than one on the Interrupt queue.
+//----------------------------------------------------------------------
+
+void
+Connection::StartTimer()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (!timerPending) {
+	timerPending = TRUE;
+	interrupt->Schedule(TimerHelper, (int) this, RetransmitTime,
+			    NetworkSendInt);
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Connection::TimerExpired
+// 	Interrupt handler for the retransmit timer.  If the oldest
+//	segment has waited RetransmitTime since the last progress,
+//	wake up the retransmit thread; if progress was made meanwhile,
+//	wait out the rest of the time.  Stop once everything is ACKed.
+//
+//	We can't take the lock here; interrupts are off, which is
+//	enough to read the fields on a single processor.
+//----------------------------------------------------------------------
+
+void
+Connection::TimerExpired()
+{
+    int waited = stats->totalTicks - lastProgress;
+
+    if (sendBase == nextSeq) {
+	timerPending = FALSE;
+	return;
+    }
+    if (waited >= RetransmitTime) {
+	lastProgress = stats->totalTicks;
+	timeout->V();
+	waited = 0;
+    }
+    interrupt->Schedule(TimerHelper, (int) this, RetransmitTime - waited,
+			NetworkSendInt);
+}
+
+//----------------------------------------------------------------------
+// Connection::Retransmit
+// 	Body of the retransmit thread: on each timeout, go back and
+//	send the whole window again.
+//----------------------------------------------------------------------
+
+void
+Connection::Retransmit()
+{
+    for (;;) {
+	timeout->P();
+	lock->Acquire();
+	for (int seq = sendBase; seq < nextSeq; seq++) {
+	    SendSegment(seq);
+	    stats->numRetransmits++;
+	}
+	lastProgress = stats->totalTicks;
+	lock->Release();
+    }
+}
+
+//----------------------------------------------------------------------
+// Connection::Send
+// 	Cut "data" into segments and send them, waiting whenever
+//	"window" segments are already unACKed.  Returns once the
+//	last segment is on the wire; use Flush to wait for the ACKs.
+//
+//	"data" -- the bytes to send
+//	"numBytes" -- how many
+//----------------------------------------------------------------------
+
+int
+Connection::Send(char *data, int numBytes)
+{
+    int done = 0;
+
+    sendLock->Acquire();		// a message from another thread
+    lock->Acquire();			// must not slip into the window
+    while (done < numBytes) {
+	while (nextSeq - sendBase >= window) {
+	    sendWaiting = TRUE;
+	    windowOpen->Wait(lock);
+	}
+	sendWaiting = FALSE;
+
+	int slot = nextSeq % MaxWindow;
+	int n = numBytes - done;
+
+	if (n > (int) SegmentSize)
+	    n = SegmentSize;
+	bcopy(data + done, segments[slot], n);
+	lengths[slot] = n;
+	if (sendBase == nextSeq)
+	    lastProgress = stats->totalTicks;
+	SendSegment(nextSeq++);
+	StartTimer();
+	done += n;
+    }
+    lock->Release();
+    sendLock->Release();
+    return numBytes;
+}
+
+//----------------------------------------------------------------------
+// Connection::Flush
+// 	Wait until the other end has ACKed everything we sent.
+//----------------------------------------------------------------------
+
+void
+Connection::Flush()
+{
+    lock->Acquire();
+    while (sendBase < nextSeq)
+	windowOpen->Wait(lock);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Connection::Receive
+// 	Wait until some stream data has arrived, and return up to
+//	"numBytes" of it.
+//
+//	"into" -- where to put the data
+//	"numBytes" -- the most to return
+//----------------------------------------------------------------------
+
+int
+Connection::Receive(char *into, int numBytes)
+{
+    int n;
+
+    lock->Acquire();
+    while (streamCount == 0)
+	dataAvail->Wait(lock);
+    if (numBytes > streamCount)
+	numBytes = streamCount;
+    for (n = 0; n < numBytes; n++) {
+	into[n] = stream[streamHead];
+	streamHead = (streamHead + 1) % StreamBufferSize;
+    }
+    streamCount -= n;
+    lock->Release();
+    return n;
+}
+
+//----------------------------------------------------------------------
+// Connection::ReceiveSegments
+// 	Body of the receiver thread.  For each segment that arrives in
+//	our mailbox, first take its ACK: everything before it is done,
+//	so slide the send window up.  Then, if it carries the data we
+//	expect next and there's room for it, append it to the stream.
+//	Any data segment gets an ACK back, so a lost ACK is repaired
+//	by the next retransmission: on the segment a waiting Send puts
+//	on the wire once the window has opened, or else on its own.
+//----------------------------------------------------------------------
+
+void
+Connection::ReceiveSegments()
+{
+    PacketHeader inPktHdr;
+    MailHeader inMailHdr;
+    char buffer[MaxMailSize];
+    SegmentHeader seg;
+
+    for (;;) {
+	postOffice->Receive(box, &inPktHdr, &inMailHdr, buffer);
+	bcopy(buffer, (char *) &seg, sizeof(SegmentHeader));
+
+	lock->Acquire();
+	if (seg.ack > sendBase && seg.ack <= nextSeq) {
+	    sendBase = seg.ack;
+	    lastProgress = stats->totalTicks;
+	    windowOpen->Broadcast(lock);
+	}
+	if (seg.length > 0) {
+	    if (seg.seq == expectedSeq
+			&& streamCount + seg.length <= StreamBufferSize) {
+		char *from = buffer + sizeof(SegmentHeader);
+		int tail = (streamHead + streamCount) % StreamBufferSize;
+
+		for (int i = 0; i < seg.length; i++) {
+		    stream[tail] = from[i];
+		    tail = (tail + 1) % StreamBufferSize;
+		}
+		streamCount += seg.length;
+		expectedSeq++;
+		dataAvail->Broadcast(lock);
+	    }
+	    if (!sendWaiting || nextSeq - sendBase >= window)
+		SendAck(expectedSeq);
+	}
+	lock->Release();
+    }
+}
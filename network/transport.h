@@ -0,0 +1,95 @@
+// transport.h
+//	Reliable, ordered byte streams between mailboxes on two machines,
+//	on top of the unreliable PostOffice.
+//
+//	Data is cut into segments that fit in a Mail, numbered in order.
+//	Up to "window" segments may be on their way before the first of
+//	them is acknowledged, so the sender doesn't wait a round trip per
+//	packet.  The receiver takes segments in order only; each segment
+//	that arrives is answered with a cumulative ACK, the number of the
+//	next segment it expects.  Every data segment going back carries
+//	the latest ACK, so when a Send is waiting for the window to open,
+//	the segment it then sends is the answer and no ACK is sent on its
+//	own; otherwise the ACK goes alone.  If the oldest unacknowledged
+//	segment gets no ACK within RetransmitTime ticks, the whole window
+//	is sent again (go-back-N).  A receiver whose buffer is full drops
+//	new segments, and the retransmissions bring them again later.
+//
+//	Each Connection has one mailbox of its own.  A receiver thread
+//	takes what arrives there, and a retransmit thread is woken up by
+//	a timer on the Interrupt queue.
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include "copyright.h"
+#include "post.h"
+
+// Put in front of the data of each segment, inside the Mail.
+struct SegmentHeader {
+    int seq;			// number of this segment
+    int ack;			// next segment we expect from the other side
+    int length;			// bytes of data, 0 for a plain ACK
+};
+
+#define SegmentSize	(MaxMailSize - sizeof(SegmentHeader))
+				// data bytes per segment
+#define MaxWindow	32	// segments in flight, at most
+#define StreamBufferSize ((int) (MaxWindow * SegmentSize))
+				// received bytes not read yet
+#define RetransmitTime	(20 * NetworkTime)
+
+class Connection {
+  public:
+    Connection(NetworkAddress farAddr, MailBoxAddress box,
+	       MailBoxAddress farBox, int window);
+				// talk from our "box" to "farBox" on
+				// machine "farAddr"; "window" is at
+				// most MaxWindow.  Its threads never
+				// exit, so a Connection lives until
+				// the machine halts.
+
+    int Send(char *data, int numBytes);
+				// queue it all, waiting while the window
+				// is full; return "numBytes".  The bytes
+				// of two Sends never interleave.
+    int Receive(char *into, int numBytes);
+				// wait for data; return 1 to "numBytes"
+				// bytes, in order
+    void Flush();		// wait until all sent data is ACKed
+
+    void ReceiveSegments();	// body of the receiver thread
+    void Retransmit();		// body of the retransmit thread
+    void TimerExpired();	// interrupt handler
+
+  private:
+    void SendSegment(int seq);	// (re)send segment "seq"
+    void SendAck(int ack);
+    void StartTimer();
+
+    NetworkAddress farAddr;
+    MailBoxAddress box, farBox;
+    int window;
+    Lock *sendLock;		// one Send at a time
+    Lock *lock;			// guards all of the below
+
+    // sending
+    char segments[MaxWindow][SegmentSize];	// segment seq is in
+    int lengths[MaxWindow];			// slot seq % MaxWindow
+    int sendBase;		// oldest segment not ACKed
+    int nextSeq;		// next segment to fill
+    Condition *windowOpen;	// sendBase moved
+    bool sendWaiting;		// a Send waits on windowOpen
+    bool timerPending;		// TimerExpired is scheduled
+    int lastProgress;		// when sendBase last moved, or the
+				// window was last (re)sent
+    Semaphore *timeout;		// for the retransmit thread
+
+    // receiving
+    int expectedSeq;		// next segment to take
+    char stream[StreamBufferSize];
+    int streamHead, streamCount;
+    Condition *dataAvail;
+};
+
+#endif // TRANSPORT_H
@@ -0,0 +1,73 @@
+/* batch_test.c
+ *    Test program for vectored and batched system calls.
+ *
+ *    Writev writes three buffers in one call and Readv reads them back
+ *    split differently; then ten Writes and a PrintInt are queued in a
+ *    ring and run by a single Submit.  The stats at Halt count the
+ *    traps taken and the calls batched.
+ */
+
+#include "syscall.h"
+
+#define Filename	"batch.dat"
+#define RING_SIZE	16
+#define NWRITES		10
+
+SyscallEntryU entries[RING_SIZE];
+SyscallRingU ring;
+
+void
+Queue(int type, int a0, int a1, int a2, int a3)
+{
+	SyscallEntryU *e = &ring.entries[ring.tail % ring.size];
+
+	e->type = type;
+	e->arg[0] = a0;
+	e->arg[1] = a1;
+	e->arg[2] = a2;
+	e->arg[3] = a3;
+	ring.tail++;
+}
+
+int
+main()
+{
+	IoVecU iov[3];
+	char a[4], b[6], c[2];
+	OpenFileId fd;
+	int i;
+
+	Create(Filename);
+	fd = Open(Filename);
+
+	iov[0].buffer = "abc";
+	iov[0].size = 3;
+	iov[1].buffer = "defghij";
+	iov[1].size = 7;
+	iov[2].buffer = "kl";
+	iov[2].size = 2;
+	PrintInt(Writev(iov, 3, fd, SEEK_POS_U_SET));	/* should be 12 */
+
+	iov[0].buffer = a;
+	iov[0].size = 4;
+	iov[1].buffer = b;
+	iov[1].size = 6;
+	iov[2].buffer = c;
+	iov[2].size = 2;
+	PrintInt(Readv(iov, 3, fd, SEEK_POS_U_SET));	/* should be 12 */
+	PrintInt(b[0]);					/* 'e', 101 */
+
+	/* queue the writes, with one trap for all of them */
+	ring.head = ring.tail = 0;
+	ring.size = RING_SIZE;
+	ring.entries = entries;
+	for (i = 0; i < NWRITES; i++)
+		Queue(SC_Write, (int) "0123456789" + i, 1, fd, SEEK_POS_U_END);
+	Queue(SC_PrintInt, 42, 0, 0, 0);
+	PrintInt(Submit(&ring));			/* should be 11 */
+	PrintInt(ring.head == ring.tail);		/* should be 1 */
+	PrintInt(entries[NWRITES - 1].result);		/* should be 1 */
+
+	Close(fd);
+	Halt();
+}
@@ -0,0 +1,30 @@
+/* console_test.c
+ *    Test program for the buffered console.
+ *
+ *    Writes a long text in one Write: the console takes it a FIFO-full
+ *    per interrupt, so "write interrupts" in the stats is about 1/64 of
+ *    the characters written.  Then echoes lines typed at the keyboard,
+ *    a whole line per Read, until an empty one.
+ */
+
+#include "syscall.h"
+
+#define LINES	20
+#define WIDTH	50
+
+char text[LINES * WIDTH];
+char line[80];
+
+int
+main()
+{
+	int i, n;
+
+	for (i = 0; i < LINES * WIDTH; i++)
+		text[i] = (i % WIDTH == WIDTH - 1) ? '\n' : 'a' + i % 26;
+	Write(text, LINES * WIDTH, ConsoleOutput, SEEK_POS_U_CUR);
+
+	while ((n = Read(line, 80, ConsoleInput, SEEK_POS_U_CUR)) > 1)
+		Write(line, n, ConsoleOutput, SEEK_POS_U_CUR);
+	Halt();
+}
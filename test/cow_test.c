@@ -0,0 +1,43 @@
+/* cow_test.c
+ *    Test program to check copy-on-write Fork.
+ *
+ *    The parent fills a large array, forks a child and yields to it.
+ *    The child only writes a few pages of the array, so only those
+ *    pages should be copied ("Copy-on-write: ... copied" in the stats);
+ *    the parent must still see its own values afterwards.
+ */
+
+#include "syscall.h"
+
+#define ARR_SIZE	2048	/* 64 pages */
+#define STRIDE		512	/* 16 pages */
+
+int arr[ARR_SIZE];
+
+void
+ChildFunc()
+{
+	int i, sum = 0;
+
+	for (i = 0; i < ARR_SIZE; i += STRIDE)
+		arr[i] = -1;
+	for (i = 0; i < ARR_SIZE; i += STRIDE)
+		sum += arr[i];
+	PrintInt(sum);			/* should be -4 */
+	Exit(0);
+}
+
+int
+main()
+{
+	int i, sum = 0;
+
+	for (i = 0; i < ARR_SIZE; i++)
+		arr[i] = 1;
+	Fork(ChildFunc);
+	Yield();
+	for (i = 0; i < ARR_SIZE; i += STRIDE)
+		sum += arr[i];
+	PrintInt(sum);			/* should be 4 */
+	Exit(0);
+}
@@ -0,0 +1,50 @@
+/* dsm_test.c
+ *    Test program for DsmAttach.
+ *
+ *    Run on each of the machines sharing the region, e.g.
+ *	nachos -m 0 -dsm 0 2 -x dsm_test &
+ *	nachos -m 1 -dsm 0 2 -x dsm_test &
+ *
+ *    The machines take turns adding one to a shared counter, passing
+ *    the turn on in the same page, so the page moves back and forth.
+ *    Each machine also counts its own turns in a slot of another page
+ *    that all of them write.  Prints the counter, ROUNDS times the
+ *    number of machines, and 1 if every slot is ROUNDS.  The machines
+ *    keep running afterwards, to serve the others; stop them by hand.
+ *
+ *    Waiting loops Yield: without -rs nothing preempts a user program,
+ *    and the kernel threads that answer the other machines must run.
+ */
+
+#include "syscall.h"
+
+#define ROUNDS	10
+
+int
+main()
+{
+	int node, numNodes, i, ok = 1;
+	int *shared = (int *) DsmAttach(&node, &numNodes);
+	int *turn = &shared[0], *counter = &shared[1];
+	int *slots = &shared[32];	/* the next page */
+
+	if ((int) shared == -1) {
+		Print("DsmAttach failed", 16);
+		Exit(-1);
+	}
+	for (i = 0; i < ROUNDS; i++) {
+		while (*turn != node)
+			Yield();	/* let the kernel take messages */
+		(*counter)++;
+		slots[node]++;
+		*turn = (node + 1) % numNodes;
+	}
+	while (*counter != ROUNDS * numNodes)
+		Yield();
+	for (i = 0; i < numNodes; i++)
+		if (slots[i] != ROUNDS)
+			ok = 0;
+	PrintInt(*counter);
+	PrintInt(ok);
+	Exit(0);
+}
@@ -19,7 +19,7 @@ main()
 	// create and open file
 	Create(Filename);
 	fid = Open(Filename);
-	if(fid == 0) {
+	if(fid == -1) {
 		Print("open file fail\n", sizeof("open file fail\n"));
 	}
 
@@ -42,5 +42,10 @@ main()
 	// close file
 	Close(fid);
 
+	// the descriptor is gone, using it again is an error
+	len = Read(rbuf, BUF_SIZE, fid, SEEK_POS_U_SET);
+	Print("Read after Close:", sizeof("Read after Close:"));
+	PrintInt(len);		// should be -1
+
 	Exit(0);
 }
@@ -0,0 +1,86 @@
+/* futex_test.c
+ *    Test program for FutexWait/FutexWake.
+ *
+ *    A lock built on a futex word: parent and child each add 1 to a
+ *    counter ROUNDS times, yielding in the middle of the update, so
+ *    the other one finds the lock held and sleeps in FutexWait.  The
+ *    word and the counter sit in one page that is a futex page before
+ *    the Fork, so both processes write the same memory.  Run without
+ *    -rs: a process is only switched out in a syscall, so testing and
+ *    setting the word is atomic.  The parent should print -1, 0, then
+ *    2 * ROUNDS; "Futex: waits that slept" in the stats should be more
+ *    than 0.
+ */
+
+#include "syscall.h"
+
+#define PAGE_SIZE	128
+#define ROUNDS		5
+
+int pad[2 * PAGE_SIZE / sizeof(int)];	/* holds one whole page */
+int *shared;
+
+#define lockWord	shared[0]	/* 1 if held */
+#define waiters		shared[1]	/* sleeping on lockWord */
+#define counter		shared[2]
+#define done		shared[3]	/* the child finished */
+
+void
+Lock()
+{
+	while (lockWord != 0) {
+		waiters++;
+		FutexWait(&lockWord, 1);
+		waiters--;
+	}
+	lockWord = 1;
+}
+
+void
+Unlock()
+{
+	lockWord = 0;
+	if (waiters > 0)
+		FutexWake(&lockWord, 1);
+}
+
+void
+AddRounds()
+{
+	int i, value;
+
+	for (i = 0; i < ROUNDS; i++) {
+		Lock();
+		value = counter;
+		Yield();
+		counter = value + 1;
+		Unlock();
+	}
+}
+
+void
+ChildFunc()
+{
+	AddRounds();
+	done = 1;
+	FutexWake(&done, 1);
+	Exit(0);
+}
+
+int
+main()
+{
+	shared = (int *) (((int) pad + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+
+	/* the value is not 1, so this returns at once; it also makes the
+	 * page a futex page before the Fork */
+	PrintInt(FutexWait(&lockWord, 1));	/* should be -1 */
+	PrintInt(FutexWake(&lockWord, 1));	/* should be 0, nobody waits */
+
+	Fork(ChildFunc);
+	AddRounds();
+	while (done == 0)
+		FutexWait(&done, 0);
+	PrintInt(counter);		/* should be 2 * ROUNDS */
+	Exit(0);
+}
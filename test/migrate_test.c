@@ -0,0 +1,49 @@
+/* migrate_test.c
+ *    Test program for Migrate.
+ *
+ *    Start the target first, then run the program on the source:
+ *	nachos -m 1 -mg 2 &
+ *	nachos -m 0 -mg 2 -x migrate_test
+ *
+ *    Fills an array larger than physical memory, so part of it is in
+ *    the swap file when the process moves, and sums it; moves to
+ *    machine 1; there sums it again, which fetches the swapped pages
+ *    from machine 0.  Machine 1 prints the sum, and 1 if it is the
+ *    same; both machines report the exit status, the sum modulo 100.
+ *    Stop machine 1 by hand.
+ */
+
+#include "syscall.h"
+
+#define N	2048		/* 8K, twice physical memory */
+
+int data[N];
+int tag = 12345;		/* initialized data comes along, too */
+
+int
+sum()
+{
+	int i, s = tag;
+
+	for (i = 0; i < N; i++)
+		s += data[i];
+	return s;
+}
+
+int
+main()
+{
+	int i, before, after;
+
+	for (i = 0; i < N; i++)
+		data[i] = i * 7 + 1;
+	before = sum();
+	if (Migrate(1) < 0) {
+		Print("Migrate failed", 14);
+		Exit(-1);
+	}
+	after = sum();
+	PrintInt(after);
+	PrintInt(after == before);
+	Exit(after % 100);
+}
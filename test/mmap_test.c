@@ -0,0 +1,58 @@
+/* mmap_test.c
+ *    Test program for Mmap/Munmap: sort a file of integers in place,
+ *    sort.c style, through a mapping of the file instead of reading it
+ *    into an array.
+ *
+ *    The file is bigger than half of physical memory, so some of its
+ *    pages are evicted while sorting and must come back from the file.
+ */
+
+#include "syscall.h"
+
+#define N	512	/* 16 pages of integers */
+#define CHUNK	32
+
+int buf[CHUNK];
+
+int
+main()
+{
+    OpenFileId fd;
+    int *A;
+    int i, j, tmp;
+
+    /* write the integers in reverse sorted order */
+    Create("mmap.dat");
+    fd = Open("mmap.dat");
+    for (i = 0; i < N; i += CHUNK) {
+	for (j = 0; j < CHUNK; j++)
+	    buf[j] = N - (i + j);
+	Write((char *) buf, sizeof(buf), fd, SEEK_POS_U_CUR);
+    }
+
+    A = (int *) Mmap(fd, 0, N * sizeof(int));
+    Close(fd);			/* the mapping keeps the file */
+    if ((int) A == -1) {
+	Print("Mmap failed\n", sizeof("Mmap failed\n"));
+	Exit(-1);
+    }
+
+    /* then sort! */
+    for (i = 0; i < N - 1; i++)
+        for (j = 0; j < (N - 1 - i); j++)
+	   if (A[j] > A[j + 1]) {	/* out of order -> need to swap ! */
+	      tmp = A[j];
+	      A[j] = A[j + 1];
+	      A[j + 1] = tmp;
+    	   }
+    Munmap((char *) A);
+
+    /* the file itself is sorted now */
+    fd = Open("mmap.dat");
+    Read((char *) buf, sizeof(int), fd, 0);
+    PrintInt(buf[0]);		/* should be 1 */
+    Read((char *) buf, sizeof(int), fd, (N - 1) * sizeof(int));
+    PrintInt(buf[0]);		/* should be 512 */
+    Close(fd);
+    Exit(0);
+}
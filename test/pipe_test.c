@@ -0,0 +1,62 @@
+/* pipe_test.c
+ *    Test program for Pipe/Dup.
+ *
+ *    The child writes a few pipe-fulls into an anonymous pipe and
+ *    exits; the parent reads them back until end of file, which comes
+ *    once every write end (the child's, the parent's own and a Dup'ed
+ *    one) is closed.  Prints the number of bytes read, 1700, and 1 if
+ *    they came through in order.  Then the same through a named pipe
+ *    opened twice.
+ */
+
+#include "syscall.h"
+
+#define TOTAL	1700	/* more than 3 times the kernel's pipe buffer */
+#define CHUNK	100
+
+OpenFileId fds[2];
+char buf[CHUNK];
+
+void
+Writer()
+{
+	int i, done;
+
+	Close(fds[0]);
+	for (done = 0; done < TOTAL; done += CHUNK) {
+		for (i = 0; i < CHUNK; i++)
+			buf[i] = 'a' + (done + i) % 26;
+		Write(buf, CHUNK, fds[1], SEEK_POS_U_CUR);
+	}
+	Exit(0);
+}
+
+int
+main()
+{
+	OpenFileId extra, named[2], other[2];
+	int i, n, total = 0, ok = 1;
+
+	if (Pipe(fds, 0) < 0)
+		Exit(1);
+	extra = Dup(fds[1], -1);
+	Fork(Writer);
+	Close(fds[1]);
+	Close(extra);
+	while ((n = Read(buf, CHUNK, fds[0], SEEK_POS_U_CUR)) > 0) {
+		for (i = 0; i < n; i++)
+			if (buf[i] != 'a' + (total + i) % 26)
+				ok = 0;
+		total += n;
+	}
+	Close(fds[0]);
+	PrintInt(total);	/* 1700 */
+	PrintInt(ok);		/* 1 */
+
+	Pipe(named, "pipe_test");
+	Pipe(other, "pipe_test");	/* the same pipe */
+	Write("hello", 6, other[1], SEEK_POS_U_CUR);
+	PrintInt(Read(buf, CHUNK, named[0], SEEK_POS_U_CUR));	/* 6 */
+	Print(buf, 6);		/* hello */
+	Exit(0);
+}
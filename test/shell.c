@@ -1,12 +1,50 @@
 #include "syscall.h"
 
+/* Run "cmd", or "cmd1 | cmd2": the output of cmd1 goes through a pipe
+ * to the input of cmd2.  The children inherit ConsoleInput/Output as
+ * they are at Exec, so point them at the pipe around each Exec. */
+void
+Run(char *buffer)
+{
+    SpaceId first, second;
+    OpenFileId fds[2];
+    char *bar = buffer, *end;
+
+    while (*bar != '\0' && *bar != '|')
+	bar++;
+    if (*bar == '\0') {
+	Join(Exec(buffer));
+	return;
+    }
+
+    for (end = bar; end > buffer && end[-1] == ' '; end--)
+	;
+    *end = '\0';
+    for (bar++; *bar == ' '; bar++)
+	;
+    if (Pipe(fds, 0) < 0)
+	return;
+
+    Dup(fds[1], ConsoleOutput);
+    first = Exec(buffer);
+    Close(ConsoleOutput);
+    Close(fds[1]);		/* cmd2 sees end of file when cmd1 exits */
+
+    Dup(fds[0], ConsoleInput);
+    second = Exec(bar);
+    Close(ConsoleInput);
+    Close(fds[0]);
+
+    Join(first);
+    Join(second);
+}
+
 int
 main()
 {
-    SpaceId newProc;
     OpenFileId input = ConsoleInput;
     OpenFileId output = ConsoleOutput;
-    char prompt[2], ch, buffer[60];
+    char prompt[2], buffer[60];
     int i;
 
     prompt[0] = '-';
@@ -26,10 +64,7 @@ main()
 
 	buffer[--i] = '\0';
 
-	if( i > 0 ) {
-		newProc = Exec(buffer);
-		Join(newProc);
-	}
+	if( i > 0 )
+	    Run(buffer);
     }
 }
-
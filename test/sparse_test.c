@@ -0,0 +1,48 @@
+/* sparse_test.c
+ *    Test program to check the sparse address space: a heap grown
+ *    with Sbrk and touched only here and there, and a stack that grows
+ *    well past the initial UserStackSize.
+ *
+ *    The page table stats printed at Exit should show only a few of
+ *    the second level tables allocated.
+ */
+
+#include "syscall.h"
+
+#define HEAP_SIZE	8192	/* 64 pages */
+#define STRIDE		1024	/* touch every 8th page */
+#define DEPTH		64
+
+int
+recurse(int n)
+{
+	int frame[16];		/* 64 bytes of stack per call */
+
+	frame[0] = n;
+	if (n == 0)
+		return 0;
+	return frame[0] + recurse(n - 1);
+}
+
+int
+main()
+{
+	char *heap;
+	int i, sum = 0;
+
+	heap = (char *) Sbrk(HEAP_SIZE);
+	if ((int) heap == -1) {
+		Print("Sbrk failed\n", sizeof("Sbrk failed\n"));
+		Exit(-1);
+	}
+	for (i = 0; i < HEAP_SIZE; i += STRIDE)
+		heap[i] = i / STRIDE;
+	for (i = 0; i < HEAP_SIZE; i += STRIDE)
+		sum += heap[i];
+	PrintInt(sum);			/* should be 28 */
+
+	PrintInt(recurse(DEPTH));	/* should be 2080 */
+
+	Sbrk(-HEAP_SIZE);
+	Exit(0);
+}
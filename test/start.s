@@ -146,6 +146,126 @@ PrintInt:
 	j	$31
 	.end PrintInt
 
+	.globl Sbrk
+	.ent	Sbrk
+Sbrk:
+	addiu $2,$0,SC_Sbrk
+	syscall
+	j	$31
+	.end Sbrk
+
+	.globl Mmap
+	.ent	Mmap
+Mmap:
+	addiu $2,$0,SC_Mmap
+	syscall
+	j	$31
+	.end Mmap
+
+	.globl Munmap
+	.ent	Munmap
+Munmap:
+	addiu $2,$0,SC_Munmap
+	syscall
+	j	$31
+	.end Munmap
+
+	.globl Readv
+	.ent	Readv
+Readv:
+	addiu $2,$0,SC_Readv
+	syscall
+	j	$31
+	.end Readv
+
+	.globl Writev
+	.ent	Writev
+Writev:
+	addiu $2,$0,SC_Writev
+	syscall
+	j	$31
+	.end Writev
+
+	.globl Submit
+	.ent	Submit
+Submit:
+	addiu $2,$0,SC_Submit
+	syscall
+	j	$31
+	.end Submit
+
+	.globl AioRead
+	.ent	AioRead
+AioRead:
+	addiu $2,$0,SC_AioRead
+	syscall
+	j	$31
+	.end AioRead
+
+	.globl AioWrite
+	.ent	AioWrite
+AioWrite:
+	addiu $2,$0,SC_AioWrite
+	syscall
+	j	$31
+	.end AioWrite
+
+	.globl AioWait
+	.ent	AioWait
+AioWait:
+	addiu $2,$0,SC_AioWait
+	syscall
+	j	$31
+	.end AioWait
+
+	.globl FutexWait
+	.ent	FutexWait
+FutexWait:
+	addiu $2,$0,SC_FutexWait
+	syscall
+	j	$31
+	.end FutexWait
+
+	.globl FutexWake
+	.ent	FutexWake
+FutexWake:
+	addiu $2,$0,SC_FutexWake
+	syscall
+	j	$31
+	.end FutexWake
+
+	.globl Pipe
+	.ent	Pipe
+Pipe:
+	addiu $2,$0,SC_Pipe
+	syscall
+	j	$31
+	.end Pipe
+
+	.globl Dup
+	.ent	Dup
+Dup:
+	addiu $2,$0,SC_Dup
+	syscall
+	j	$31
+	.end Dup
+
+	.globl DsmAttach
+	.ent	DsmAttach
+DsmAttach:
+	addiu $2,$0,SC_DsmAttach
+	syscall
+	j	$31
+	.end DsmAttach
+
+	.globl Migrate
+	.ent	Migrate
+Migrate:
+	addiu $2,$0,SC_Migrate
+	syscall
+	j	$31
+	.end Migrate
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
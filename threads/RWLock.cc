@@ -7,16 +7,16 @@ Semaphore* blockParentRW;
 
 RWLock::RWLock()
 {
-	mutex = new Lock("ReaderCnt mutex");
-	wrtLock = new Semaphore("writer lock", 1);
 	readerCnt = 0;
+	writing = false;
+	readerQueue = new List;
+	writerQueue = new List;
 }
 
-
 RWLock::~RWLock()
 {
-	delete mutex;
-	delete wrtLock;
+	delete readerQueue;
+	delete writerQueue;
 }
 
 void
@@ -25,11 +25,17 @@ RWLock::rlock()
 #ifdef FSTEST_MULTI_THREADS_READ_WRITE
 	printf("%s try to aquire rlock...\n", currentThread->getName());
 #endif
-	mutex->Acquire();
-	readerCnt++;
-	if(readerCnt == 1)
-		wrtLock->P();
-	mutex->Release();
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	if(!writing && writerQueue->IsEmpty()) {
+		readerCnt++;
+	} else {
+		// wait for the reader phase after the writer(s) ahead of us;
+		// wunlock counts us in
+		stats->numRWLockWaits++;
+		readerQueue->Append((void *)currentThread);
+		currentThread->Sleep();
+	}
+	(void) interrupt->SetLevel(oldLevel);
 #ifdef FSTEST_MULTI_THREADS_READ_WRITE
 	printf("%s aquired rlock! current readers cnt: %d\n", currentThread->getName(), readerCnt);
 #endif
@@ -38,11 +44,15 @@ RWLock::rlock()
 void
 RWLock::runlock()
 {
-	mutex->Acquire();
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	ASSERT(readerCnt > 0 && !writing);
 	readerCnt--;
-	if(readerCnt == 0)
-		wrtLock->V();
-	mutex->Release();
+	if(readerCnt == 0 && !writerQueue->IsEmpty()) {
+		// end of the reader phase, hand over to the first writer
+		writing = true;
+		scheduler->ReadyToRun((Thread *)writerQueue->Remove());
+	}
+	(void) interrupt->SetLevel(oldLevel);
 #ifdef FSTEST_MULTI_THREADS_READ_WRITE
 	printf("%s released rlock~ current readers cnt: %d\n", currentThread->getName(), readerCnt);
 #endif
@@ -54,7 +64,17 @@ RWLock::wlock()
 #ifdef FSTEST_MULTI_THREADS_READ_WRITE
 	printf("%s try to aquire wlock...\n", currentThread->getName());
 #endif
-	wrtLock->P();
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	if(!writing && readerCnt == 0) {
+		writing = true;
+	} else {
+		// runlock or wunlock hands the lock to us
+		stats->numRWLockWaits++;
+		writerQueue->Append((void *)currentThread);
+		currentThread->Sleep();
+	}
+	ASSERT(writing);
+	(void) interrupt->SetLevel(oldLevel);
 #ifdef FSTEST_MULTI_THREADS_READ_WRITE
 	printf("%s aquired wlock!\n", currentThread->getName());
 #endif
@@ -63,13 +83,26 @@ RWLock::wlock()
 void
 RWLock::wunlock()
 {
-	wrtLock->V();
+	IntStatus oldLevel = interrupt->SetLevel(IntOff);
+	ASSERT(writing);
+	if(!readerQueue->IsEmpty()) {
+		// a reader phase: let in every reader that came while we wrote
+		writing = false;
+		while(!readerQueue->IsEmpty()) {
+			readerCnt++;
+			scheduler->ReadyToRun((Thread *)readerQueue->Remove());
+		}
+	} else if(!writerQueue->IsEmpty()) {
+		scheduler->ReadyToRun((Thread *)writerQueue->Remove());
+	} else {
+		writing = false;
+	}
+	(void) interrupt->SetLevel(oldLevel);
 #ifdef FSTEST_MULTI_THREADS_READ_WRITE
 	printf("%s released wlock~\n", currentThread->getName());
 #endif
 }
 
-
 void InitReadAndWrite()
 {
 	shareMem = -1;
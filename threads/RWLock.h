@@ -1,4 +1,14 @@
-// Solution of 1st type read&write problem
+// Phase-fair readers/writer lock.  Readers and writers take turns in
+// phases: a writer that arrives while readers hold the lock keeps new
+// readers out, and gets the lock when the current readers are gone; when
+// it is done, every reader that queued up meanwhile is let in at once,
+// as one phase, before the next writer.  So neither side can starve the
+// other: a writer waits for at most one reader phase, a reader for at
+// most one writer.
+//
+// As Lock, the lock is handed over to the threads woken up; the state
+// is guarded by disabling interrupts, so an uncontended rlock/runlock
+// is just a counter update.
 #ifndef RWLOCK_H
 #define RWLOCK_H
 
@@ -17,9 +27,10 @@ public:
 	void wunlock();
 
 private:
-	Lock* mutex;
-	Semaphore* wrtLock;
-	int readerCnt;
+	int readerCnt;		// readers holding the lock
+	bool writing;		// a writer holds the lock
+	List* readerQueue;	// readers waiting for the next reader phase
+	List* writerQueue;	// writers waiting, in order
 };
 
 // reader and writer
@@ -240,38 +240,21 @@ void*
 List::RemoveByComp(CompFunctionPtr comp, void* data)
 {
 	void* thing = NULL;
-	bool isFirst = true;
-	ListElement* prev = first;
+	ListElement* prev = NULL;
 
-    if (IsEmpty())
-    	return NULL;
-
-    if (first == last) {	// list had one item, now has none
-        thing = first->item;
-        first = NULL;
-        last = NULL;
-        return thing;
-    }
-
-	for(ListElement* ptr = first; ptr != NULL; ptr = ptr->next) {
+	for(ListElement* ptr = first; ptr != NULL; prev = ptr, ptr = ptr->next) {
 		if(comp(ptr->item, data)) {
 			thing = ptr->item;
 			// remove from list
-			if(isFirst) {
-				first = first->next;
-				prev->next = NULL;
-			} else {
-				if(ptr == last) {
-					last = prev;
-				}
+			if(prev == NULL)
+				first = ptr->next;
+			else
 				prev->next = ptr->next;
-				ptr->next = NULL;
-			}
+			if(ptr == last)
+				last = prev;
+			delete ptr;
 			break;
 		}
-		if(!isFirst)
-			prev = prev->next;
-		isFirst = false;
 	}
 	return thing;
 }
@@ -9,21 +9,34 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
+//		-tr <event types> <trace file>
 //		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-cs <nachos file> <nachos file> -eager -tlb <entries>[:<ways>]
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
-//              -o <other machine id>
+//              -o <other machine id> -tp <other machine id> <window>
+//              -dsm <manager machine id> <number of machines>
+//              -fs -fc <server machine id> -rf <nachos file>
+//              -mg <number of machines>
 //              -z
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -tr records events of the given types (cf. trace.h, "+" for all)
+//	and writes them to the trace file as a Chrome trace at the end
 //    -z prints the copyright message
 //
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
 //    -c tests the console
+//    -cs runs two user programs side by side, to benchmark context
+//	switches (use with -rs, so the timer preempts them)
+//    -eager switches the old way: save registers, flush the TLB and
+//	harvest use bits on every context switch
+//    -tlb sizes the TLB, e.g. "-tlb 64:4" is 64 entries, 4-way set
+//	associative; without ":<ways>" it is fully associative
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
@@ -38,6 +51,15 @@
 //    -n sets the network reliability
 //    -m sets this machine's host id (needed for the network)
 //    -o runs a simple test of the Nachos network software
+//    -tp streams data both ways over a reliable connection with the
+//	given window, and reports the throughput
+//    -dsm shares a region of memory among user programs on machines
+//	0 to <number of machines> - 1 (see DsmAttach in syscall.h)
+//    -fs serves this machine's file system to machines 0 to 3
+//    -fc uses the file system of the machine that serves it
+//    -rf tests a file on the server through the client cache (with -fc)
+//    -mg lets user programs move between machines 0 to <number of
+//	machines> - 1 (see Migrate in syscall.h)
 //
 //  NOTE -- flags are ignored until the relevant assignment.
 //  Some of the flags are interpreted here; some in system.cc.
@@ -62,7 +84,10 @@ extern int testnum;
 extern void ThreadTest(void), Copy(char *unixFile, char *nachosFile);
 extern void Print(char *file), PerformanceTest(void);
 extern void StartProcess(char *file), ConsoleTest(char *in, char *out);
+extern void ContextSwitchTest(char *file1, char *file2);
 extern void MailTest(int networkID);
+extern void TransportTest(int networkID, int window);
+extern void RemoteFileTest(char *name);
 
 //----------------------------------------------------------------------
 // main
@@ -113,6 +138,10 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
             StartProcess(*(argv + 1));
             argCount = 2;
+        } else if (!strcmp(*argv, "-cs")) {	// context switch benchmark
+	    ASSERT(argc > 2);
+            ContextSwitchTest(*(argv + 1), *(argv + 2));
+            argCount = 3;
         } else if (!strcmp(*argv, "-c")) {      // test the console
         	if (argc == 1)
         		ConsoleTest(NULL, NULL);
@@ -156,6 +185,16 @@ main(int argc, char **argv)
 						// start up another nachos
             MailTest(atoi(*(argv + 1)));
             argCount = 2;
+        } else if (!strcmp(*argv, "-tp")) {
+	    ASSERT(argc > 2);
+            Delay(2);
+            TransportTest(atoi(*(argv + 1)), atoi(*(argv + 2)));
+            argCount = 3;
+        } else if (!strcmp(*argv, "-rf")) {
+	    ASSERT(argc > 1);
+            Delay(2);
+            RemoteFileTest(*(argv + 1));
+            argCount = 2;
         }
 #endif // NETWORK
     }
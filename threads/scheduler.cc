@@ -112,10 +112,14 @@ Scheduler::Run (Thread *nextThread)
 {
     Thread *oldThread = currentThread;
     
+    ++stats->numContextSwitches;
 #ifdef USER_PROGRAM			// ignore until running user programs 
     if (currentThread->space != NULL) {	// if this thread is a user program,
-        currentThread->SaveUserState(); // save the user's CPU registers
-        machine->InvalidTLB();
+        if (machine->UseEagerSwitch()) {
+            currentThread->SaveUserState(); // save the user's CPU registers
+            machine->InvalidTLB();
+        }	// otherwise registers stay live until another user thread
+		// needs them, and TLB entries are tagged by asid
         currentThread->space->SaveState();
     }
 #endif
@@ -129,14 +133,14 @@ Scheduler::Run (Thread *nextThread)
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
 	  oldThread->getName(), nextThread->getName());
     
+    TRACE(TraceSwitch, oldThread->getTid(), nextThread->getTid(), 0);
     if(mode == RR) {//!readyList->IsEmpty()
-    	printf("TEST: Run: set interrput before thread%d runs\n", nextThread->getTid());
     	interrupt->Schedule(RRInterruptHandler, nextThread->getTid(), TimerTicks, TimerInt);
     }
 
 #ifdef USER_PROGRAM
     if (currentThread->space != NULL) {		// if there is an address space
-        currentThread->RestoreUserState();     // to restore, do it.
+        currentThread->LoadUserState();     // to restore, do it.
 	currentThread->space->RestoreState();
     }
 #endif
@@ -196,15 +200,17 @@ Scheduler::RRInterruptHandler(int threadId)
 		if(currentThread->getLeftTimeSlice() == 0)
 		{
 			// no timeslice left, yield CPU
-			printf("TEST: RRInterruptHandler: YieldOnReturn thread%d \n", threadId);
+			TRACE(TraceTimeSlice, threadId, 0, 1);
 			interrupt->YieldOnReturn();
 		} else {
 			// add next interrupt into the interrupt queue
-			printf("TEST: RRInterruptHandler: set interrput when thread%d runs\n", threadId);
+			TRACE(TraceTimeSlice, threadId,
+					currentThread->getLeftTimeSlice(), 0);
 			interrupt->Schedule(RRInterruptHandler, threadId, TimerTicks, TimerInt);
 		}
 	} else {
-		printf("TEST: RRInterruptHandler: NOT MATCH interrupt%d curThread%d runs\n", threadId, currentThread->getTid());
+		TRACE(TraceTimeSlice, threadId, -1, 0);	// stale, its thread
+								// switched out
 	}
 }
 
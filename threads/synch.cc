@@ -57,6 +57,9 @@ Semaphore::~Semaphore()
 //	value and decrementing must be done atomically, so we
 //	need to disable interrupts before checking the value.
 //
+//	A waiter is handed the V that wakes it up (see V), so it does not
+//	have to check the value again: nobody can take it in between.
+//
 //	Note that Thread::Sleep assumes that interrupts are disabled
 //	when it is called.
 //----------------------------------------------------------------------
@@ -66,11 +69,11 @@ Semaphore::P()
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
     
-    while (value == 0) { 			// semaphore not available
+    if (value == 0) { 				// semaphore not available
 	queue->Append((void *)currentThread);	// so go to sleep
-	currentThread->Sleep();
-    } 
-    value--; 					// semaphore available, 
+	currentThread->Sleep();			// V handed its value to us
+    } else
+	value--; 				// semaphore available, 
 						// consume its value
     
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
@@ -93,32 +96,52 @@ Semaphore::V()
     thread = (Thread *)queue->Remove();
     if (thread != NULL)	   // make thread ready, consuming the V immediately
 	scheduler->ReadyToRun(thread);
-    value++;
+    else
+	value++;
     (void) interrupt->SetLevel(oldLevel);
 }
 
 
-// Dummy functions -- so we can compile our later assignments 
-// Note -- without a correct implementation of Condition::Wait(), 
-// the test case in the network assignment won't work!
+//----------------------------------------------------------------------
+// Lock
+// 	A lock with handoff: Release gives the lock straight to the first
+//	waiter, which is woken up already holding it.  A thread that comes
+//	along in between can't barge in and take the lock, so a woken
+//	waiter never has to go back to sleep, and waiters get the lock in
+//	FIFO order.
+//
+//	Condition variables move their waiters to the lock's queue instead
+//	of waking them up (see Condition::Signal), so waking many waiters
+//	costs one switch per waiter, each when it gets the lock.
+//
+//	There is a single CPU, so a waiter never spins: the holder cannot
+//	release the lock while we keep the CPU.
+//----------------------------------------------------------------------
+
 Lock::Lock(char* debugName)
 {
 	name = debugName;
-	sem = new Semaphore(debugName, 1);
+	waiters = new List;
 	holdThread = NULL;
 }
 
 Lock::~Lock()
 {
-	delete sem;
+	delete waiters;
 }
 
 void Lock::Acquire()
 {
 	IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-	sem->P();
-	holdThread = currentThread;
+	if (holdThread == NULL) {
+		holdThread = currentThread;	// uncontended, no queueing
+	} else {
+		stats->numLockWaits++;
+		waiters->Append((void *)currentThread);
+		currentThread->Sleep();		// Release handed it to us
+	}
+	ASSERT(holdThread == currentThread);
 
 	(void) interrupt->SetLevel(oldLevel);
 }
@@ -127,22 +150,24 @@ void Lock::Release()
 {
 	IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
-	sem->V();
-	holdThread = NULL;
+	holdThread = (Thread *)waiters->Remove();
+	if (holdThread != NULL)
+		scheduler->ReadyToRun(holdThread);
 
 	(void) interrupt->SetLevel(oldLevel);
 }
 
-bool Lock::isHeldByCurrentThread()
+// Queue "thread", asleep, to be handed the lock after those already
+// waiting for it.  Used by Condition; the lock must be held.
+void Lock::AddWaiter(Thread *thread)
 {
-	bool res = false;
-	IntStatus oldLevel = interrupt->SetLevel(IntOff);
-
-	if(holdThread->getTid() == currentThread->getTid())
-		res = true;
+	ASSERT(holdThread != NULL);
+	waiters->Append((void *)thread);
+}
 
-	(void) interrupt->SetLevel(oldLevel);
-	return res;
+bool Lock::isHeldByCurrentThread()
+{
+	return holdThread == currentThread;
 }
 
 Condition::Condition(char* debugName)
@@ -157,16 +182,15 @@ Condition::~Condition()
 
 void Condition::Wait(Lock* conditionLock)
 {
-	// ASSERT(FALSE);TODO
 	IntStatus oldLevel = interrupt->SetLevel(IntOff);
 
 	ASSERT(conditionLock->isHeldByCurrentThread());
 
 	waitingList->Append(currentThread);
 	conditionLock->Release();
-	currentThread->Sleep();
-
-	conditionLock->Acquire();
+	currentThread->Sleep();		// Signal queued us on the lock, and
+					// we are woken up holding it
+	ASSERT(conditionLock->isHeldByCurrentThread());
 	(void) interrupt->SetLevel(oldLevel);
 }
 
@@ -177,9 +201,8 @@ void Condition::Signal(Lock* conditionLock)
 	ASSERT(conditionLock->isHeldByCurrentThread());
 
 	Thread* thread = (Thread*)waitingList->Remove();
-	if (thread != NULL){
-		scheduler->ReadyToRun(thread);
-	}
+	if (thread != NULL)
+		conditionLock->AddWaiter(thread);
 
 	(void) interrupt->SetLevel(oldLevel);
 }
@@ -190,12 +213,9 @@ void Condition::Broadcast(Lock* conditionLock)
 
 	ASSERT(conditionLock->isHeldByCurrentThread());
 
-	Thread* thread = NULL;
-	while (!waitingList->IsEmpty()){
-		thread = (Thread*)waitingList->Remove();
-		if(thread != NULL)
-			scheduler->ReadyToRun(thread);
-	}
+	// no thundering herd: they get the lock one after the other
+	while (!waitingList->IsEmpty())
+		conditionLock->AddWaiter((Thread*)waitingList->Remove());
 
 	(void) interrupt->SetLevel(oldLevel);
 }
@@ -76,12 +76,14 @@ class Lock {
 					// holds this lock.  Useful for
 					// checking in Release, and in
 					// Condition variable ops below.
+    void AddWaiter(Thread *thread);	// for Condition: "thread" gets
+					// the lock after the others
 
   private:
     char* name;				// for debugging
-    // plus some other stuff you'll need to define
-    Semaphore* sem;// use semaphore to implement lock, we set init value 1
-    Thread* holdThread;
+    List* waiters;			// threads asleep in Acquire, or
+					// moved here by a Condition
+    Thread* holdThread;			// NULL if the lock is FREE
 };
 
 // The following class defines a "condition variable".  A condition
@@ -104,9 +106,9 @@ class Lock {
 //
 // In Nachos, condition variables are assumed to obey *Mesa*-style
 // semantics.  When a Signal or Broadcast wakes up another thread,
-// it simply puts the thread on the ready list, and it is the responsibility
-// of the woken thread to re-acquire the lock (this re-acquire is
-// taken care of within Wait()).  By contrast, some define condition
+// it simply queues the thread for the lock, and the thread runs once
+// it is handed the lock (this re-acquire is taken care of within
+// Wait()).  By contrast, some define condition
 // variables according to *Hoare*-style semantics -- where the signalling
 // thread gives up control over the lock and the CPU to the woken thread,
 // which runs immediately and gives back control over the lock to the 
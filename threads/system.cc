@@ -7,6 +7,14 @@
 
 #include "copyright.h"
 #include "system.h"
+#ifdef USER_PROGRAM
+#include "console.h"
+#endif
+#ifdef NETWORK
+#include "dsm.h"
+#include "fileserver.h"
+#include "migrate.h"
+#endif
 
 // This defines *all* of the global data structures used by Nachos.
 // These are all initialized and de-allocated by this file.
@@ -36,10 +44,15 @@ SynchDisk   *synchDisk;
 #ifdef USER_PROGRAM	// requires either FILESYS or FILESYS_STUB
 Machine *machine;	// user program memory and registers
 MemManager *memManager;	// memory manager
+SynchConsole *synchConsole;	// console of the user programs
 #endif
 
 #ifdef NETWORK
 PostOffice *postOffice;
+Dsm *dsm;
+FileServer *fileServer;
+FileClient *fileClient;
+Migrator *migrator;
 #endif
 
 #ifdef VM
@@ -78,14 +91,12 @@ static void
 RRTimerInterruptHandler(int dummy)
 {
 	currentThread->decLeftTimeSlice();
-	printf("TEST: RRTimerInterruptHandler: thread %d, leftSlice:%d\n",
-			currentThread->getTid(), currentThread->getLeftTimeSlice());
-	if (currentThread->getLeftTimeSlice() == 0
-			&& interrupt->getStatus() != IdleMode)
-	{
-		printf("TEST: RRTimerInterruptHandler: YieldOnReturn\n");
+	bool yield = currentThread->getLeftTimeSlice() == 0
+			&& interrupt->getStatus() != IdleMode;
+	TRACE(TraceTimeSlice, currentThread->getTid(),
+			currentThread->getLeftTimeSlice(), yield);
+	if (yield)
 	    interrupt->YieldOnReturn();
-	}
 }
 
 //----------------------------------------------------------------------
@@ -108,6 +119,9 @@ Initialize(int argc, char **argv)
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    bool eagerSwitch = FALSE;	// old context switch, for comparison
+    int tlbEntries = DefaultTLBSize;	// TLB geometry, -tlb <entries>[:<ways>]
+    int tlbWays = 0;		// 0 means fully associative
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
@@ -115,6 +129,11 @@ Initialize(int argc, char **argv)
 #ifdef NETWORK
     double rely = 1;		// network reliability
     int netname = 0;		// UNIX socket name
+    int dsmManager = 0;		// -dsm <manager> <nodes>
+    int dsmNodes = 0;		// 0: no distributed shared memory
+    bool serveFiles = FALSE;	// -fs
+    int fileServerAddr = -1;	// -fc <server>
+    int migrateNodes = 0;	// -mg <nodes>, 0: no migration
 #endif
     
     for (argc--, argv++; argc > 0; argc -= argCount, argv += argCount) {
@@ -126,6 +145,10 @@ Initialize(int argc, char **argv)
 	    	debugArgs = *(argv + 1);
 	    	argCount = 2;
 	    }
+	} else if (!strcmp(*argv, "-tr")) {
+	    ASSERT(argc > 2);
+	    TraceInit(*(argv + 1), *(argv + 2));	// record these events
+	    argCount = 3;
 	} else if (!strcmp(*argv, "-rs")) {
 	    ASSERT(argc > 1);
 	    RandomInit(atoi(*(argv + 1)));	// initialize pseudo-random
@@ -136,6 +159,25 @@ Initialize(int argc, char **argv)
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-eager"))
+	    eagerSwitch = TRUE;
+	else if (!strcmp(*argv, "-tlb")) {
+	    ASSERT(argc > 1);
+	    char *ways = strchr(*(argv + 1), ':');
+	    tlbEntries = atoi(*(argv + 1));
+	    tlbWays = (ways != NULL) ? atoi(ways + 1) : 0;
+	    if (tlbEntries <= 0 || tlbWays < 0
+		    || (tlbWays > 0 && tlbWays < tlbEntries
+			&& tlbEntries % tlbWays != 0)) {
+		// the sets must split the entries evenly
+		printf("Usage: -tlb <entries>[:<ways>], <ways> dividing "
+		       "<entries>; using %d entries, fully associative\n",
+		       DefaultTLBSize);
+		tlbEntries = DefaultTLBSize;
+		tlbWays = 0;
+	    }
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -150,6 +192,21 @@ Initialize(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    netname = atoi(*(argv + 1));
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-dsm")) {
+	    ASSERT(argc > 2);
+	    dsmManager = atoi(*(argv + 1));
+	    dsmNodes = atoi(*(argv + 2));
+	    argCount = 3;
+	} else if (!strcmp(*argv, "-fs")) {
+	    serveFiles = TRUE;
+	} else if (!strcmp(*argv, "-fc")) {
+	    ASSERT(argc > 1);
+	    fileServerAddr = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-mg")) {
+	    ASSERT(argc > 1);
+	    migrateNodes = atoi(*(argv + 1));
+	    argCount = 2;
 	}
 #endif
     }
@@ -182,8 +239,10 @@ Initialize(int argc, char **argv)
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
     
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg, LRU, true);	// this must come first
+    machine = new Machine(debugUserProg, LRU, true, eagerSwitch,
+    			tlbEntries, tlbWays);	// this must come first
     memManager = new MemManager(NumPhysPages);
+    synchConsole = new SynchConsole(NULL, NULL);
 #endif
 
 #ifdef FILESYS
@@ -196,7 +255,19 @@ Initialize(int argc, char **argv)
 #endif
 
 #ifdef NETWORK
-    postOffice = new PostOffice(netname, rely, 10);
+    postOffice = new PostOffice(netname, rely, 20);
+    dsm = NULL;
+    if (dsmNodes > 0)
+	dsm = new Dsm(netname, dsmManager, dsmNodes);
+    fileServer = NULL;
+    if (serveFiles)
+	fileServer = new FileServer();
+    fileClient = NULL;
+    if (fileServerAddr >= 0)
+	fileClient = new FileClient(fileServerAddr);
+    migrator = NULL;
+    if (migrateNodes > 0)
+	migrator = new Migrator(netname, migrateNodes);
 #endif
 
 #ifdef VM
@@ -212,11 +283,13 @@ void
 Cleanup()
 {
     printf("\nCleaning up...\n");
+    TraceExport();
 #ifdef NETWORK
     delete postOffice;
 #endif
     
 #ifdef USER_PROGRAM
+    delete synchConsole;
     delete machine;
 #endif
 
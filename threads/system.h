@@ -17,6 +17,7 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "trace.h"
 
 
 // Initialization and cleanup routines
@@ -42,6 +43,8 @@ extern Thread *tid_pointer[MAX_THREADS_NUM]; // thread pointer, match tid to thr
 #include "memmanager.h"
 extern Machine* machine;	// user program memory and registers
 extern MemManager* memManager; // Memory Manager to alloc/dealloc physical memory
+class SynchConsole;
+extern SynchConsole* synchConsole; // console of the user programs
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
@@ -59,6 +62,14 @@ extern SynchDisk   *synchDisk;
 #ifdef NETWORK
 #include "post.h"
 extern PostOffice* postOffice;
+class Dsm;
+extern Dsm* dsm;		// distributed shared memory, NULL unless -dsm
+class FileServer;
+class FileClient;
+extern FileServer* fileServer;	// serving our file system, NULL unless -fs
+extern FileClient* fileClient;	// using another's, NULL unless -fc
+class Migrator;
+extern Migrator* migrator;	// moving processes, NULL unless -mg
 #endif
 
 #ifdef VM
@@ -19,6 +19,9 @@
 #include "switch.h"
 #include "synch.h"
 #include "system.h"
+#ifdef NETWORK
+#include "dsm.h"
+#endif
 
 #define STACK_FENCEPOST 0xdeadbeef//0xdeadbf37//0xdeadbea7‬//0xdeadbeef	// this is put at the top of the0xdeadbea7
 					// execution stack, for detecting 
@@ -103,6 +106,10 @@ Thread::~Thread()
     // no need to dealloc tid_pointer[tid]?
 
     ASSERT(this != currentThread);
+#ifdef USER_PROGRAM
+    if (machine != NULL && machine->userRegOwner == this)
+    	machine->userRegOwner = NULL;	// registers are never saved now
+#endif
     if (stack != NULL)
 	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
     OrphanActiveChildren();
@@ -374,6 +381,20 @@ Thread::StackAllocate (VoidFunctionPtr func, int arg)
 
 void
 Thread::SaveUserState()
+{
+    CopyUserRegisters();
+    ++stats->numUserRegSaves;
+}
+
+//----------------------------------------------------------------------
+// Thread::CopyUserRegisters
+//	Copy the machine's user registers into this thread, without
+//	counting it as a context switch save; Fork uses it to start the
+//	child from the parent's registers.
+//----------------------------------------------------------------------
+
+void
+Thread::CopyUserRegisters()
 {
     for (int i = 0; i < NumTotalRegs; i++)
     	userRegisters[i] = machine->ReadRegister(i);
@@ -395,6 +416,29 @@ Thread::RestoreUserState()
 	machine->WriteRegister(i, userRegisters[i]);
 }
 
+//----------------------------------------------------------------------
+// Thread::LoadUserState
+//	Make this thread's user registers live in the machine on a context
+//	switch.  The registers of the previous user thread are only saved
+//	when another user thread needs the machine, so a switch to a kernel
+//	thread and back costs no register copies at all.
+//----------------------------------------------------------------------
+
+void
+Thread::LoadUserState()
+{
+    Thread *owner = machine->userRegOwner;
+
+    if (!machine->UseEagerSwitch()) {
+	if (owner == this)
+	    return;			// still live in the machine
+	if (owner != NULL)
+	    owner->SaveUserState();
+    }
+    RestoreUserState();
+    machine->userRegOwner = this;
+}
+
 //----------------------------------------------------------------------
 // Thread::InitUserState
 //	Initialize the CPU state of a user program before executing.
@@ -435,25 +479,21 @@ Thread::WriteRegister(int num, int value)
 void
 Thread::DeleteAddrSpace()
 {
-	int size = space->GetNumPages();
-	int ppn = -1;
-	for (int i = 0; i < size; i++)
-	{
-		// Clear pages in physical memory.
-		if (space->getPTEValid(i))
-		{
-			ppn = space->getPTEPPN(i);
-			memManager->Clear(ppn);
-			memManager->ZeroPhyMemPage(ppn);
-		}
-#ifdef VM
-		// Clear pages in swapping space.
-		if (space->getPTESwappingPage(i) != -1)
-		{
-			swapManager->Clear(space->getPTESwappingPage(i));
-		}
+	space->GetPrintBuffer()->Flush();
+	// the aio daemon may still be filling our requests' buffers
+	space->GetAioTable()->WaitAll();
+	// mapped files get their dirty pages back
+	space->MunmapAll();
+	space->GetFdTable()->CloseAll();
+#ifdef NETWORK
+	// the DSM pages go back to the manager
+	if(dsm != NULL)
+		dsm->Detach(space);
 #endif
-	}
+	// drop our TLB entries, the asid may be reused by the next thread
+	machine->FlushTLB(space->GetASID());
+	// Clear pages in physical memory and in swapping space.
+	space->ReleasePages(0, space->GetNumPages());
 }
 
 int
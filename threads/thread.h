@@ -142,7 +142,11 @@ class Thread {
 
   public:
     void SaveUserState();		// save user-level register state
+    void CopyUserRegisters();		// copy the machine's user registers,
+    					// not counted as a save
     void RestoreUserState();		// restore user-level register state
+    void LoadUserState();		// make user-level registers live in the
+    					// machine, saving the last owner lazily
     void InitUserState();		// initialize user-level register state
     void WriteRegister(int num, int value); // set user register value
 
@@ -301,6 +301,186 @@ void BarrierTest()
 
 }
 
+//----------------------------------------------------------------------
+// LockBenchmark
+// 	Acquire/release throughput under contention: LockThreads threads
+//	each take the lock LockRounds times, and yield while holding it,
+//	so the others are always queued on it.  Prints the simulated ticks
+//	and context switches per acquire.
+//----------------------------------------------------------------------
+
+#define LockThreads	4
+#define LockRounds	100
+
+static Lock *benchLock;
+static Condition *benchCond;
+static Semaphore *benchDone;
+static int benchCounter;
+
+static void
+LockBenchThread(int rounds)
+{
+    for (int i = 0; i < rounds; i++) {
+	benchLock->Acquire();
+	benchCounter++;
+	currentThread->Yield();		// let the others pile up
+	benchLock->Release();
+    }
+    benchDone->V();
+}
+
+static void
+BenchReport(char *what, int ops, int ticks, int switches)
+{
+    printf("%s: %d ops, %d ticks, %.2f ticks/op, %.2f switches/op\n", what,
+	ops, ticks, (double) ticks / ops, (double) switches / ops);
+}
+
+void
+LockBenchmark()
+{
+    benchLock = new Lock("bench lock");
+    benchDone = new Semaphore("bench done", 0);
+    benchCounter = 0;
+
+    int ticks = stats->totalTicks;
+    int switches = stats->numContextSwitches;
+    for (int i = 0; i < LockThreads; i++) {
+	Thread* t = Thread::getInstance("lock bench");
+	t->Fork(LockBenchThread, LockRounds);
+    }
+    for (int i = 0; i < LockThreads; i++)
+	benchDone->P();
+    ASSERT(benchCounter == LockThreads * LockRounds);
+    BenchReport("Lock acquire/release", benchCounter,
+	stats->totalTicks - ticks, stats->numContextSwitches - switches);
+
+    delete benchLock;
+    delete benchDone;
+}
+
+//----------------------------------------------------------------------
+// BroadcastBenchmark
+// 	LockThreads threads wait on a condition, and are woken up by
+//	Broadcast, LockRounds times.  With handoff each waiter runs once
+//	per round, when it is given the lock; nobody wakes up only to go
+//	back to sleep on the lock.
+//----------------------------------------------------------------------
+
+static void
+BroadcastBenchThread(int rounds)
+{
+    benchLock->Acquire();
+    for (int i = 0; i < rounds; i++) {
+	int seen = benchCounter;
+	while (benchCounter == seen)
+	    benchCond->Wait(benchLock);
+    }
+    benchLock->Release();
+    benchDone->V();
+}
+
+void
+BroadcastBenchmark()
+{
+    benchLock = new Lock("bench lock");
+    benchCond = new Condition("bench cond");
+    benchDone = new Semaphore("bench done", 0);
+    benchCounter = 0;
+
+    for (int i = 0; i < LockThreads; i++) {
+	Thread* t = Thread::getInstance("broadcast bench");
+	t->Fork(BroadcastBenchThread, LockRounds);
+    }
+    currentThread->Yield();		// let them all wait
+
+    int ticks = stats->totalTicks;
+    int switches = stats->numContextSwitches;
+    for (int i = 0; i < LockRounds; i++) {
+	benchLock->Acquire();
+	benchCounter++;
+	benchCond->Broadcast(benchLock);
+	benchLock->Release();
+	currentThread->Yield();		// the waiters run, and wait again
+    }
+    for (int i = 0; i < LockThreads; i++)
+	benchDone->P();
+    BenchReport("Broadcast wakeups", LockThreads * LockRounds,
+	stats->totalTicks - ticks, stats->numContextSwitches - switches);
+
+    delete benchLock;
+    delete benchCond;
+    delete benchDone;
+}
+
+//----------------------------------------------------------------------
+// RWLockBenchmark
+// 	Readers keep the file-style RWLock busy (each yields while holding
+//	it, so reader phases overlap), while one writer tries to get in.
+//	Prints the ops done and the longest time the writer had to wait;
+//	with a readers-first lock the writer would wait until the readers
+//	were all done.
+//----------------------------------------------------------------------
+
+#define RWReaders	4
+#define RWRounds	50
+
+static RWLock *benchRWLock;
+static int benchMaxWriterWait;
+
+static void
+RWBenchReader(int rounds)
+{
+    for (int i = 0; i < rounds; i++) {
+	benchRWLock->rlock();
+	currentThread->Yield();
+	benchRWLock->runlock();
+    }
+    benchDone->V();
+}
+
+static void
+RWBenchWriter(int rounds)
+{
+    for (int i = 0; i < rounds; i++) {
+	int start = stats->totalTicks;
+	benchRWLock->wlock();
+	if (stats->totalTicks - start > benchMaxWriterWait)
+	    benchMaxWriterWait = stats->totalTicks - start;
+	benchCounter++;
+	currentThread->Yield();
+	benchRWLock->wunlock();
+	currentThread->Yield();
+    }
+    benchDone->V();
+}
+
+void
+RWLockBenchmark()
+{
+    benchRWLock = new RWLock();
+    benchDone = new Semaphore("bench done", 0);
+    benchCounter = 0;
+    benchMaxWriterWait = 0;
+
+    int ticks = stats->totalTicks;
+    int switches = stats->numContextSwitches;
+    for (int i = 0; i < RWReaders; i++) {
+	Thread* t = Thread::getInstance("rw bench reader");
+	t->Fork(RWBenchReader, RWRounds);
+    }
+    Thread* w = Thread::getInstance("rw bench writer");
+    w->Fork(RWBenchWriter, RWRounds / 5);
+    for (int i = 0; i < RWReaders + 1; i++)
+	benchDone->P();
+    BenchReport("RWLock ops", RWReaders * RWRounds + RWRounds / 5,
+	stats->totalTicks - ticks, stats->numContextSwitches - switches);
+    printf("RWLock: longest writer wait %d ticks\n", benchMaxWriterWait);
+
+    delete benchRWLock;
+    delete benchDone;
+}
+
 void
 ThreadTest()
 {
@@ -332,6 +512,15 @@ ThreadTest()
     case 9:
     	BarrierTest();
     	break;
+    case 10:
+    	LockBenchmark();
+    	break;
+    case 11:
+    	BroadcastBenchmark();
+    	break;
+    case 12:
+    	RWLockBenchmark();
+    	break;
     default:
 	printf("No test specified.\n");
 	break;
@@ -0,0 +1,125 @@
+// trace.cc
+//	Routines to record trace events in a ring, and to write them out
+//	as a Chrome trace.  See trace.h.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "trace.h"
+#include "system.h"
+
+#include <stdio.h>
+#include <string.h>
+
+unsigned traceMask = 0;		// nothing is traced without -tr
+
+static TraceRecord *ring = NULL;
+static unsigned numRecorded = 0;	// ever, wrapping around; the
+				// newest is at (numRecorded - 1) %
+				// TraceRingSize
+static unsigned numKept = 0;	// of them still in the ring
+static char *traceFile = NULL;
+
+// Per type: the -tr letter, the event name, and its argument names
+// (NULL where unused).
+static struct {
+    char letter;
+    const char *name;
+    const char *args[3];
+} traceTypes[NumTraceTypes] = {
+    { 's', "run", { "from", "to", NULL } },
+    { 'r', "time slice", { "tid", "left", "yield" } },
+    { 't', "TLB scan", { "entry", "use", "dirty" } },
+    { 't', "TLB refill", { "entry", "vpn", "replaced vpn" } },
+    { 'p', "page in", { "vpn", "frame", "swap page" } },
+    { 'p', "page out", { "vpn", "frame", "swap page" } },
+    { 'c', "syscall", { "code", "arg", NULL } }
+};
+
+//----------------------------------------------------------------------
+// TraceInit
+// 	Enable the event types whose letters are in "types", "+" for all
+//	of them, and allocate the ring.
+//
+//	"fileName" -- where TraceExport writes the trace
+//----------------------------------------------------------------------
+
+void
+TraceInit(char *types, char *fileName)
+{
+    for (int t = 0; t < NumTraceTypes; t++)
+	if (strchr(types, '+') != NULL
+		|| strchr(types, traceTypes[t].letter) != NULL)
+	    traceMask |= 1 << t;
+    ring = new TraceRecord[TraceRingSize];
+    traceFile = fileName;
+}
+
+//----------------------------------------------------------------------
+// TraceEvent
+// 	Record an event; called by TRACE only if its type is enabled.
+//	Just stores: it runs on paths like the TLB refill.
+//----------------------------------------------------------------------
+
+void
+TraceEvent(int type, int arg0, int arg1, int arg2)
+{
+    TraceRecord *r = &ring[numRecorded++ % TraceRingSize];
+
+    if (numKept < TraceRingSize)
+	numKept++;
+
+    r->ticks = (stats != NULL) ? stats->totalTicks : 0;
+    r->type = type;
+    r->tid = (currentThread != NULL) ? currentThread->getTid() : -1;
+    r->arg[0] = arg0;
+    r->arg[1] = arg1;
+    r->arg[2] = arg2;
+}
+
+//----------------------------------------------------------------------
+// TraceExport
+// 	Write the events still in the ring, oldest first, to the trace
+//	file in the Chrome trace event format, with a tick as the unit
+//	of time.  A context switch ends the "run" slice of the thread
+//	switched from and begins one of the thread switched to.
+//----------------------------------------------------------------------
+
+void
+TraceExport()
+{
+    FILE *fp;
+    int sep = ' ';
+
+    if (ring == NULL)
+	return;
+    if ((fp = fopen(traceFile, "w")) == NULL) {
+	printf("Trace: can't write %s\n", traceFile);
+	return;
+    }
+    fprintf(fp, "{\"traceEvents\": [\n");
+    for (unsigned i = numRecorded - numKept; i != numRecorded; i++, sep = ',') {
+	TraceRecord *r = &ring[i % TraceRingSize];
+
+	if (r->type == TraceSwitch) {
+	    fprintf(fp, "%c{\"name\": \"run\", \"ph\": \"E\", \"ts\": %d, "
+		    "\"pid\": 0, \"tid\": %d}\n", sep, r->ticks, r->arg[0]);
+	    fprintf(fp, ",{\"name\": \"run\", \"ph\": \"B\", \"ts\": %d, "
+		    "\"pid\": 0, \"tid\": %d}\n", r->ticks, r->arg[1]);
+	    continue;
+	}
+	fprintf(fp, "%c{\"name\": \"%s\", \"ph\": \"i\", \"s\": \"t\", "
+		"\"ts\": %d, \"pid\": 0, \"tid\": %d, \"args\": {", sep,
+		traceTypes[r->type].name, r->ticks, r->tid);
+	for (int a = 0; a < 3 && traceTypes[r->type].args[a] != NULL; a++)
+	    fprintf(fp, "%s\"%s\": %d", (a > 0) ? ", " : "",
+		    traceTypes[r->type].args[a], r->arg[a]);
+	fprintf(fp, "}}\n");
+    }
+    fprintf(fp, "]}\n");
+    fclose(fp);
+    printf("Trace: %u events, %u of them written to %s\n", numRecorded,
+	   numKept, traceFile);
+}
@@ -0,0 +1,65 @@
+// trace.h
+//	Low-overhead event tracing.
+//
+//	TRACE records a fixed-size binary event, stamped with
+//	stats->totalTicks and the current thread, in a ring in memory;
+//	when the ring is full the oldest events are overwritten.  Nothing
+//	is formatted until Nachos halts, when the ring is written out as
+//	a Chrome trace (JSON), to be opened in chrome://tracing or
+//	Perfetto.  Context switches show up as a timeline of which thread
+//	runs; everything else as instant events with their arguments.
+//
+//	Each event type has a bit in traceMask, set by -tr; a disabled
+//	TRACE costs a load and a test.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "copyright.h"
+
+#define TraceRingSize	8192	// events kept; a power of two, so the
+				// ring index survives the count wrapping
+
+// The event types, and the letter that enables each with -tr.
+enum TraceType {
+    TraceSwitch,		// 's' from thread, to thread
+    TraceTimeSlice,		// 'r' thread, slice left, 1 if it yields
+    TraceTLBScan,		// 't' TLB entry, use bit, dirty bit: the
+				//     replacement hand passed over it
+    TraceTLBRefill,		// 't' TLB entry, vpn, vpn it replaced
+				//     (-1 if it was empty)
+    TracePageIn,		// 'p' vpn, frame, swap page it came from
+				//     (-1: loaded from the executable,
+				//     or a zero-filled heap or stack page)
+    TracePageOut,		// 'p' vpn, frame, swap page it went to
+    TraceSyscall,		// 'c' code, first argument
+    NumTraceTypes
+};
+
+// What the ring holds, 20 bytes an event.
+struct TraceRecord {
+    int ticks;			// stats->totalTicks
+    short type;
+    short tid;			// current thread, -1 before there is one
+    int arg[3];
+};
+
+extern unsigned traceMask;	// bit per TraceType
+
+extern void TraceInit(char *types, char *fileName);	// enable the
+				// types with these letters ("+" is all),
+				// and write the trace to "fileName"
+extern void TraceEvent(int type, int arg0, int arg1, int arg2);
+extern void TraceExport();	// write the trace, at halt
+
+#define TRACE(type, arg0, arg1, arg2)					\
+    do {								\
+	if (traceMask & (1 << (type)))					\
+	    TraceEvent(type, arg0, arg1, arg2);				\
+    } while (0)
+
+#endif // TRACE_H
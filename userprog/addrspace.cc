@@ -18,7 +18,10 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
-#include "noff.h"
+#include "futex.h"
+#ifdef NETWORK
+#include "dsm.h"
+#endif
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
@@ -57,20 +60,22 @@ AddrSpace::AllocAddrSpace(int tid)
 		return false;
 	threadId = tid;
 
-	NoffHeader noffH;
-	unsigned int i, size;
-	bool shareFromParent = false;
+	unsigned int size;
+	AddrSpace* parAddr = NULL;
 
 	if (execFile == NULL) {
 		// syscall - fork: copy parent memoey and execFile
 		// getParent AddrSpace( copy execFile & read page table content)
 		Thread* thread = tid_pointer[tid];
 		Thread* parent = thread->getParent();
-		AddrSpace* parAddr = parent->getAddrSpace();
-		// execFile copy, size = parent size
+		parAddr = parent->getAddrSpace();
+		// execFile copy, same layout as the parent
 		numPages = parAddr->GetNumPages();
+		noffH = parAddr->noffH;
+		heapStart = parAddr->heapStart;
+		brk = parAddr->brk;
 		execFile = parAddr->getExecFileCopy();
-		shareFromParent = true;
+		fdTable.Inherit(parAddr->GetFdTable());
 	} else {
 		// execFile != NULL
 		execFile->ReadAt((char *)&noffH, sizeof(noffH), 0);
@@ -79,115 +84,82 @@ AddrSpace::AllocAddrSpace(int tid)
 		   	SwapHeader(&noffH);
 		ASSERT(noffH.noffMagic == NOFFMAGIC);
 
-		// how big is address space?
-		size = noffH.code.size + noffH.initData.size + noffH.uninitData.size
-				+ UserStackSize;	// we need to increase the size
-									// to leave room for the stack
-		numPages = divRoundUp(size, PageSize);
+		// how big is address space? The program image sits at the
+		// bottom, the heap starts on the page after it and the stack
+		// grows down from the top; only what is touched gets mapped
+		size = noffH.code.size + noffH.initData.size + noffH.uninitData.size;
+		heapStart = brk = divRoundUp(size, PageSize) * PageSize;
+		numPages = UserAddrSpacePages;
+		if (heapStart / PageSize > (int) numPages - MaxUserStackPages) {
+			printf("AllocAddrSpace: program too big, %d pages\n",
+					heapStart / PageSize);
+			return false;
+		}
 	}
 	size = numPages * PageSize;
 
-
-	//ASSERT(numPages <= NumPhysPages);		// check we're not trying
-							// to run anything too big --
-							// at least until we have
-							// virtual memory
-
-	// check if we have enough empty physical memory
-	int numEmptyPages = memManager->NumEmpty();
-	int allocedPages = numPages;
-	if(numPages > numEmptyPages) {
-		DEBUG('a', "No enough physical memory, request %d, fact %d\n",
-								numPages, numEmptyPages);
-		// return NULL;
-		printf("AllocAddrSpace: No enough physical memory, request %d, fact %d\n",
-								numPages, numEmptyPages);
-		allocedPages = numEmptyPages;
-	}
-
 	DEBUG('a', "Initializing address space, num pages %d, size %d\n",
 						numPages, size);
 
-	// if use lazy-load strategy, set allocedPages 0, then all PTE.valid will be false
-	if(machine->UseLazyLoad())
-		allocedPages = 0;
-
-	// first, set up the translation
-	int physicalAddr = 0;
-	pageTable = new TranslationEntry[numPages];
-	for (i = 0; i < allocedPages; i++) {//numPages; i++) {
-		// valid Pages
-		pageTable[i].virtualPage = i;	// for now, virtual page # = first empty phys page #
-		pageTable[i].physicalPage = memManager->FindNext();
-		memManager->SetPhyMemPage(pageTable[i].physicalPage, threadId, i);
-		pageTable[i].valid = TRUE;
-		pageTable[i].use = FALSE;
-		pageTable[i].dirty = FALSE;
-		pageTable[i].readOnly = FALSE;  // if the code segment was entirely on
-						// a separate page, we could set its
-						// pages to be read-only
-		// zero out each page in address space, to zero the unitialized data segment
-		// and the stack segment
-		pageTable[i].lastUseTime = stats->totalTicks;
-		memManager->UpdateLastUsedTime(pageTable[i].physicalPage, pageTable[i].lastUseTime);
-		pageTable[i].swappingPage = -1;
-		physicalAddr = pageTable[i].physicalPage * PageSize;
-		bzero(machine->mainMemory + physicalAddr, PageSize);
-	}
-	for ( ; i < numPages; i++) {
-		// invalid Pages
-		pageTable[i].virtualPage = i;
-		pageTable[i].physicalPage = -1;
-		pageTable[i].valid = FALSE;
-		pageTable[i].use = FALSE;
-		pageTable[i].dirty = FALSE;
-		pageTable[i].readOnly = FALSE;
-		pageTable[i].lastUseTime = 0;
-		pageTable[i].swappingPage = -1;
+	pageTable = new PageTable(numPages);
+	if(parAddr != NULL) {
+		// syscall - fork: share the parent's pages copy-on-write,
+		// no need to copy anything now
+		return ShareFromParent(parAddr);
 	}
 
-
-	if(shareFromParent) {
-		// syscall - fork: code is not in execFile, code is in host memory
-		// no need to copy from host memory to Nachos main memory
-		Thread* thread = tid_pointer[tid];
-		Thread* parent = thread->getParent();
-		AddrSpace* parAddr = parent->getAddrSpace();
-		return CopyMemFromParent(parAddr);
-	}
-	// if (execFile != NULL)
-	// then, copy in the code and data segments into memory
-	// byte by byte
-	int  bufSize =  noffH.code.size > noffH.initData.size ? noffH.code.size : noffH.initData.size;
-	char *buffer = new char[bufSize];
-
-	DEBUG('a', "Initializing code segment, at 0x%x, size %d\n",
-		    		   noffH.code.virtualAddr, noffH.code.size);
-	int va, vpn, offset, pa;
-	int cnt = 0, allocedSize = allocedPages * PageSize;	// just load alloced size in main memory, because code+initData size might be larger than alloced size
-	execFile->ReadAt(buffer, noffH.code.size, noffH.code.inFileAddr);
-	for(i = 0; i < noffH.code.size && cnt < allocedSize; i++, cnt++)
-	{
-		va = noffH.code.virtualAddr + i;
-		vpn = va / PageSize;
-		offset = va % PageSize;
-		pa = pageTable[vpn].physicalPage * PageSize + offset;
-		machine->mainMemory[pa] = buffer[i];
+	// first, set up the translation. With the lazy-load strategy every
+	// page faults in on first touch. Otherwise map the image and the
+	// initial stack now, as far as empty physical memory goes; image
+	// pages another process running this executable has in memory are
+	// shared, the rest are loaded from execFile
+	if(!machine->UseLazyLoad()) {
+		int wanted = 0, mapped = 0;
+		for (int i = 0; i < heapStart / PageSize; i++, wanted++)
+			if (MapCachedPage(i)) {
+				mapped++;
+			} else if (MapPage(i)) {
+				LazyLoad(pageTable->Lookup(i)->physicalPage, i);
+				mapped++;
+			}
+		for (int i = numPages - divRoundUp(UserStackSize, PageSize);
+				i < (int) numPages; i++, wanted++)
+			if (MapPage(i))
+				mapped++;
+		if (mapped < wanted)
+			printf("AllocAddrSpace: No enough physical memory, request %d, fact %d\n",
+								wanted, mapped);
 	}
+	return true;
+}
 
-	DEBUG('a', "Initializing data segment, at 0x%x, size %d\n",
-		   		noffH.initData.virtualAddr, noffH.initData.size);
-	execFile->ReadAt(buffer, noffH.initData.size, noffH.initData.inFileAddr);
-	for(i = 0; i < noffH.initData.size && cnt < allocedSize; i++, cnt++)
-	{
-		va = noffH.initData.virtualAddr + i;
-		vpn = va / PageSize;
-		offset = va % PageSize;
-		pa = pageTable[vpn].physicalPage * PageSize + offset;
-		machine->mainMemory[pa] = buffer[i];
-	}
+//----------------------------------------------------------------------
+// AddrSpace::MapPage
+// 	Back virtual page "vpn" with an empty physical frame, zeroed, to
+//	zero the unitialized data segment and the stack segment.  Return
+//	FALSE if there is no empty frame; the page then faults in later.
+//----------------------------------------------------------------------
 
-	delete[] buffer;
+bool
+AddrSpace::MapPage(int vpn)
+{
+	if (memManager->NumEmpty() == 0)
+		return false;
+
+	TranslationEntry *pte = pageTable->Map(vpn);
+	pte->physicalPage = memManager->FindNext();
+	memManager->SetPhyMemPage(pte->physicalPage, threadId, vpn);
+	pte->valid = TRUE;
+	pte->use = FALSE;
+	pte->dirty = FALSE;
+	pte->copyOnWrite = FALSE;
+	pte->readOnly = FALSE;  // if the code segment was entirely on
+					// a separate page, we could set its
+					// pages to be read-only
+	pte->lastUseTime = stats->totalTicks;
+	memManager->UpdateLastUsedTime(pte->physicalPage, pte->lastUseTime);
+	pte->swappingPage = -1;
+	bzero(machine->mainMemory + pte->physicalPage * PageSize, PageSize);
 	return true;
 }
 
@@ -209,6 +181,16 @@ AddrSpace::AllocAddrSpace(int tid)
 AddrSpace::AddrSpace(OpenFile *executable)
 {
 	execFile = executable;
+	threadId = -1;
+	pageTable = NULL;
+	numPages = 0;
+	heapStart = brk = 0;
+	numTLBHit = numTLBMiss = 0;
+	for (int i = 0; i < MaxMmapRegions; i++)
+		mmaps[i].file = NULL;
+	dsmAttached = FALSE;
+	remotePages = NULL;
+	futexPages = NULL;
 
 	/*
     NoffHeader noffH;
@@ -274,8 +256,14 @@ AddrSpace::AddrSpace(OpenFile *executable)
 
 AddrSpace::~AddrSpace()
 {
+   if (machine->currentSpace == this)
+	machine->currentSpace = NULL;
+   for (int i = 0; i < MaxMmapRegions; i++)
+	delete mmaps[i].file;
    delete pageTable;
    delete execFile;
+   delete remotePages;
+   delete futexPages;
 }
 
 //----------------------------------------------------------------------
@@ -315,20 +303,40 @@ AddrSpace::InitRegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	// For now, nothing!
-//  Update phyMemPageTable based on current thread addrspace->pageTable
+//  TLB entries are tagged with our asid and stay in the TLB, and the
+//  use bits are harvested by Machine::LRUSwapPage when a victim is
+//  needed, so there is nothing to do unless the machine runs with the
+//  old eager switch.
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() 
 {
-	int vpn = 0;
-	int phyNum = 0;
-	int lastUsedTime = 0;
-	// update phyMemPageTable by pageTable
-	for(int i = 0; i<numPages; i++) {
-		phyNum = pageTable[i].physicalPage;
-		lastUsedTime = pageTable[i].lastUseTime;
-		memManager->UpdateLastUsedTime(phyNum, lastUsedTime);
+	if(machine->UseEagerSwitch())
+		HarvestUseBits();
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::HarvestUseBits
+//  Update phyMemPageTable based on this addrspace->pageTable, for
+//  the LRU page replacement.
+//----------------------------------------------------------------------
+
+void AddrSpace::HarvestUseBits()
+{
+	// update phyMemPageTable by pageTable, only the second level
+	// tables that exist can hold resident pages
+	if(pageTable == NULL)
+		return;
+	for(int t = 0; t<pageTable->NumTables(); t++) {
+		TranslationEntry *table = pageTable->Table(t);
+		if(table == NULL)
+			continue;
+		for(int j = 0; j<PTEsPerTable; j++) {
+			if(table[j].valid)
+				memManager->UpdateLastUsedTime(table[j].physicalPage,
+						table[j].lastUseTime);
+		}
+		stats->numPTEScanned += PTEsPerTable;
 	}
 }
 
@@ -337,13 +345,43 @@ void AddrSpace::SaveState()
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table,
+//      and which asid its TLB entries carry.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() 
 {
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->currentASID = threadId;
+    machine->currentSpace = this;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PrintTLBStats
+// 	Print the TLB hits and misses taken while this address space
+//	was running.
+//----------------------------------------------------------------------
+
+void AddrSpace::PrintTLBStats()
+{
+    int total = numTLBHit + numTLBMiss;
+
+    printf("TLB (thread %d): hits %d, miss %d, hit rate %.1f%%\n", threadId,
+	numTLBHit, numTLBMiss, total > 0 ? 100.0 * numTLBHit / total : 0.0);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PrintPageTableStats
+// 	Print how much page table this address space needed, against
+//	what a flat table of the same size would have cost.
+//----------------------------------------------------------------------
+
+void AddrSpace::PrintPageTableStats()
+{
+    printf("Page table (thread %d): %d of %d second level tables, %d of %d PTEs\n",
+	threadId, pageTable->NumAllocated(), pageTable->NumTables(),
+	pageTable->NumAllocated() * PTEsPerTable, numPages);
 }
 
 int AddrSpace::GetNumPages()
@@ -351,130 +389,573 @@ int AddrSpace::GetNumPages()
 	return numPages;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::IsLegalPage
+// 	Return TRUE if "vpn" may be touched by the program: it is part of
+//	the program image or the heap below the break, it is part of an
+//	Mmap region or the DSM region, or it lies in the stack region at
+//	the top of the address space.  Pages in between are holes; touching them kills
+//	the program.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsLegalPage(int vpn)
+{
+	if(vpn < 0 || vpn >= (int) numPages)
+		return false;
+	if(vpn < divRoundUp(brk, PageSize) || IsMappedPage(vpn)
+			|| IsDsmPage(vpn))
+		return true;
+	return vpn >= (int) numPages - MaxUserStackPages;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Sbrk
+// 	Grow (or shrink) the heap by "increment" bytes and return the old
+//	break, or -1 if the heap would run below its start or into the
+//	Mmap region.  Growing only moves the break, the new pages are
+//	zero-filled when first touched; pages given back are freed now.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Sbrk(int increment)
+{
+	int oldBrk = brk;
+	int newBrk = brk + increment;
+
+	if(newBrk < heapStart
+			|| divRoundUp(newBrk, PageSize) > MmapBase())
+		return -1;
+	if(increment < 0) {
+		ReleasePages(divRoundUp(newBrk, PageSize), divRoundUp(oldBrk, PageSize));
+		machine->FlushTLB(threadId);
+	}
+	brk = newBrk;
+	return oldBrk;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleasePages
+// 	Free the physical frames and swap pages held by virtual pages
+//	[from, to), and reset their entries so that they fault in as
+//	fresh pages if touched again.  Ranges without a second level
+//	table are skipped.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::ReleasePages(int from, int to)
+{
+	for(int vpn = from; vpn < to; vpn++) {
+		TranslationEntry *pte = pageTable->Lookup(vpn);
+		if(pte == NULL) {
+			vpn = (vpn / PTEsPerTable + 1) * PTEsPerTable - 1;
+			continue;
+		}
+		// Clear pages in physical memory, unless a copy-on-write
+		// Fork still shares them. A futex page drops our pin
+		if(pte->valid) {
+			bool futex = IsFutexPage(vpn);
+			if(futex) {
+				memManager->Unpin(pte->physicalPage);
+				futexPages->Clear(vpn);
+			}
+			if(memManager->Unshare(pte->physicalPage) == 0) {
+				if(futex)
+					FutexPageFreed();
+				memManager->Clear(pte->physicalPage);
+				memManager->ZeroPhyMemPage(pte->physicalPage);
+			}
+			pte->valid = FALSE;
+		}
+#ifdef VM
+		// Clear pages in swapping space (drop our reference).
+		if(pte->swappingPage != -1) {
+			swapManager->Clear(pte->swappingPage);
+			pte->swappingPage = -1;
+		}
+#endif
+	}
+}
+
+//----------------------------------------------------------------------
+// LoadSegment
+// 	Read the part of NOFF segment "seg" that falls into the virtual
+//	page starting at "startAddr" into main memory at "phyPosition".
+//----------------------------------------------------------------------
+
+static void
+LoadSegment(OpenFile *file, Segment *seg, int startAddr, int phyPosition)
+{
+	int from = max(startAddr, seg->virtualAddr);
+	int to = min(startAddr + PageSize, seg->virtualAddr + seg->size);
+
+	if (from < to)
+		file->ReadAt(&machine->mainMemory[phyPosition + from - startAddr],
+				to - from, seg->inFileAddr + from - seg->virtualAddr);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LazyLoad
+// 	Fill physical page "phyPageNum" with virtual page "vpn" as the
+//	program starts out: uninitData, heap and stack are zero, code and
+//	initData come from execFile (one page may hold parts of both).
+//	Pages of an Mmap region come from the mapped file.
+//
+//	An image page loaded from the file goes into the executable page
+//	cache and is mapped copy-on-write, so other processes running the
+//	same executable can share it (see MapCachedPage).
+//----------------------------------------------------------------------
+
 int
 AddrSpace::LazyLoad(int phyPageNum, int vpn)
 {
-	NoffHeader noffH;
 	int startAddr = vpn * PageSize;
 	int phyPosition = phyPageNum * PageSize;
 
-	execFile->ReadAt((char *)&noffH, sizeof(noffH), 0);
-	// virtual mem: code + initData + uninitData + UserStackSize
-	if (startAddr < noffH.code.size) {
-		if(startAddr + PageSize < noffH.code.size)
-		{
-			// load from code
-			execFile->ReadAt(&machine->mainMemory[phyPosition], PageSize, noffH.code.inFileAddr + startAddr);
-			printf("LazyLoad: from code\n");
-		} else {
-			// load from code and initData
-			int codeSize = noffH.code.size - startAddr;
-			execFile->ReadAt(&machine->mainMemory[phyPosition], codeSize, noffH.code.inFileAddr + startAddr);
-			int initDataSize = startAddr + PageSize - noffH.code.size;
-			execFile->ReadAt(&machine->mainMemory[phyPosition + codeSize], initDataSize, noffH.initData.inFileAddr);
-			printf("LazyLoad: from code and initData\n");
-		}
-	} else if(startAddr < noffH.code.size + noffH.initData.size)
-	{
-		// load from initData
-		startAddr -= noffH.code.size;
-		int size = (startAddr + PageSize > noffH.initData.size)
-				? (startAddr + PageSize - noffH.initData.size)
-					: PageSize ;
-		execFile->ReadAt(&machine->mainMemory[phyPosition], size, noffH.initData.inFileAddr + startAddr);
-		printf("LazyLoad: from initData\n");
-		if(size < PageSize)
-		{
-			// part load from uninitData, which equals to 0
-			bzero(machine->mainMemory + (phyPosition + size), PageSize - size);
-			printf("LazyLoad: from uninitData or UserStack\n");
-		}
-	} else {
-		// load from uninitData or userstack, which equals to 0
-		bzero(machine->mainMemory + phyPosition, PageSize);
-		printf("LazyLoad: from uninitData or UserStack\n");
+	bzero(machine->mainMemory + phyPosition, PageSize);
+	MmapRegion *r = FindRegion(vpn);
+	if (r != NULL) {
+		LoadMappedPage(r, phyPageNum, vpn);
+		return 0;
+	}
+	if (startAddr >= heapStart)	// uninitialized data, heap or stack
+		return 0;
+
+	LoadSegment(execFile, &noffH.code, startAddr, phyPosition);
+	LoadSegment(execFile, &noffH.initData, startAddr, phyPosition);
+	stats->numExecPagesLoaded++;
+
+	if (execFile->GetHdrSector() >= 0) {
+		TranslationEntry *pte = pageTable->Map(vpn);
+		memManager->SetExecPage(phyPageNum, execFile->GetHdrSector(), vpn);
+		pte->readOnly = TRUE;
+		pte->copyOnWrite = TRUE;
 	}
+	return 0;
+}
 
+//----------------------------------------------------------------------
+// AddrSpace::MapCachedPage
+// 	If image page "vpn" of our executable is in the executable page
+//	cache, map that physical page copy-on-write instead of loading the
+//	page again.  Return FALSE if it is not cached (or vpn is not an
+//	image page).
+//----------------------------------------------------------------------
 
-	return 0;
+bool
+AddrSpace::MapCachedPage(int vpn)
+{
+	int sector = execFile->GetHdrSector();
+	if (sector < 0 || vpn >= heapStart / PageSize)
+		return false;
+
+	int phyPageNum = memManager->ClaimExecPage(sector, vpn, threadId);
+	if (phyPageNum < 0)
+		return false;
+
+	TranslationEntry *pte = pageTable->Map(vpn);
+	pte->physicalPage = phyPageNum;
+	pte->valid = TRUE;
+	pte->use = FALSE;
+	pte->dirty = FALSE;
+	pte->readOnly = TRUE;
+	pte->copyOnWrite = TRUE;
+	pte->lastUseTime = stats->totalTicks;
+	memManager->UpdateLastUsedTime(phyPageNum, pte->lastUseTime);
+	stats->numExecPagesShared++;
+	return true;
 }
 
 int
 AddrSpace::getPTESwappingPage(int vpn)
 {
-	if(vpn < 0 || vpn > numPages)
+	TranslationEntry *pte = pageTable->Lookup(vpn);
+	if(pte == NULL)
 		return -1;
-	return pageTable[vpn].swappingPage;
+	return pte->swappingPage;
 }
 
 void
 AddrSpace::setPTESwappingPage(int vpn, int swappingPage)
 {
-	if(vpn < 0 || vpn > numPages)
+	TranslationEntry *pte = pageTable->Lookup(vpn);
+	if(pte == NULL)
 		return ;
-	pageTable[vpn].swappingPage = swappingPage;
+	pte->swappingPage = swappingPage;
 }
 
 bool
 AddrSpace::getPTEValid(int vpn)
 {
-	if(vpn < 0 || vpn > numPages)
-		return -1;
-	return pageTable[vpn].valid;
+	TranslationEntry *pte = pageTable->Lookup(vpn);
+	if(pte == NULL)
+		return FALSE;
+	return pte->valid;
 }
 
 void
 AddrSpace::setPTEValid(int vpn, bool value)
 {
-	if(vpn < 0 || vpn > numPages)
+	TranslationEntry *pte = pageTable->Lookup(vpn);
+	if(pte == NULL)
 		return ;
-	pageTable[vpn].valid = value;
+	pte->valid = value;
 }
 
 int
 AddrSpace::getPTEPPN(int vpn)
 {
-	if(vpn < 0 || vpn > numPages)
+	TranslationEntry *pte = pageTable->Lookup(vpn);
+	if(pte == NULL)
 		return -1;
-	return pageTable[vpn].physicalPage;
+	return pte->physicalPage;
 }
 
+TranslationEntry*
+AddrSpace::GetPTE(int vpn)
+{
+	if(pageTable == NULL)		// still being set up
+		return NULL;
+	return pageTable->Lookup(vpn);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ShareFromParent
+// 	Copy-on-write Fork: share every page the parent has in memory or
+//	in swap instead of copying it.  Both page tables map the same
+//	physical page (or swap page), read-only and marked copyOnWrite,
+//	and the page and swap page reference counts go up.  The first
+//	write from either side gets its own copy, see CopyOnWrite.
+//	Futex pages are the exception: both sides map the same page
+//	writable for good, and each holds a pin on it (see futex.h).
+//----------------------------------------------------------------------
+
 bool
-AddrSpace::CopyMemFromParent(AddrSpace* parAddr)
+AddrSpace::ShareFromParent(AddrSpace* parAddr)
 {
-	for(int i = 0; i<numPages; i++)
+	// the parent's TLB items may still allow writes: write their bits
+	// back and drop them
+	machine->SyncTLB();
+	machine->FlushTLB(parAddr->GetASID());
+
+	PageTable *parTable = parAddr->pageTable;
+	for(int t = 0; t<parTable->NumTables(); t++)
 	{
-		int childPhyPage = pageTable[i].physicalPage;
-		int parPhyPage = parAddr->getPTEPPN(i);
-		if(pageTable[i].valid)
+		TranslationEntry *parTab = parTable->Table(t);
+		if(parTab == NULL)
+			continue;
+		for(int j = 0; j<PTEsPerTable; j++)
 		{
-			// child PTE is valid
-			if(parAddr->getPTEValid(i)) {
-				// parent page is in MainMemory
-				memcpy(&machine->mainMemory[childPhyPage], &machine->mainMemory[parPhyPage], PageSize);
-			} else if(parAddr->getPTESwappingPage(i) == -1) {
-				// parent page is in execFile
-				LazyLoad(childPhyPage, i);
-			} else {
-				// parent page is in Swapping
-				int swappingPage = parAddr->getPTESwappingPage(i);
-				swapManager->swapOutFromDisk(childPhyPage, swappingPage, true);
-			}
-		} else { // !pageTable[i].valid
-			// child PTE is invalid
-			if(parAddr->getPTEValid(i)) {
-				// parent page is in MainMemory
-				int swappingPage = swapManager->swapIntoDisk(parPhyPage);
-				pageTable[i].swappingPage = swappingPage;
-			} else if(parAddr->getPTESwappingPage(i) == -1) {
-				// parent page is in execFile
-				// do nothing
-			} else {
-				// parent page is in Swapping
-				int swappingPage = parAddr->getPTESwappingPage(i);
-				pageTable[i].swappingPage = swapManager->copySwapping(swappingPage);
+			TranslationEntry *parPTE = &parTab[j];
+			if(parAddr->IsMappedPage(parPTE->virtualPage)
+					|| parAddr->IsDsmPage(parPTE->virtualPage))
+				continue;	// mappings are not inherited
+			if(parAddr->IsFutexPage(parPTE->virtualPage)) {
+				memManager->Share(parPTE->physicalPage);
+				memManager->Pin(parPTE->physicalPage);
+				*pageTable->Map(parPTE->virtualPage) = *parPTE;
+				SetFutexPage(parPTE->virtualPage);
+				continue;
 			}
+			if(parPTE->valid)
+				memManager->Share(parPTE->physicalPage);
+			else if(parPTE->swappingPage != -1)
+				swapManager->Share(parPTE->swappingPage);
+			else
+				continue;	// still in execFile, or never touched
+			TranslationEntry *pte = pageTable->Map(parPTE->virtualPage);
+			*pte = *parPTE;
+			parPTE->readOnly = pte->readOnly = TRUE;
+			parPTE->copyOnWrite = pte->copyOnWrite = TRUE;
+			stats->numPagesShared++;
 		}
 	}
 	return true;
 }
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+// 	Handle a write to a page shared by a copy-on-write Fork.  The last
+//	address space mapping the page simply takes it over; the others
+//	get a private copy in a fresh physical page.  Return FALSE if
+//	"vpn" is not a copy-on-write page, so the write is a real
+//	protection fault.
+//
+//	A read-only page of the DSM region has to be made writable on
+//	every machine but ours first.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyOnWrite(int vpn)
+{
+#ifdef NETWORK
+	if(IsDsmPage(vpn))
+		return dsm->Fault(this, vpn, TRUE);
+#endif
+	TranslationEntry *pte = pageTable->Lookup(vpn);
+	if(pte == NULL || !pte->copyOnWrite)
+		return false;
+
+	// our TLB item is read-only
+	machine->FlushTLBPage(threadId, vpn);
+	if(pte->valid && memManager->RefCount(pte->physicalPage) > 1) {
+		int sharedPage = pte->physicalPage;
+		int phyPageNum = machine->AllocFrame(vpn);
+		if(phyPageNum < 0)
+			return false;
+		if(pte->valid) {
+			memcpy(&machine->mainMemory[phyPageNum * PageSize],
+					&machine->mainMemory[sharedPage * PageSize], PageSize);
+			memManager->Unshare(sharedPage);
+		} else {
+			// AllocFrame swapped the shared page itself into "disk"
+			swapManager->swapOutFromDisk(phyPageNum, pte->swappingPage);
+			pte->swappingPage = -1;
+		}
+		pte->physicalPage = phyPageNum;
+		pte->valid = TRUE;
+		stats->numPagesCopied++;
+	} else if(pte->valid) {
+		// we take the page over, it will no longer match the executable
+		memManager->ForgetExecPage(pte->physicalPage);
+	}
+	// a page swapped into "disk" while shared comes back as a private
+	// copy, so it can be made writable right away too
+	pte->readOnly = FALSE;
+	pte->copyOnWrite = FALSE;
+	return true;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Mmap
+// 	Map "length" bytes of "file", starting at file offset "offset",
+//	into the Mmap region of the address space.  Nothing is read yet:
+//	the pages fault in through Machine::SwapPage, see LazyLoad.  Bytes
+//	past the end of the file read as zero; writing them back extends
+//	the file.  Return the address of the mapping, or -1 if the
+//	arguments are bad or there is no room left.  Once the DSM region
+//	is attached, it takes the top MaxDsmPages of the Mmap region.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Mmap(OpenFile *file, int offset, int length)
+{
+	MmapRegion *r = NULL;
+	int first, n;
+
+	if(file == NULL || offset < 0 || length <= 0)
+		return -1;
+	for(int i = 0; i < MaxMmapRegions; i++)
+		if(mmaps[i].file == NULL) {
+			r = &mmaps[i];
+			break;
+		}
+	if(r == NULL)
+		return -1;
+
+	// first fit in the Mmap region
+	n = divRoundUp(length, PageSize);
+	first = MmapBase();
+	for(int i = 0; i < MaxMmapRegions; i++) {
+		MmapRegion *o = &mmaps[i];
+		if(o->file != NULL && first < o->firstPage + o->numPages
+				&& o->firstPage < first + n) {
+			first = o->firstPage + o->numPages;
+			i = -1;			// start over
+		}
+	}
+	if(first + n > (dsmAttached ? DsmBase() : MmapBase() + MaxMmapPages))
+		return -1;
+
+	// our own copy: the program may Close its OpenFileId while the
+	// region is still mapped
+	r->file = file->GetFileDescriptorCopy();
+	r->offset = offset;
+	r->length = length;
+	r->firstPage = first;
+	r->numPages = n;
+	DEBUG('a', "Mmap: %d bytes at offset %d, vpn %d-%d\n", length, offset,
+			first, first + n - 1);
+	return first * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Munmap
+// 	Unmap the region Mmap returned "addr" for: write its dirty pages
+//	back to the file, then free them.  Return -1 if no region starts
+//	at "addr".
+//----------------------------------------------------------------------
+
+int
+AddrSpace::Munmap(int addr)
+{
+	if(addr < 0 || addr % PageSize != 0)
+		return -1;
+	MmapRegion *r = FindRegion(addr / PageSize);
+	if(r == NULL || r->firstPage != addr / PageSize)
+		return -1;
+
+	machine->SyncTLB();		// dirty bits still in the TLB
+	for(int vpn = r->firstPage; vpn < r->firstPage + r->numPages; vpn++)
+		WriteBackMappedPage(r, vpn);
+	ReleasePages(r->firstPage, r->firstPage + r->numPages);
+	machine->FlushTLB(threadId);
+
+	delete r->file;
+	r->file = NULL;
+	return 0;
+}
+
+void
+AddrSpace::MunmapAll()
+{
+	for(int i = 0; i < MaxMmapRegions; i++)
+		if(mmaps[i].file != NULL)
+			Munmap(mmaps[i].firstPage * PageSize);
+}
+
+bool
+AddrSpace::HasMmaps()
+{
+	for(int i = 0; i < MaxMmapRegions; i++)
+		if(mmaps[i].file != NULL)
+			return true;
+	return false;
+}
+
+MmapRegion *
+AddrSpace::FindRegion(int vpn)
+{
+	for(int i = 0; i < MaxMmapRegions; i++) {
+		MmapRegion *r = &mmaps[i];
+		if(r->file != NULL && vpn >= r->firstPage
+				&& vpn < r->firstPage + r->numPages)
+			return r;
+	}
+	return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadMappedPage, WriteBackMappedPage
+// 	Move page "vpn" of region "r" between the file and its physical
+//	page.  The page is pinned meanwhile: the disk blocks this thread,
+//	and the frame must not be given to someone else.  Only dirty
+//	pages are written back.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadMappedPage(MmapRegion *r, int phyPageNum, int vpn)
+{
+	int pos = (vpn - r->firstPage) * PageSize;
+	int size = min(PageSize, r->length - pos);
+
+	memManager->Pin(phyPageNum);
+	r->file->ReadAt(&machine->mainMemory[phyPageNum * PageSize], size,
+			r->offset + pos);
+	memManager->Unpin(phyPageNum);
+	pageTable->Map(vpn)->dirty = FALSE;
+	stats->numMmapPagesRead++;
+}
+
+void
+AddrSpace::WriteBackMappedPage(MmapRegion *r, int vpn)
+{
+	TranslationEntry *pte = pageTable->Lookup(vpn);
+	if(pte == NULL || !pte->valid || !pte->dirty)
+		return;
+
+	int pos = (vpn - r->firstPage) * PageSize;
+	int size = min(PageSize, r->length - pos);
+
+	memManager->Pin(pte->physicalPage);
+	r->file->WriteAt(&machine->mainMemory[pte->physicalPage * PageSize], size,
+			r->offset + pos);
+	memManager->Unpin(pte->physicalPage);
+	pte->dirty = FALSE;
+	stats->numMmapPagesWritten++;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::EvictMappedPage
+// 	Called by Machine::EvictFrame when the frame holding page "vpn"
+//	of an Mmap region is taken: the file is the backing store of the
+//	page, so it is written back there and will be read again on the
+//	next fault.  The caller has flushed our TLB item.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::EvictMappedPage(int vpn)
+{
+	MmapRegion *r = FindRegion(vpn);
+	TranslationEntry *pte = pageTable->Lookup(vpn);
+	ASSERT(r != NULL && pte != NULL);
+
+	WriteBackMappedPage(r, vpn);
+	pte->valid = FALSE;
+	pte->swappingPage = -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InstallPage
+// 	Give page "vpn" the contents "data", sent along by the machine a
+//	process is migrating from (see migrate.h).  Whatever AllocAddrSpace
+//	mapped there goes; the page takes an empty frame if there is one,
+//	else it is written straight into the swap file and faults in from
+//	there.  Return FALSE if the swap file is full.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::InstallPage(int vpn, char *data)
+{
+	ReleasePages(vpn, vpn + 1);
+	if(MapPage(vpn)) {
+		bcopy(data, &machine->mainMemory[pageTable->Lookup(vpn)->physicalPage
+				* PageSize], PageSize);
+		return true;
+	}
+#ifdef VM
+	int swappingPage = swapManager->WritePage(data);
+	if(swappingPage < 0)
+		return false;
+	pageTable->Map(vpn)->swappingPage = swappingPage;
+	return true;
+#else
+	return false;
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetFutexPage
+// 	Mark page "vpn" as a futex page; the caller has pinned it.
+//	ReleasePages unpins it again.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SetFutexPage(int vpn)
+{
+	if(futexPages == NULL)
+		futexPages = new BitMap(numPages);
+	futexPages->Mark(vpn);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SetRemotePage
+// 	Mark page "vpn" as left behind on the machine the process migrated
+//	from, dropping what AllocAddrSpace mapped there, or as fetched.
+//	Machine::SwapPage has the migrator fetch a remote page.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::SetRemotePage(int vpn, bool remote)
+{
+	if(!remote) {
+		if(remotePages != NULL)
+			remotePages->Clear(vpn);
+		return;
+	}
+	if(remotePages == NULL)
+		remotePages = new BitMap(numPages);
+	ReleasePages(vpn, vpn + 1);
+	pageTable->Map(vpn);
+	remotePages->Mark(vpn);
+}
@@ -16,8 +16,35 @@
 #include "copyright.h"
 #include "filesys.h"
 #include "translate.h"
+#include "noff.h"
+#include "fdtable.h"
+#include "aio.h"
+#include "printbuf.h"
+#include "bitmap.h"
 
-#define UserStackSize		1024 	// increase this as necessary!
+#define UserStackSize		1024 	// stack mapped at exec time, the
+					// stack grows on demand from there
+#define UserAddrSpacePages	1024	// virtual pages of every address space
+#define MaxUserStackPages	256	// how far the stack may grow down from
+					// the top of the address space
+#define MaxMmapPages		256	// Mmap region, just below the stack
+					// region; the heap stops below it
+#define MaxMmapRegions		8	// Mmap calls alive at the same time
+#define MaxDsmPages		16	// distributed shared memory region,
+					// the top pages of the Mmap region
+					// once attached
+
+// A file region mapped into the address space by Mmap.  Its pages are
+// read from the file when first touched, and written back to the file
+// (not to the swap file) when they are evicted or unmapped.
+struct MmapRegion {
+    OpenFile *file;			// our own copy of the OpenFile,
+    					// NULL if the slot is free
+    int offset;				// file offset of the first page
+    int length;				// bytes mapped
+    int firstPage;			// first vpn of the region
+    int numPages;
+};
 
 class AddrSpace {
   public:
@@ -33,6 +60,8 @@ class AddrSpace {
 
     void SaveState();			// Save/restore address space-specific
     void RestoreState();		// info on a context switch 
+    void HarvestUseBits();		// push lastUseTime of resident pages
+    					// into memManager
 
     int GetNumPages();
     int LazyLoad(int phyPageNum, int vpn);
@@ -41,15 +70,85 @@ class AddrSpace {
     bool getPTEValid(int vpn);
     void setPTEValid(int vpn, bool value);
     int getPTEPPN(int vpn);
+    TranslationEntry* GetPTE(int vpn);
+    int GetASID() { return threadId; }	// TLB tag, the owner thread id
+    void PrintTLBStats();		// per-process TLB hit rate
+    void PrintPageTableStats();		// page table memory in use
+
+    bool IsLegalPage(int vpn);		// is vpn in the image, below the
+    					// break, or in the stack region?
+    int Sbrk(int increment);		// move the break, return the old one
+    void ReleasePages(int from, int to);	// free the frames and swap
+    					// pages of vpns [from, to)
+
+    int Mmap(OpenFile *file, int offset, int length);	// map a file
+    					// region, return its address or -1
+    int Munmap(int addr);		// write back and unmap, 0 or -1
+    void MunmapAll();			// at exit
+    bool IsMappedPage(int vpn) { return FindRegion(vpn) != NULL; }
+    void EvictMappedPage(int vpn);	// write back if dirty, then
+    					// invalidate; it reloads from the file
+
+    int DsmBase() { return numPages - MaxUserStackPages - MaxDsmPages; }
+    void SetDsmAttached(bool attached) { dsmAttached = attached; }
+    bool IsDsmAttached() { return dsmAttached; }
+    bool IsDsmPage(int vpn) { return dsmAttached && vpn >= DsmBase()
+    				&& vpn < DsmBase() + MaxDsmPages; }
+    					// kept coherent by dsm, see dsm.h
+
+    bool InstallPage(int vpn, char *data);	// page of a process
+    					// migrating here; FALSE if no swap
+    					// page is left
+    void SetRemotePage(int vpn, bool remote);
+    bool IsRemotePage(int vpn) { return remotePages != NULL
+    				&& remotePages->Test(vpn); }
+    					// still on the machine the process
+    					// came from, see migrate.h
+    void SetFutexPage(int vpn);
+    bool IsFutexPage(int vpn) { return futexPages != NULL
+    				&& futexPages->Test(vpn); }
+    					// pinned, and shared writable by
+    					// Fork, see futex.h
+    bool HasMmaps();			// any Mmap region alive?
+    int GetBreak() { return brk; }
+
+    int numTLBHit;			// TLB lookups charged to this space
+    int numTLBMiss;
 
     OpenFile* getExecFileCopy() { return execFile->GetFileDescriptorCopy();}
-    bool CopyMemFromParent(AddrSpace* parADdr);
+    bool ShareFromParent(AddrSpace* parAddr);	// copy-on-write Fork
+    bool CopyOnWrite(int vpn);		// write fault on a shared page
+    bool MapCachedPage(int vpn);	// share an image page from the
+    					// executable page cache
+    FdTable *GetFdTable() { return &fdTable; }	// open files of the
+    					// process
+    AioTable *GetAioTable() { return &aioTable; }	// its AioRead/
+    					// AioWrite requests
+    PrintBuffer *GetPrintBuffer() { return &printBuffer; }
+    					// its Print output, not yet written
   private:
-    TranslationEntry *pageTable;	// Assume linear page table translation
-					// for now!
+    bool MapPage(int vpn);		// back vpn with a zeroed free frame
+    MmapRegion *FindRegion(int vpn);	// the mapping vpn is in, or NULL
+    void LoadMappedPage(MmapRegion *r, int phyPageNum, int vpn);
+    void WriteBackMappedPage(MmapRegion *r, int vpn);
+    int MmapBase() { return numPages - MaxUserStackPages - MaxMmapPages; }
+
+    PageTable *pageTable;		// two-level, only the touched
+					// regions have second level tables
     unsigned int numPages;		// Number of pages in the virtual 
 					// address space
+    int heapStart;			// first byte of the heap, just past
+    					// the program image
+    int brk;				// end of the heap
     OpenFile *execFile;
+    NoffHeader noffH;			// header of execFile, read once
+    MmapRegion mmaps[MaxMmapRegions];
+    bool dsmAttached;			// DsmAttach was called
+    BitMap *remotePages;		// NULL unless migrated here
+    BitMap *futexPages;			// NULL until FutexWait/FutexWake
+    FdTable fdTable;			// OpenFileIds of the process
+    AioTable aioTable;
+    PrintBuffer printBuffer;
     int threadId;
 };
 
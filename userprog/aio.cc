@@ -0,0 +1,117 @@
+// aio.cc
+//	Asynchronous file I/O for user programs, see aio.h.
+
+#include "copyright.h"
+#include "aio.h"
+#include "synch.h"
+#include "synchlist.h"
+#include "system.h"
+
+static SynchList *aioQueue = NULL;	// requests waiting for the daemon
+
+//----------------------------------------------------------------------
+// AioDaemon
+// 	Run the queued requests, forever.  The thread is started by the
+//	first request, so programs that never use aio don't pay for it.
+//----------------------------------------------------------------------
+
+static void
+AioDaemon(int arg)
+{
+    for (;;) {
+	AioRequest *req = (AioRequest *) aioQueue->Remove();
+	req->Run();
+    }
+}
+
+AioRequest::AioRequest(OpenFile *f, int numBytes, int offset, bool isWrite)
+{
+    file = f;
+    size = numBytes;
+    position = offset;
+    writing = isWrite;
+    buffer = new char[size];
+    userAddr = -1;
+    result = -1;
+    finished = new Semaphore("aio request", 0);
+}
+
+AioRequest::~AioRequest()
+{
+    delete file;
+    delete [] buffer;
+    delete finished;
+}
+
+void
+AioRequest::Run()
+{
+    // locked like the Read/Write syscalls; the seek position moved is
+    // our own
+    if (writing)
+	result = file->Write(buffer, size, position);
+    else
+	result = file->Read(buffer, size, position);
+    stats->numAioInFlight--;
+    finished->V();
+}
+
+int
+AioRequest::Wait()
+{
+    finished->P();
+    return result;
+}
+
+AioTable::AioTable()
+{
+    for (int id = 0; id < MaxAioRequests; id++)
+	table[id] = NULL;
+}
+
+AioTable::~AioTable()
+{
+    WaitAll();
+}
+
+int
+AioTable::Submit(AioRequest *req)
+{
+    for (int id = 0; id < MaxAioRequests; id++)
+	if (table[id] == NULL) {
+	    if (aioQueue == NULL) {
+		aioQueue = new SynchList;
+		Thread *daemon = Thread::getInstance("aio daemon");
+		ASSERT(daemon != NULL);
+		daemon->Fork(AioDaemon, 0);
+	    }
+	    table[id] = req;
+	    stats->numAioRequests++;
+	    stats->numAioInFlight++;
+	    aioQueue->Append(req);
+	    return id;
+	}
+    return -1;
+}
+
+AioRequest *
+AioTable::Take(int id)
+{
+    if (id < 0 || id >= MaxAioRequests)
+	return NULL;
+    AioRequest *req = table[id];
+    table[id] = NULL;
+    return req;
+}
+
+// At exit: the daemon may still be using the buffers
+void
+AioTable::WaitAll()
+{
+    for (int id = 0; id < MaxAioRequests; id++)
+	if (table[id] != NULL) {
+	    table[id]->Wait();
+	    delete table[id];
+	    table[id] = NULL;
+	}
+}
@@ -0,0 +1,65 @@
+// aio.h
+//	Asynchronous file I/O for user programs.  An AioRead or AioWrite
+//	syscall turns into an AioRequest that is queued for the aio
+//	daemon, a kernel thread that does the transfers one after the
+//	other, blocking in SynchDisk while the program that asked goes
+//	on computing.  The program collects the result with AioWait.
+//
+//	The daemon has no address space: data moves through a kernel
+//	buffer, filled from the user buffer when an AioWrite is made, and
+//	copied to the user buffer by the AioWait of an AioRead.
+
+#ifndef AIO_H
+#define AIO_H
+
+#include "copyright.h"
+#include "openfile.h"
+
+class Semaphore;			// synch.h needs thread.h, which
+					// needs us (via addrspace.h)
+
+#define MaxAioRequests	8	// in flight per process
+#define MaxAioBytes	4096	// moved by one request, at most: the
+				// kernel buffer is allocated up front
+
+class AioRequest {
+  public:
+    AioRequest(OpenFile *f, int numBytes, int offset, bool isWrite);
+					// "file" becomes the request's own
+    ~AioRequest();
+
+    void Run();				// by the daemon: do the transfer
+    int Wait();				// block until Run is done, return
+    					// the bytes transferred
+
+    char *buffer;			// kernel copy of the data
+    int size;
+    int userAddr;			// where an AioRead's data goes, -1
+    					// for an AioWrite
+
+  private:
+    OpenFile *file;
+    int position;			// byte offset in the file
+    bool writing;
+    int result;
+    Semaphore *finished;		// V'ed by Run
+};
+
+// The requests of one process, named by small integers.
+class AioTable {
+  public:
+    AioTable();
+    ~AioTable();			// waits for what is in flight
+
+    int Submit(AioRequest *req);	// queue for the daemon, return the
+    					// id, -1 if MaxAioRequests are in
+    					// flight
+    AioRequest *Take(int id);		// the request, no longer in the
+    					// table; NULL if there is none
+    void WaitAll();			// wait for and free every request
+
+  private:
+    AioRequest *table[MaxAioRequests];
+};
+
+#endif // AIO_H
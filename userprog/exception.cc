@@ -25,6 +25,13 @@
 #include "system.h"
 #include "syscall.h"
 #include "uprogUtility.h"
+#include "futex.h"
+#include "pipe.h"
+#include "console.h"
+#ifdef NETWORK
+#include "dsm.h"
+#include "migrate.h"
+#endif
 
 #define MIN_FILE_SIZE 0//64
 #define MAX_FILENAME_LEN 100
@@ -32,93 +39,40 @@
 #define TransferSize 100
 #define MAX_PATH_LEN 256
 
-static void FetchStrFromUserSpace(char* buf, int size, int addr);
-static void FetchFromUserSpace(char* buf, int size, int addr);
-static void WriteBackToUserSpace(char* buf, int size, int addr);
 
 
-static void SysCallPrintHandler();
-static void SysCallPrintIntHandler();
+static int SysCallPrintHandler(int *arg);
+static int SysCallPrintIntHandler(int *arg);
 static void SysCallExitHandler();
 
-static void SysCallCreateHandler();
-static void SysCallOpenHandler();
-static void SysCallCloseHandler();
-static void SysCallReadHandler();
-static int SysCallWriteHandler();
+static int SysCallCreateHandler(int *arg);
+static int SysCallOpenHandler(int *arg);
+static int SysCallCloseHandler(int *arg);
+static int SysCallReadHandler(int *arg);
+static int SysCallWriteHandler(int *arg);
+static int SysCallReadvHandler(int *arg);
+static int SysCallWritevHandler(int *arg);
+static void SysCallSubmitHandler();
+static int SysCallAioReadHandler(int *arg);
+static int SysCallAioWriteHandler(int *arg);
+static int SysCallAioWaitHandler(int *arg);
+static int SysCallFutexWaitHandler(int *arg);
+static int SysCallFutexWakeHandler(int *arg);
+static int SysCallPipeHandler(int *arg);
+static int SysCallDupHandler(int *arg);
+static int SysCallDsmAttachHandler(int *arg);
+static int SysCallMigrateHandler(int *arg);
+static void RunSysCall(int (*func)(int *arg));
 
 static void SysCallExecHandler();
 static void SysCallForkHandler();
 static void SysCallYieldHandler();
 static void SysCallJoinHandler();
+static void SysCallSbrkHandler();
+static void SysCallMmapHandler();
+static void SysCallMunmapHandler();
 
-
-// get the file name
-//	do
-//	{
-//		machine->ReadMem(msg + i, 1, (int*)&buf[i]);
-//	} while (++i<size);//while(buf[i++] != '\0');
-void FetchStrFromUserSpace(char* buf, int size, int addr)
-{
-	int i = 0;
-	bool pageFault = false;
-
-	// Get string from user space.
-	do
-	{
-		if(pageFault) {
-			i--;
-			pageFault = false;
-		}
-
-		if(!machine->ReadMem(addr + i, 1, (int*)&buf[i])) {
-			// page fault, read fail
-			pageFault = true;
-		}
-	}while(buf[i++] != '\0' || pageFault);
-}
-
-// write mem back
-//	for(int i = 0; i<len; i++) {
-//		machine->WriteMem(arg + i, 1, (int)buffer[i]);
-//	}
-void WriteBackToUserSpace(char* buf, int size, int addr)
-{
-	bool pageFault = false;
-
-	for(int i = 0; i<size || pageFault; i++)
-	{
-		if(pageFault) {
-			i--;
-			pageFault = false;
-		}
-		if(!machine->WriteMem(addr + i, 1, (int)buf[i])) {
-			// page fault, write fail
-			pageFault = true;
-		}
-	}
-}
-
-//	for(int i = 0; i<size; i++) {
-//		machine->ReadMem(arg + i, 1, (int*)&buffer[i]);
-//	}
-void FetchFromUserSpace(char* buf, int size, int addr)
-{
-	bool pageFault = false;
-
-	for(int i = 0; i<size || pageFault; i++)
-	{
-		if(pageFault) {
-			i--;
-			pageFault = false;
-		}
-		if(!machine->ReadMem(addr + i, 1, (int*)&buf[i])) {
-			// page fault, read fail
-			pageFault = true;
-		}
-	}
-}
-
+static void ExitCurrentThread(int exitStatus);
 
 
 //----------------------------------------------------------------------
@@ -150,10 +104,15 @@ ExceptionHandler(ExceptionType which)
     int type = machine->ReadRegister(2);
 
     if ((which == SyscallException)) {
+    	stats->numSyscallTraps++;
+    	TRACE(TraceSyscall, type, machine->ReadRegister(4), 0);
     	switch(type)
     	{
     	case SC_Halt:
     		DEBUG('a', "Shutdown, initiated by user program.\n");
+    		// what the program wrote may still be queued
+    		currentThread->space->GetPrintBuffer()->Flush();
+    		synchConsole->Flush();
     		interrupt->Halt();
     		break;
     	case SC_Exit:
@@ -161,25 +120,61 @@ ExceptionHandler(ExceptionType which)
     		break;
     	case SC_Print:
     		DEBUG('a', "Print, call by user program.\n");
-    		SysCallPrintHandler();
+    		RunSysCall(SysCallPrintHandler);
     		break;
     	case SC_PrintInt:
-    		SysCallPrintIntHandler();
+    		RunSysCall(SysCallPrintIntHandler);
     		break;
     	case SC_Create:
-    		SysCallCreateHandler();
+    		RunSysCall(SysCallCreateHandler);
     		break;
     	case SC_Open:
-    		SysCallOpenHandler();
+    		RunSysCall(SysCallOpenHandler);
     		break;
     	case SC_Close:
-    		SysCallCloseHandler();
+    		RunSysCall(SysCallCloseHandler);
     		break;
     	case SC_Read:
-    		SysCallReadHandler();
+    		RunSysCall(SysCallReadHandler);
     		break;
     	case SC_Write:
-    		SysCallWriteHandler();
+    		RunSysCall(SysCallWriteHandler);
+    		break;
+    	case SC_Readv:
+    		RunSysCall(SysCallReadvHandler);
+    		break;
+    	case SC_Writev:
+    		RunSysCall(SysCallWritevHandler);
+    		break;
+    	case SC_Submit:
+    		SysCallSubmitHandler();
+    		break;
+    	case SC_AioRead:
+    		RunSysCall(SysCallAioReadHandler);
+    		break;
+    	case SC_AioWrite:
+    		RunSysCall(SysCallAioWriteHandler);
+    		break;
+    	case SC_AioWait:
+    		RunSysCall(SysCallAioWaitHandler);
+    		break;
+    	case SC_FutexWait:
+    		RunSysCall(SysCallFutexWaitHandler);
+    		break;
+    	case SC_FutexWake:
+    		RunSysCall(SysCallFutexWakeHandler);
+    		break;
+    	case SC_Pipe:
+    		RunSysCall(SysCallPipeHandler);
+    		break;
+    	case SC_Dup:
+    		RunSysCall(SysCallDupHandler);
+    		break;
+    	case SC_DsmAttach:
+    		RunSysCall(SysCallDsmAttachHandler);
+    		break;
+    	case SC_Migrate:
+    		RunSysCall(SysCallMigrateHandler);
     		break;
     	case SC_Exec:
     		SysCallExecHandler();
@@ -193,15 +188,37 @@ ExceptionHandler(ExceptionType which)
     	case SC_Join:
     		SysCallJoinHandler();
     		break;
+    	case SC_Sbrk:
+    		SysCallSbrkHandler();
+    		break;
+    	case SC_Mmap:
+    		SysCallMmapHandler();
+    		break;
+    	case SC_Munmap:
+    		SysCallMunmapHandler();
+    		break;
     	default:
     		break;
     	}
     } else if (which == PageFaultException) { // from TLB or PageTable
     	int addr = machine->ReadRegister(BadVAddrReg);
+    	if (!currentThread->space->IsLegalPage((unsigned) addr / PageSize)) {
+    		// a hole between the heap and the stack region
+    		printf("PageFault: illegal address 0x%x, thread %s killed\n",
+    				addr, currentThread->getName());
+    		ExitCurrentThread(-1);
+    	}
 #ifdef VM
     		machine->SwapPage(addr); 		// load page from disk or swap file
 #endif
     		machine->TLBSwap(addr);
+	} else if (which == ReadOnlyException) { // write to a page shared by Fork
+    	int addr = machine->ReadRegister(BadVAddrReg);
+    	if (!currentThread->space->CopyOnWrite((unsigned) addr / PageSize)) {
+    		printf("ReadOnly: write to 0x%x, thread %s killed\n",
+    				addr, currentThread->getName());
+    		ExitCurrentThread(-1);
+    	}
 	} else {
 		printf("Unexpected user mode exception %d %d\n", which, type);
 		ASSERT(FALSE);
@@ -212,8 +229,22 @@ static void SysCallExitHandler()
 {
     int exitStatus = machine->ReadRegister(4);
     printf("SYSCALL: exit code %d, current Thread %s\n", exitStatus, currentThread->getName());
+    ExitCurrentThread(exitStatus);
+}
 
-    // Delete thread' address space.
+static void ExitCurrentThread(int exitStatus)
+{
+    // Report how well the TLB and the page table served this thread,
+    // then delete its address space.
+	if (currentThread->space != NULL) {
+		currentThread->space->PrintTLBStats();
+		currentThread->space->PrintPageTableStats();
+#ifdef NETWORK
+		// a process that migrated here lets its stub exit, too
+		if (migrator != NULL)
+			migrator->Exited(currentThread->space, exitStatus);
+#endif
+	}
 	currentThread->DeleteAddrSpace();
 
     // Set thread's exit status.
@@ -223,118 +254,430 @@ static void SysCallExitHandler()
 	currentThread->Finish();
 }
 
-static void SysCallPrintHandler()
+//----------------------------------------------------------------------
+// SysCallPrintHandler, SysCallPrintIntHandler
+// 	Append to the process's PrintBuffer, which is written to the
+//	console a buffer-full at a time.  Print takes the string at arg[0],
+//	at most arg[1] bytes of it.
+//----------------------------------------------------------------------
+
+static int SysCallPrintHandler(int *arg)
 {
-	int msg = machine->ReadRegister(4);
-	int size = machine->ReadRegister(5);
+	int len = currentThread->space->GetPrintBuffer()->PrintUser(arg[0], arg[1]);
+	return len < 0 ? -1 : 0;
+}
 
-	char* buf = new char[size + 5];
-	memset(buf, 1, size+5);
+static int SysCallPrintIntHandler(int *arg)
+{
+	currentThread->space->GetPrintBuffer()->PrintInt(arg[0]);
+	return 0;
+}
 
-	FetchStrFromUserSpace(buf, size+5, msg);
-	printf("%s\n", buf);
+static int SysCallCreateHandler(int *arg)
+{
+	char fname[MAX_FILENAME_LEN];
 
-	delete buf;
+	if(CopyStrFromUser(arg[0], fname, MAX_FILENAME_LEN) >= 0
+			&& fileSystem->Create(fname, MIN_FILE_SIZE)) {
+		printf("SYSCALL: create file %s success\n", fname);
+		return 0;
+	}
+	printf("SYSCALL: create file %s fail\n", fname);
+	return -1;
+}
 
-	machine->PCForward();
+static int SysCallOpenHandler(int *arg)
+{
+	int fid = -1;
+	char fname[MAX_FILENAME_LEN];
+
+	// Get the executable file name from user space.
+	OpenFile* fp = NULL;
+	if(CopyStrFromUser(arg[0], fname, MAX_FILENAME_LEN) >= 0)
+		fp = fileSystem->Open(fname);
+	// a small integer naming fp in the process's table
+	if(fp != NULL && (fid = currentThread->space->GetFdTable()->Add(fp)) < 0)
+		delete fp;		// too many open files
+
+	// return OpenFileId
+	return fid;
 }
 
-static void SysCallPrintIntHandler()
+static int SysCallCloseHandler(int *arg)
 {
-	int number = machine->ReadRegister(4);
-	printf("%d\n", number);
-	machine->PCForward();
+	OpenFileId fid = arg[0];
+
+	if(currentThread->space->GetFdTable()->Close(fid)) {
+		printf("SYSCALL: close file %d success\n", fid);
+		return 0;
+	}
+	printf("SYSCALL: close file %d fail\n", fid);
+	return -1;
 }
 
-static void SysCallCreateHandler()
+//----------------------------------------------------------------------
+// SysCallReadHandler, SysCallWriteHandler,
+// SysCallReadvHandler, SysCallWritevHandler
+// 	Read/Write move one user buffer, Readv/Writev the "iovCount"
+//	buffers of the IoVecU array at arg[0] in order, in one go: the
+//	file is locked once and the seek position moves over all of them.
+//	The disk transfers straight to and from the user pages; a pipe
+//	or the console (ConsoleInput/ConsoleOutput, unless something was
+//	Dup'ed onto them) goes through a kernel buffer.  Return the number
+//	of bytes transferred, or -1.
+//----------------------------------------------------------------------
+
+static int StreamRead(PipeBuffer *pipe, char *into, int numBytes)
 {
-	char fname[MAX_FILENAME_LEN];
-	int arg = machine->ReadRegister(4);
+	if(pipe != NULL)
+		return pipe->Read(into, numBytes);
+	return synchConsole->Read(into, numBytes);
+}
 
-	FetchStrFromUserSpace(fname, MAX_FILENAME_LEN, arg);
+static int StreamWrite(PipeBuffer *pipe, char *from, int numBytes)
+{
+	if(pipe != NULL)
+		return pipe->Write(from, numBytes);
+	return synchConsole->Write(from, numBytes);
+}
 
-	if(fileSystem->Create(fname, MIN_FILE_SIZE)) {
-		printf("SYSCALL: create file %s success\n", fname);
-	} else {
-		printf("SYSCALL: create file %s fail\n", fname);
+// "pipe" is NULL for the console
+static int StreamTransfer(PipeBuffer *pipe, UserBuf *bufs, int count, bool reading)
+{
+	char buf[PipeSize];
+	int done = 0;
+
+	if(reading) {
+		// one Read: return what the pipe has (the console: one line),
+		// without waiting for more
+		int size = 0;
+		for(int i = 0; i < count; i++)
+			size += bufs[i].size;
+		int n = StreamRead(pipe, buf, min(size, PipeSize));
+		for(int i = 0; i < count && done < n; i++) {
+			int chunk = min(bufs[i].size, n - done);
+			if(CopyToUser(bufs[i].addr, buf + done, chunk) < 0)
+				return -1;
+			done += chunk;
+		}
+		return done;
+	}
+	for(int i = 0; i < count; i++) {
+		for(int off = 0; off < bufs[i].size; ) {
+			int chunk = min(bufs[i].size - off, PipeSize);
+			if(CopyFromUser(bufs[i].addr + off, buf, chunk) < 0)
+				return -1;
+			int n = StreamWrite(pipe, buf, chunk);
+			if(n < 0)
+				return done > 0 ? done : -1;
+			off += n;
+			done += n;
+		}
 	}
+	return done;
+}
 
-	machine->PCForward();
+static int FileTransfer(UserBuf *bufs, int count, int *arg, bool reading)
+{
+	FdTable* fdTable = currentThread->space->GetFdTable();
+	OpenFile* fp = fdTable->Get(arg[2]);
+	PipeBuffer* pipe = fdTable->GetPipe(arg[2], !reading);
+	int len = -1;
+
+	if(pipe != NULL) {
+		len = StreamTransfer(pipe, bufs, count, reading);
+	} else if(!fdTable->IsOpen(arg[2]) && arg[2] == (reading ? ConsoleInput : ConsoleOutput)) {
+		// Print output first, e.g. a prompt before a read
+		currentThread->space->GetPrintBuffer()->Flush();
+		len = StreamTransfer(NULL, bufs, count, reading);
+	} else if(fp != NULL) {
+		if(reading)
+			len = ReadFileToUserV(fp, bufs, count, arg[3]);
+		else
+			len = WriteFileFromUserV(fp, bufs, count, arg[3]);
+	}
+	if(len < 0)
+		len = -1;
+	printf("SYSCALL: %s file %d byte\n", reading ? "read" : "write", len);
+	return len;
 }
 
-static void SysCallOpenHandler()
+static int SysCallReadHandler(int *arg)
 {
-	int fid = -1;
-	char fname[MAX_FILENAME_LEN];
-	int arg = machine->ReadRegister(4);
+	UserBuf buf;
+	buf.addr = arg[0];
+	buf.size = arg[1];
+	return FileTransfer(&buf, 1, arg, TRUE);
+}
 
-	// Get the executable file name from user space.
-	FetchStrFromUserSpace(fname, MAX_FILENAME_LEN, arg);
+static int SysCallWriteHandler(int *arg)
+{
+	UserBuf buf;
+	buf.addr = arg[0];
+	buf.size = arg[1];
+	return FileTransfer(&buf, 1, arg, FALSE);
+}
 
-	fid = (int)fileSystem->Open(fname); // OpenFile pointer??? [x]fileheader sector?
+static int SysCallVectorHandler(int *arg, bool reading)
+{
+	UserBuf bufs[MaxUserIoVecs];
+	int count = arg[1];
+
+	// IoVecU is two words, the same layout as UserBuf
+	if(count < 0 || count > MaxUserIoVecs
+			|| CopyFromUser(arg[0], (char *) bufs, count * sizeof(UserBuf)) < 0)
+		return -1;
+	return FileTransfer(bufs, count, arg, reading);
+}
 
-	// return OpenFileId
-	machine->WriteRegister(2, fid);
-	machine->PCForward();
+static int SysCallReadvHandler(int *arg)
+{
+	return SysCallVectorHandler(arg, TRUE);
 }
 
-static void SysCallCloseHandler()
+static int SysCallWritevHandler(int *arg)
 {
-	OpenFileId fid = machine->ReadRegister(4);
-	OpenFile* fp = (OpenFile*)fid;
+	return SysCallVectorHandler(arg, FALSE);
+}
 
-	fp->~OpenFile();
-	printf("SYSCALL: close file success\n");
+//----------------------------------------------------------------------
+// SysCallAioReadHandler, SysCallAioWriteHandler, SysCallAioWaitHandler
+// 	Queue an asynchronous transfer for the aio daemon and return its
+//	request id, or wait for one and return its result.  The data of
+//	an AioWrite is copied in now, that of an AioRead copied out by
+//	AioWait.  See aio.h.
+//----------------------------------------------------------------------
 
-	machine->PCForward();
+static int AioStart(int *arg, bool writing)
+{
+	OpenFile* fp = currentThread->space->GetFdTable()->Get(arg[2]);
+	int size = arg[1];
+	int position = arg[3];
+
+	if(fp == NULL || size < 0 || size > MaxAioBytes || position < 0)
+		return -1;
+	// our own OpenFile, the program may Close "id" meanwhile
+	AioRequest *req = new AioRequest(fp->GetFileDescriptorCopy(), size,
+			position, writing);
+	if(writing && CopyFromUser(arg[0], req->buffer, size) < 0) {
+		delete req;
+		return -1;
+	}
+	if(!writing)
+		req->userAddr = arg[0];
+	int id = currentThread->space->GetAioTable()->Submit(req);
+	if(id < 0)
+		delete req;
+	printf("SYSCALL: aio %s %d byte: request %d\n",
+			writing ? "write" : "read", size, id);
+	return id;
 }
 
-static void SysCallReadHandler()
+static int SysCallAioReadHandler(int *arg)
 {
-	int size = machine->ReadRegister(5);
-	OpenFileId fid = machine->ReadRegister(6);
-	OpenFile* fp = (OpenFile*)fid;
-	int position = machine->ReadRegister(7);
+	return AioStart(arg, FALSE);
+}
 
-	int len = 0;
+static int SysCallAioWriteHandler(int *arg)
+{
+	return AioStart(arg, TRUE);
+}
 
-	// check length
-	len = fp->Length() > size? size: fp->Length();
+static int SysCallAioWaitHandler(int *arg)
+{
+	AioRequest *req = currentThread->space->GetAioTable()->Take(arg[0]);
+	if(req == NULL)
+		return -1;
+
+	int len = req->Wait();
+	if(len > 0 && req->userAddr != -1
+			&& CopyToUser(req->userAddr, req->buffer, len) < 0)
+		len = -1;
+	delete req;
+	printf("SYSCALL: aio wait %d: %d byte\n", arg[0], len);
+	return len;
+}
 
-	// read from the beginning of the file
-	char* buffer = new char[len + 5];
-	len = fp->Read(buffer, len, position);
-	// copy from buffer to user space
-	int arg = machine->ReadRegister(4);
-	WriteBackToUserSpace(buffer, size, arg);
+//----------------------------------------------------------------------
+// SysCallPipeHandler, SysCallDupHandler
+// 	Pipe opens the pipe named by the string at arg[1] (a new
+//	anonymous one if it is 0) and stores a read and a write descriptor
+//	in the array at arg[0].  Dup(arg[0], arg[1]) is FdTable::Dup.
+//----------------------------------------------------------------------
 
-	delete [] buffer;
-	//return int;
-	machine->WriteRegister(2, len);
-	machine->PCForward();
-	printf("SYSCALL: read file %d byte\n", len);
+static int SysCallPipeHandler(int *arg)
+{
+	FdTable* fdTable = currentThread->space->GetFdTable();
+	char name[MAX_FILENAME_LEN];
+	int fds[2];
+
+	if(arg[1] != 0 && CopyStrFromUser(arg[1], name, MAX_FILENAME_LEN) < 0)
+		return -1;
+	PipeBuffer* pipe = PipeBuffer::Open(arg[1] != 0 ? name : NULL);
+	fds[0] = fdTable->AddPipe(pipe, FALSE);
+	if(fds[0] < 0) {
+		pipe->CloseEnd(FALSE);
+		pipe->CloseEnd(TRUE);
+		return -1;
+	}
+	fds[1] = fdTable->AddPipe(pipe, TRUE);
+	if(fds[1] < 0 || CopyToUser(arg[0], (char *) fds, sizeof(fds)) < 0) {
+		if(fds[1] < 0)
+			pipe->CloseEnd(TRUE);
+		else
+			fdTable->Close(fds[1]);
+		fdTable->Close(fds[0]);
+		return -1;
+	}
+	printf("SYSCALL: pipe %d -> %d\n", fds[1], fds[0]);
+	return 0;
 }
 
-static int SysCallWriteHandler()
+static int SysCallDupHandler(int *arg)
 {
-	int size = machine->ReadRegister(5);
-	OpenFileId fid = machine->ReadRegister(6);
-	OpenFile* fp = (OpenFile*)fid;
-	int position = machine->ReadRegister(7);
+	return currentThread->space->GetFdTable()->Dup(arg[0], arg[1]);
+}
 
-	char* buffer = new char[size + 5]; // must larger than size?!
-	int arg = machine->ReadRegister(4);
-	int len = 0;
-	// Get the buffer content from user space.
-	FetchFromUserSpace(buffer, size, arg);
+//----------------------------------------------------------------------
+// SysCallDsmAttachHandler
+// 	Give the process the DSM region, and tell it which machine of how
+//	many it runs on: arg[0] and arg[1] point to those.
+//----------------------------------------------------------------------
 
-	len = fp->Write(buffer, size, position);
-	delete []buffer;
+static int SysCallDsmAttachHandler(int *arg)
+{
+#ifdef NETWORK
+	AddrSpace *space = currentThread->space;
+	int info[2];
+
+	if(dsm == NULL)
+		return -1;
+	info[0] = dsm->GetNode();
+	info[1] = dsm->GetNumNodes();
+	if(CopyToUser(arg[0], (char *) &info[0], sizeof(int)) < 0
+			|| CopyToUser(arg[1], (char *) &info[1], sizeof(int)) < 0
+			|| !dsm->Attach(space))
+		return -1;
+	return space->DsmBase() * PageSize;
+#else
+	return -1;
+#endif
+}
 
-	//return int;
-	machine->WriteRegister(2, len);
+//----------------------------------------------------------------------
+// SysCallMigrateHandler
+// 	Move the process to machine arg[0].  If it moves, its thread here
+//	is left as a stub until the process has exited over there, and
+//	exits with the same status; it never returns to user mode.
+//----------------------------------------------------------------------
+
+static int SysCallMigrateHandler(int *arg)
+{
+#ifdef NETWORK
+	if(migrator == NULL)
+		return -1;
+	printf("SYSCALL: migrate: thread %d to machine %d\n",
+			currentThread->getTid(), arg[0]);
+	int exitStatus;
+	if(!migrator->Migrate(arg[0], &exitStatus))
+		return -1;
+	ExitCurrentThread(exitStatus);
+#endif
+	return -1;
+}
+
+static int SysCallFutexWaitHandler(int *arg)
+{
+	return FutexWait(arg[0], arg[1]);
+}
+
+static int SysCallFutexWakeHandler(int *arg)
+{
+	return FutexWake(arg[0], arg[1]);
+}
+
+//----------------------------------------------------------------------
+// BatchableSysCall
+// 	The handler of system call "type" if it may be queued in a
+//	SyscallRingU, NULL otherwise.  These handlers take the arguments
+//	r4-r7 as an array and return what goes into r2.
+//----------------------------------------------------------------------
+
+typedef int (*SysCallFunc)(int *arg);
+
+static SysCallFunc BatchableSysCall(int type)
+{
+	switch(type)
+	{
+	case SC_Print:		return SysCallPrintHandler;
+	case SC_PrintInt:	return SysCallPrintIntHandler;
+	case SC_Create:		return SysCallCreateHandler;
+	case SC_Open:		return SysCallOpenHandler;
+	case SC_Close:		return SysCallCloseHandler;
+	case SC_Read:		return SysCallReadHandler;
+	case SC_Write:		return SysCallWriteHandler;
+	case SC_Readv:		return SysCallReadvHandler;
+	case SC_Writev:		return SysCallWritevHandler;
+	case SC_Pipe:		return SysCallPipeHandler;
+	case SC_Dup:		return SysCallDupHandler;
+	default:			return NULL;
+	}
+}
+
+static void RunSysCall(SysCallFunc func)
+{
+	int arg[4];
+	for(int i = 0; i < 4; i++)
+		arg[i] = machine->ReadRegister(4 + i);
+	machine->WriteRegister(2, (*func)(arg));
+	machine->PCForward();
+}
+
+//----------------------------------------------------------------------
+// SysCallSubmitHandler
+// 	Run the system calls queued in the SyscallRingU at r4, from its
+//	head up to its tail, with a single trap.  Each entry gets its
+//	result, and the head moves past it, as if the program had made
+//	the call itself; a type that may not be batched gets -1.  Stops
+//	early if the ring cannot be read or written.  Return the number
+//	of entries run, or -1 if the ring header is bad.
+//----------------------------------------------------------------------
+
+struct RingHeader {		// SyscallRingU as seen from here: the
+	int head;			// user pointer is a 32-bit MIPS address
+	int tail;
+	int size;
+	int entries;
+};
+
+static void SysCallSubmitHandler()
+{
+	int ringAddr = machine->ReadRegister(4);
+	RingHeader ring;
+	int done = -1;
+
+	if(CopyFromUser(ringAddr, (char *) &ring, sizeof(ring)) == sizeof(ring)
+			&& ring.size > 0 && ring.head >= 0
+			&& ring.tail - ring.head >= 0
+			&& ring.tail - ring.head <= ring.size) {
+		for(done = 0; ring.head != ring.tail; done++) {
+			SyscallEntryU entry;
+			int entryAddr = ring.entries
+					+ (ring.head % ring.size) * sizeof(entry);
+			if(CopyFromUser(entryAddr, (char *) &entry, sizeof(entry)) < 0)
+				break;
+			SysCallFunc func = BatchableSysCall(entry.type);
+			entry.result = (func != NULL) ? (*func)(entry.arg) : -1;
+			if(CopyToUser(entryAddr, (char *) &entry, sizeof(entry)) < 0)
+				break;
+			ring.head++;
+		}
+		CopyToUser(ringAddr, (char *) &ring.head, sizeof(ring.head));
+		stats->numSyscallsBatched += done;
+	}
+
+	machine->WriteRegister(2, done);
 	machine->PCForward();
-	printf("SYSCALL: write file %d byte\n", len);
 }
 
 #ifdef USER_PROGRAM
@@ -352,13 +695,14 @@ static void SysCallExecHandler()
 	int arg = machine->ReadRegister(4);
 
 	// Get the executable file name from user space.
-	FetchStrFromUserSpace(fname, MAX_FILENAME_LEN, arg);
+	OpenFile* executable = NULL;
+	if (CopyStrFromUser(arg, fname, MAX_FILENAME_LEN) >= 0) {
+		// copy executable file from Unix to Nachos
+		CopyExecFile(fname , fname);
 
-	// copy executable file from Unix to Nachos
-	CopyExecFile(fname , fname);
-
-    // Open the executable file.
-	OpenFile* executable = fileSystem->Open(fname);
+		// Open the executable file.
+		executable = fileSystem->Open(fname);
+	}
 	if (executable != NULL)
 	{
         // Set up a new thread and alloc address space for it.
@@ -367,6 +711,8 @@ static void SysCallExecHandler()
 					//which offH.code.size, noffH.initData.size, noffH.uninitData.size are all 0
 		space->AllocAddrSpace(userThread->getTid());
 		userThread->space = space;
+		// the new program starts with our open files
+		space->GetFdTable()->Inherit(currentThread->space->GetFdTable());
 
 		userThread->InitUserState();
 
@@ -388,6 +734,14 @@ static void SysCallExecHandler()
 static void SysCallForkHandler()
 {
 	int ufunc = machine->ReadRegister(4);
+#ifdef NETWORK
+	// the child shares our pages, so we need all of them here
+	if (migrator != NULL && !migrator->FetchAll(currentThread->space)) {
+		machine->WriteRegister(2, -1);
+		machine->PCForward();
+		return;
+	}
+#endif
 	Thread* userThread = Thread::getInstance("fork user thread");
 	AddrSpace* space = new AddrSpace(NULL); //?? TODO use default noff file,
 			//which offH.code.size, noffH.initData.size, noffH.uninitData.size are all 0
@@ -395,7 +749,7 @@ static void SysCallForkHandler()
 	userThread->space = space;
 
 	// Copy machine registers of current thread to new thread
-	userThread->SaveUserState();
+	userThread->CopyUserRegisters();
 	// Modify PC/SP register of new thread
 	userThread->WriteRegister(PCReg, ufunc);
 	userThread->WriteRegister(NextPCReg, ufunc+4);
@@ -405,6 +759,7 @@ static void SysCallForkHandler()
 	//userThread->Fork(ThreadFuncForUserProg, 0);
 	userThread->Fork(ThreadFuncForUserProg, 0);
 
+	machine->WriteRegister(2, 0);
 	machine->PCForward();
 }
 
@@ -445,3 +800,37 @@ static void SysCallJoinHandler()
 	machine->PCForward();
 }
 #endif
+
+static void SysCallSbrkHandler()
+{
+	int increment = machine->ReadRegister(4);
+	int oldBrk = currentThread->space->Sbrk(increment);
+
+	DEBUG('a', "Sbrk %d, old break 0x%x\n", increment, oldBrk);
+	machine->WriteRegister(2, oldBrk);
+	machine->PCForward();
+}
+
+static void SysCallMmapHandler()
+{
+	OpenFileId fid = machine->ReadRegister(4);
+	OpenFile* fp = currentThread->space->GetFdTable()->Get(fid);
+	int offset = machine->ReadRegister(5);
+	int length = machine->ReadRegister(6);
+
+	int addr = currentThread->space->Mmap(fp, offset, length);
+
+	printf("SYSCALL: mmap %d bytes at offset %d: 0x%x\n", length, offset, addr);
+	machine->WriteRegister(2, addr);
+	machine->PCForward();
+}
+
+static void SysCallMunmapHandler()
+{
+	int addr = machine->ReadRegister(4);
+	int result = currentThread->space->Munmap(addr);
+
+	printf("SYSCALL: munmap 0x%x: %d\n", addr, result);
+	machine->WriteRegister(2, result);
+	machine->PCForward();
+}
@@ -0,0 +1,113 @@
+// fdtable.cc
+//	Per-process table of open files, see fdtable.h.
+
+#include "copyright.h"
+#include "fdtable.h"
+#include "pipe.h"
+
+FdTable::FdTable()
+{
+	for (int fd = 0; fd < MaxOpenFiles; fd++)
+		table[fd] = NULL;
+}
+
+FdTable::~FdTable()
+{
+	CloseAll();
+}
+
+// Return the lowest free descriptor, now referring to "file"
+int
+FdTable::Add(OpenFile *file)
+{
+	if (file == NULL)
+		return -1;
+	for (int fd = FirstFileFd; fd < MaxOpenFiles; fd++)
+		if (table[fd] == NULL) {
+			table[fd] = new SharedFile;
+			table[fd]->file = file;
+			table[fd]->pipe = NULL;
+			table[fd]->pipeWriter = false;
+			table[fd]->refCount = 1;
+			return fd;
+		}
+	return -1;
+}
+
+// Return the lowest free descriptor, now referring to one end of "pipe";
+// the descriptor owns that end
+int
+FdTable::AddPipe(PipeBuffer *pipe, bool writing)
+{
+	for (int fd = FirstFileFd; fd < MaxOpenFiles; fd++)
+		if (table[fd] == NULL) {
+			table[fd] = new SharedFile;
+			table[fd]->file = NULL;
+			table[fd]->pipe = pipe;
+			table[fd]->pipeWriter = writing;
+			table[fd]->refCount = 1;
+			return fd;
+		}
+	return -1;
+}
+
+// Drop descriptor "fd"; the last one closes the file, or the pipe end
+bool
+FdTable::Close(int fd)
+{
+	if (!IsOpen(fd))
+		return false;
+	SharedFile *shared = table[fd];
+	table[fd] = NULL;
+	if (--shared->refCount == 0) {
+		if (shared->pipe != NULL)
+			shared->pipe->CloseEnd(shared->pipeWriter);
+		else
+			delete shared->file;
+		delete shared;
+	}
+	return true;
+}
+
+// Return the lowest free descriptor, or "newFd", now sharing the open
+// file of "fd"
+int
+FdTable::Dup(int fd, int newFd)
+{
+	if (!IsOpen(fd) || newFd >= MaxOpenFiles)
+		return -1;
+	if (newFd == fd)
+		return newFd;
+	if (newFd < 0) {
+		for (newFd = FirstFileFd; newFd < MaxOpenFiles; newFd++)
+			if (table[newFd] == NULL)
+				break;
+		if (newFd == MaxOpenFiles)
+			return -1;
+	} else {
+		Close(newFd);
+	}
+	table[newFd] = table[fd];
+	table[fd]->refCount++;
+	return newFd;
+}
+
+// Fork and Exec: the child gets the same descriptors as its parent
+void
+FdTable::Inherit(FdTable *parent)
+{
+	CloseAll();
+	for (int fd = 0; fd < MaxOpenFiles; fd++)
+		if (parent->table[fd] != NULL) {
+			table[fd] = parent->table[fd];
+			table[fd]->refCount++;
+		}
+}
+
+void
+FdTable::CloseAll()
+{
+	for (int fd = 0; fd < MaxOpenFiles; fd++)
+		if (table[fd] != NULL)
+			Close(fd);
+}
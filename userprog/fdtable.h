@@ -0,0 +1,73 @@
+// fdtable.h
+//	Per-process table of open files.  User programs name an open
+//	file by a small integer, its OpenFileId, which indexes the table;
+//	0 and 1 are ConsoleInput and ConsoleOutput, so files start at 2.
+//
+//	A table entry points to an open file shared by every descriptor
+//	Dup'ed from it, in this or in a child process (Fork and Exec
+//	inherit the table), so they all see one seek position.  The
+//	OpenFile is deleted when its last descriptor is closed.
+//
+//	An entry may be the read or the write end of a Pipe instead.
+//	Descriptors 0 and 1 are the console unless something else is
+//	Dup'ed onto them, e.g. a pipe for a process in a shell pipeline;
+//	closing them again gets the console back.
+
+#ifndef FDTABLE_H
+#define FDTABLE_H
+
+#include "copyright.h"
+#include "openfile.h"
+
+class PipeBuffer;
+
+#define MaxOpenFiles	16	// descriptors per process
+#define FirstFileFd	2	// after ConsoleInput and ConsoleOutput
+
+struct SharedFile {
+	OpenFile *file;		// NULL for a pipe
+	PipeBuffer *pipe;
+	bool pipeWriter;	// the write end of "pipe"
+	int refCount;		// descriptors referring to it, in all tables
+};
+
+class FdTable {
+  public:
+	FdTable();
+	~FdTable();			// close everything still open
+
+	int Add(OpenFile *file);	// lowest free descriptor for "file",
+					// -1 if the table is full
+	int AddPipe(PipeBuffer *pipe, bool writing);
+					// ... for one end of "pipe"
+	bool IsOpen(int fd)
+	{
+		return fd >= 0 && fd < MaxOpenFiles && table[fd] != NULL;
+	}
+	OpenFile *Get(int fd)		// NULL if "fd" is not an open file
+	{
+		return IsOpen(fd) ? table[fd]->file : NULL;
+	}
+	PipeBuffer *GetPipe(int fd, bool writing)
+					// NULL if "fd" is not that end of
+					// a pipe
+	{
+		if (!IsOpen(fd) || table[fd]->pipe == NULL
+				|| table[fd]->pipeWriter != writing)
+			return NULL;
+		return table[fd]->pipe;
+	}
+	bool Close(int fd);		// FALSE if "fd" is not open
+	int Dup(int fd, int newFd = -1);
+					// another descriptor for the same
+					// open file: the lowest free one, or
+					// "newFd" (closed first if need be);
+					// -1 on error
+	void Inherit(FdTable *parent);	// share all of "parent"'s files
+	void CloseAll();
+
+  private:
+	SharedFile *table[MaxOpenFiles];
+};
+
+#endif // FDTABLE_H
@@ -0,0 +1,109 @@
+// futex.cc
+//	Futex wait queues, see futex.h.
+
+#include "copyright.h"
+#include "futex.h"
+#include "system.h"
+#include "uprogUtility.h"
+
+struct FutexWaiter {
+    int key;			// physical address waited on
+    Thread *thread;
+};
+
+static List *futexQueues[FutexBuckets];
+static int numFutexPages = 0;	// pinned, see MaxFutexPages
+
+static List *
+FutexQueue(int key)
+{
+    int bucket = (key / sizeof(int)) % FutexBuckets;
+
+    if (futexQueues[bucket] == NULL)
+	futexQueues[bucket] = new List;
+    return futexQueues[bucket];
+}
+
+static int
+FutexKeyComp(void *target, void *data)
+{
+    return ((FutexWaiter *) target)->key == *(int *) data;
+}
+
+//----------------------------------------------------------------------
+// FutexKey
+// 	Set "*key" to the physical address of user word "addr", making
+//	its page a futex page of the current process first.  Return 0,
+//	or -1 if "addr" is bad or no futex page is left.
+//----------------------------------------------------------------------
+
+static int
+FutexKey(int addr, int *key)
+{
+    AddrSpace *space = currentThread->space;
+    int vpn = addr / PageSize;
+
+    if (addr < 0 || addr % sizeof(int) != 0)
+	return -1;
+    if (!space->IsFutexPage(vpn)) {
+	// a mapped page goes back to its file, a DSM page moves
+	if (numFutexPages >= MaxFutexPages || space->IsMappedPage(vpn)
+		|| space->IsDsmPage(vpn) || PinUserAddr(addr, key) < 0)
+	    return -1;
+	space->SetFutexPage(vpn);
+	numFutexPages++;
+    }
+    *key = space->getPTEPPN(vpn) * PageSize + addr % PageSize;
+    return 0;
+}
+
+void
+FutexPageFreed()
+{
+    ASSERT(numFutexPages > 0);
+    numFutexPages--;
+}
+
+int
+FutexWait(int addr, int expected)
+{
+    FutexWaiter waiter;
+    int key, result = -1;
+
+    if (FutexKey(addr, &key) < 0)
+	return -1;
+
+    // nobody can change the word or wake us between the check and
+    // going to sleep
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    int value = WordToHost(*(unsigned int *) &machine->mainMemory[key]);
+    if (value == expected) {
+	waiter.key = key;
+	waiter.thread = currentThread;
+	FutexQueue(key)->Append((void *) &waiter);
+	stats->numFutexWaits++;
+	currentThread->Sleep();
+	result = 0;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return result;
+}
+
+int
+FutexWake(int addr, int count)
+{
+    FutexWaiter *waiter;
+    int key, woken = 0;
+
+    if (FutexKey(addr, &key) < 0)
+	return -1;
+
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    while (woken < count && (waiter = (FutexWaiter *)
+	    FutexQueue(key)->RemoveByComp(FutexKeyComp, (void *) &key)) != NULL) {
+	scheduler->ReadyToRun(waiter->thread);
+	woken++;
+    }
+    (void) interrupt->SetLevel(oldLevel);
+    return woken;
+}
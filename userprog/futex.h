@@ -0,0 +1,35 @@
+// futex.h
+//	Futexes: wait queues for user programs, so that user level locks
+//	only trap into the kernel when there is contention.  A queue is
+//	named by the physical address of a word of user memory.
+//
+//	The first FutexWait or FutexWake on a page makes it a futex page
+//	of the process: it gets a private copy if it was shared
+//	copy-on-write, and is pinned, so the address stays the same.  A
+//	Fork shares futex pages writable instead of copy-on-write, so
+//	parent and child see each other's writes to the word and wait on
+//	the same queue.  A futex page stays pinned until the last process
+//	sharing it exits or gives it back (Sbrk), so at most MaxFutexPages
+//	of them exist at a time; past that FutexWait and FutexWake fail.
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "copyright.h"
+
+#define FutexBuckets	16	// hash chains of waiting threads
+#define MaxFutexPages	4	// pinned futex pages, of NumPhysPages
+
+// Sleep until a FutexWake on "addr", unless the word at "addr" is not
+// "expected" (anymore).  Return 0 if woken, -1 if the value differed
+// or "addr" is bad.
+extern int FutexWait(int addr, int expected);
+
+// Wake up to "count" threads waiting on "addr".  Return how many were
+// woken, -1 if "addr" is bad.
+extern int FutexWake(int addr, int count);
+
+// The last process sharing a futex page gave it back.
+extern void FutexPageFreed();
+
+#endif // FUTEX_H
@@ -79,9 +79,103 @@ MemManager::SetPhyMemPage(int phyNum, int tid, int virNum)
 		return false;
 	phyMemPageTable[phyNum].threadId = tid;
 	phyMemPageTable[phyNum].virtualPage = virNum;
+	phyMemPageTable[phyNum].refCount = 1;
+	ForgetExecPage(phyNum);		// reused, the old contents are going
 	return true;
 }
 
+void
+MemManager::Share(int phyNum)
+{
+	ASSERT(phyNum >= 0 && phyNum < pageTableEntryNum);
+	phyMemPageTable[phyNum].refCount++;
+}
+
+int
+MemManager::Unshare(int phyNum)
+{
+	ASSERT(phyNum >= 0 && phyNum < pageTableEntryNum);
+	if(phyMemPageTable[phyNum].refCount > 0)
+		phyMemPageTable[phyNum].refCount--;
+	return phyMemPageTable[phyNum].refCount;
+}
+
+int
+MemManager::RefCount(int phyNum)
+{
+	if(phyNum < 0 || phyNum >= pageTableEntryNum)
+		return 0;
+	return phyMemPageTable[phyNum].refCount;
+}
+
+// Keep phyNum in memory while a disk transfer reads or writes it
+// directly; the calling thread may block in the middle of the transfer.
+void
+MemManager::Pin(int phyNum)
+{
+	ASSERT(phyNum >= 0 && phyNum < pageTableEntryNum);
+	phyMemPageTable[phyNum].pinCount++;
+}
+
+void
+MemManager::Unpin(int phyNum)
+{
+	ASSERT(phyNum >= 0 && phyNum < pageTableEntryNum);
+	ASSERT(phyMemPageTable[phyNum].pinCount > 0);
+	phyMemPageTable[phyNum].pinCount--;
+}
+
+// Remember that phyNum holds image page "page" of the executable whose
+// file header is at "sector", as loaded from the file.
+void
+MemManager::SetExecPage(int phyNum, int sector, int page)
+{
+	ASSERT(phyNum >= 0 && phyNum < pageTableEntryNum);
+	phyMemPageTable[phyNum].execSector = sector;
+	phyMemPageTable[phyNum].execPage = page;
+}
+
+// Find the physical page caching image page "page" of executable
+// "sector" and take a reference to it for thread "tid".  A cached page
+// that was freed (its last process exited) is allocated again, with
+// its contents intact.  Return -1 if the page is not cached.
+int
+MemManager::ClaimExecPage(int sector, int page, int tid)
+{
+	for(int i = 0; i<pageTableEntryNum; i++) {
+		PhyMemPageEntry *entry = &phyMemPageTable[i];
+		if(entry->execSector != sector || entry->execPage != page)
+			continue;
+		if(bitmap->Test(i)) {
+			entry->refCount++;
+		} else {
+			bitmap->Mark(i);
+			entry->threadId = tid;
+			entry->virtualPage = page;
+			entry->refCount = 1;
+		}
+		return i;
+	}
+	return -1;
+}
+
+void
+MemManager::ForgetExecPage(int phyNum)
+{
+	if(phyNum < 0 || phyNum >= pageTableEntryNum)
+		return;
+	phyMemPageTable[phyNum].execSector = -1;
+	phyMemPageTable[phyNum].execPage = -1;
+}
+
+void
+MemManager::ForgetExecFile(int sector)
+{
+	for(int i = 0; i<pageTableEntryNum; i++)
+		if(phyMemPageTable[i].execSector == sector)
+			ForgetExecPage(i);
+}
+
 bool
 MemManager::UpdateLastUsedTime(int phyNum, int lut)
 {
@@ -124,22 +218,26 @@ MemManager::GetPhyPageNum(int tid, int virNum)
 
 /*
  * Function: 	find a physical page to swap from memory to "disk", based on LRU
- * return:		physical page number
+ * return:		physical page number, -1 if every page is pinned
  * */
 int
 MemManager::FindSwapPage(bool* unused)
 {
-	int idx = 0;
-	int min = phyMemPageTable[0].lastUsedTime;
+	int idx = -1;
+	int min = 0;
 	for(int i = 0; i<pageTableEntryNum; i++)
 	{
-		if(phyMemPageTable[i].lastUsedTime < min)
+		if(phyMemPageTable[i].pinCount > 0)
+			continue;
+		if(idx < 0 || phyMemPageTable[i].lastUsedTime < min)
 		{
 			idx = i;
 			min = phyMemPageTable[i].lastUsedTime;
 		}
 	}
 
+	if(idx < 0)
+		return -1;
 	*unused = !bitmap->Test(idx);
 
 	return idx;
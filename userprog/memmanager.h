@@ -12,12 +12,23 @@ struct PhyMemPageEntry {
 	int threadId;		// thread id
 	int virtualPage;	// virtual page number
 	int lastUsedTime;	// for swap in/out
-	PhyMemPageEntry(): threadId(-1),virtualPage(-1), lastUsedTime(0) {}
+	int refCount;		// page tables mapping this page, more than one
+						// after a copy-on-write Fork
+	int execSector;		// executable page cache: the page holds the
+	int execPage;		// unmodified image page "execPage" of the
+						// executable with header "execSector", or -1.
+						// Survives freeing the page, until it is reused
+	int pinCount;		// I/O in progress on the page, it must not be
+						// swapped out
+	PhyMemPageEntry(): threadId(-1),virtualPage(-1), lastUsedTime(0), refCount(0),
+						execSector(-1), execPage(-1), pinCount(0) {}
 	void ZeroPhyMemPageEntry()
 	{
 		threadId = -1;
 		virtualPage = -1;
 		lastUsedTime = 0;
+		refCount = 0;
+		pinCount = 0;
 	}
 };
 
@@ -44,7 +55,24 @@ class MemManager {
     int GetVirPageNum(int phyNum);
     int GetPhyPageNum(int tid, int virNum);
 
-    int FindSwapPage(bool* unused);	// LRU
+    // copy-on-write sharing
+    void Share(int phyNum);		// one more page table maps phyNum
+    int Unshare(int phyNum);	// one less, return how many are left
+    int RefCount(int phyNum);
+
+    // executable page cache, pages are shared copy-on-write
+    void SetExecPage(int phyNum, int sector, int page);
+    int ClaimExecPage(int sector, int page, int tid);	// find a cached page
+    						// and take a reference, -1 if none
+    void ForgetExecPage(int phyNum);	// the page is about to be modified
+    void ForgetExecFile(int sector);	// the file was written or
+    						// removed
+
+    // pinned pages are skipped by FindSwapPage
+    void Pin(int phyNum);
+    void Unpin(int phyNum);
+
+    int FindSwapPage(bool* unused);	// LRU, -1 if every page is pinned
 
     bool ZeroPhyMemPage(int phyNum);
 
@@ -0,0 +1,72 @@
+// printbuf.cc
+//	Buffered Print/PrintInt output, see printbuf.h.
+
+#include "copyright.h"
+#include "printbuf.h"
+#include "system.h"
+#include "console.h"
+#include "uprogUtility.h"
+
+//----------------------------------------------------------------------
+// PrintBuffer::PrintUser
+// 	Append the user string, a page at a time.  Each piece is copied
+//	into the buffer where it will be written from, and is looked at
+//	for the '\0' there.  Room is made before the page is fetched, so
+//	nothing can block between the fetch and the copy.
+//----------------------------------------------------------------------
+
+int
+PrintBuffer::PrintUser(int addr, int size)
+{
+    int done, n;
+
+    if (addr < 0 || size < 0)
+	return UserBadAddress;
+    for (done = 0; done < size; ) {
+	int chunk = min(PageSize - (addr + done) % PageSize, size - done);
+	if (len + chunk > PrintBufferSize)
+	    Flush();
+	if ((n = CopyFromUser(addr + done, buf + len, chunk)) < 0)
+	    return n;
+	char *end = (char *) memchr(buf + len, '\0', chunk);
+	if (end != NULL)
+	    chunk = end - (buf + len);
+	len += chunk;
+	done += chunk;
+	if (end != NULL)
+	    break;
+    }
+    Append("\n", 1);
+    return done;
+}
+
+void
+PrintBuffer::PrintInt(int number)
+{
+    char text[16];
+
+    sprintf(text, "%d\n", number);
+    Append(text, strlen(text));
+}
+
+void
+PrintBuffer::Append(char *data, int numBytes)
+{
+    while (numBytes > 0) {
+	if (len == PrintBufferSize)
+	    Flush();
+	int n = min(numBytes, PrintBufferSize - len);
+	memcpy(buf + len, data, n);
+	len += n;
+	data += n;
+	numBytes -= n;
+    }
+}
+
+void
+PrintBuffer::Flush()
+{
+    if (len > 0)
+	synchConsole->Write(buf, len);
+    len = 0;
+}
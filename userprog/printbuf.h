@@ -0,0 +1,33 @@
+// printbuf.h
+//	Per-process buffer for the output of Print and PrintInt.  The
+//	strings are copied straight from the user pages into the buffer,
+//	and the buffer goes to the console in one Write when it fills up,
+//	when the process reads the console or exits, and at Halt.  So a
+//	program that prints a lot costs a console write per buffer-full,
+//	not a printf per call.
+
+#ifndef PRINTBUF_H
+#define PRINTBUF_H
+
+#include "copyright.h"
+
+#define PrintBufferSize	256
+
+class PrintBuffer {
+  public:
+    PrintBuffer() { len = 0; }
+
+    int PrintUser(int addr, int size);	// the string at user address
+					// "addr", at most "size" bytes up to
+					// its '\0', and a newline; return its
+					// length or a CopyFromUser error
+    void PrintInt(int number);		// "number" and a newline
+    void Append(char *data, int numBytes);
+    void Flush();			// all of it to the console
+
+  private:
+    char buf[PrintBufferSize];
+    int len;				// bytes in "buf"
+};
+
+#endif // PRINTBUF_H
@@ -74,13 +74,32 @@ StartProcess(char *filename)
 					// by doing the syscall "exit"
 }
 
+//----------------------------------------------------------------------
+// ContextSwitchTest
+// 	Run two user programs (e.g. /multi_proc1 and /multi_proc2) side
+//	by side.  With -rs the timer preempts them, and the statistics
+//	printed at halt give the number of context switches per simulated
+//	second and the bookkeeping done for them.  Run once more with
+//	-eager to get the numbers for the old switch path.
+//----------------------------------------------------------------------
+
+void
+ContextSwitchTest(char *file1, char *file2)
+{
+    if (timer == NULL)
+	printf("ContextSwitchTest: no timer, use -rs to preempt programs\n");
+    printf("ContextSwitchTest: %s and %s, %s switch\n", file1, file2,
+	machine->UseEagerSwitch() ? "eager" : "lazy");
+    StartProcess(file1);
+    StartProcess(file2);
+}
+
 // Data structures needed for the console test.  Threads making
 // I/O requests wait on a Semaphore to delay until the I/O completes.
 
 //static Console *console;
 //static Semaphore *readAvail;
 //static Semaphore *writeDone;
-static SynchConsole * synchConsole;
 
 //----------------------------------------------------------------------
 // ConsoleInterruptHandlers
@@ -101,6 +120,7 @@ ConsoleTest (char *in, char *out)
 {
     char ch;
 
+    delete synchConsole;		// the one on stdin/stdout
     synchConsole = new SynchConsole(in, out);
     //console = new Console(in, out, ReadAvail, WriteDone, 0);
     //readAvail = new Semaphore("read avail", 0);
@@ -31,6 +31,21 @@
 #define SC_Yield	10
 #define SC_Print	11
 #define SC_PrintInt 12
+#define SC_Sbrk		13
+#define SC_Mmap		14
+#define SC_Munmap	15
+#define SC_Readv	16
+#define SC_Writev	17
+#define SC_Submit	18
+#define SC_AioRead	19
+#define SC_AioWrite	20
+#define SC_AioWait	21
+#define SC_FutexWait	22
+#define SC_FutexWake	23
+#define SC_Pipe		24
+#define SC_Dup		25
+#define SC_DsmAttach	26
+#define SC_Migrate	27
 
 #ifndef IN_ASM
 
@@ -76,7 +91,10 @@ int Join(SpaceId id);
  * will work for the purposes of testing out these routines.
  */
  
-/* A unique identifier for an open Nachos file. */
+/* A unique identifier for an open Nachos file: a small integer, valid in
+ * the process that opened it.  Children created by Fork or Exec inherit
+ * the open files of their parent, sharing the seek position.
+ */
 typedef int OpenFileId;	
 
 /* when an address space starts up, it has two open files, representing 
@@ -92,7 +110,7 @@ typedef int OpenFileId;
 void Create(char *name);
 
 /* Open the Nachos file "name", and return an "OpenFileId" that can 
- * be used to read and write to the file.
+ * be used to read and write to the file; -1 on error.
  */
 OpenFileId Open(char *name);
 
@@ -119,6 +137,90 @@ int Read(char *buffer, int size, OpenFileId id, int position);
 /* Close the file, we're done reading and writing to it. */
 void Close(OpenFileId id);
 
+/* Pipes, kept in kernel memory.  Pipe puts a read end in fds[0] and a
+ * write end in fds[1] and returns 0, or -1.  With a "name", processes
+ * that are not related get the same pipe; with name 0 it is a new,
+ * anonymous pipe.  Read on the read end waits for data and returns 0
+ * once every write end is closed; Write on the write end waits for
+ * room, and returns -1 once every read end is closed.  The position
+ * argument of Read/Write is ignored.
+ *
+ * Dup makes "newId" refer to the open file or pipe end of "id", closing
+ * whatever "newId" was first, and returns it; with newId -1 it uses the
+ * lowest free OpenFileId.  Returns -1 on error.  Exec'ed programs inherit
+ * the OpenFileIds, so a shell makes a pipeline with Dup(fds[1],
+ * ConsoleOutput) before one Exec and Dup(fds[0], ConsoleInput) before
+ * the next; closing ConsoleInput/ConsoleOutput gives back the console.
+ */
+int Pipe(OpenFileId *fds, char *name);
+OpenFileId Dup(OpenFileId id, OpenFileId newId);
+
+/* Vectored I/O: Readv/Writev move the "count" buffers of "iov", at
+ * most MaxUserIoVecs, in order, as a single Read/Write would move one
+ * buffer holding all of them.  Return the number of bytes moved.
+ */
+#define MaxUserIoVecs	16
+
+typedef struct {
+	char *buffer;
+	int size;
+} IoVecU;
+
+int Readv(IoVecU *iov, int count, OpenFileId id, int position);
+int Writev(IoVecU *iov, int count, OpenFileId id, int position);
+
+/* Batched system calls.  The program queues calls in a ring of
+ * "size" entries: it fills in entries[tail % size] and increments
+ * "tail".  Submit runs every queued call, from "head" up to "tail",
+ * with a single trap into the kernel; each entry gets its "result"
+ * and "head" moves past it.  "arg" holds what the call takes as
+ * arguments, in order.  Create, Open, Close, Read, Write, Readv,
+ * Writev, Print and PrintInt may be queued; anything else gets -1.
+ * "head" and "tail" count up from 0.  Return the number of entries
+ * run, -1 if the ring is bad.
+ */
+typedef struct {
+	int type;		/* SC_Read, SC_Write, ... */
+	int arg[4];
+	int result;		/* filled in by Submit */
+} SyscallEntryU;
+
+typedef struct {
+	int head;		/* next entry Submit will run */
+	int tail;		/* next free entry */
+	int size;
+	SyscallEntryU *entries;
+} SyscallRingU;
+
+int Submit(SyscallRingU *ring);
+
+/* Asynchronous I/O.  AioRead/AioWrite start moving "size" bytes
+ * between "buffer" and the open file "id" at byte "position" (an
+ * offset, the seek position of "id" is neither used nor moved), and
+ * return at once with a request id, or -1.  The program may compute
+ * meanwhile.  AioWait(request) blocks until the transfer is done and
+ * returns the number of bytes moved, or -1.  The data of an AioRead is
+ * in "buffer" once AioWait returns; the "buffer" of an AioWrite may be
+ * reused as soon as AioWrite returns.  At most 8 requests per process
+ * may be waiting for their AioWait, and a request moves at most 4096
+ * bytes; a larger "size" gets -1.
+ */
+int AioRead(char *buffer, int size, OpenFileId id, int position);
+int AioWrite(char *buffer, int size, OpenFileId id, int position);
+int AioWait(int request);
+
+/* Futexes, to build locks that only trap into the kernel when they
+ * are contended.  FutexWait sleeps until a FutexWake on "addr", unless
+ * the word at "addr" no longer holds "expected"; it returns 0 if woken,
+ * -1 otherwise.  FutexWake wakes up to "count" threads sleeping on
+ * "addr" and returns how many.  The page of "addr" is shared writable
+ * with processes Forked afterwards, so a lock word in it works between
+ * them.  Such pages stay in memory; at most 4 exist at a time, past
+ * that both calls return -1.
+ */
+int FutexWait(int *addr, int expected);
+int FutexWake(int *addr, int count);
+
 
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
@@ -126,21 +228,62 @@ void Close(OpenFileId id);
  */
 
 /* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+ * as the current thread.  Return 0, or -1 if there is no memory for the
+ * pages a migrated process still has to fetch first.
  */
-void Fork(void (*func)());
+int Fork(void (*func)());
 
 /* Yield the CPU to another runnable thread, whether in this address space 
  * or not. 
  */
 void Yield();		
 
-/*
- * Print
+/* Print the string "msg" (at most "size" bytes, up to its '\0') and a
+ * newline, PrintInt a number and a newline, on the console.  The output
+ * is buffered per process: it shows up when the buffer fills, when the
+ * process reads or writes the console or exits, and at Halt.
  */
 void Print(char* msg, int size);
 void PrintInt(int number);
 
+/* Grow the heap, which starts right after the program's data, by
+ * "increment" bytes (shrink it if negative) and return the start of the
+ * new memory, i.e. the old end of the heap; -1 if the heap would run
+ * into the stack.  New heap pages read as zero.
+ */
+int Sbrk(int increment);
+
+/* Map "length" bytes of the open file "id", from byte "offset" on, into
+ * the address space, and return where; -1 on error.  The file is read
+ * as the pages are touched, and what the program writes there goes back
+ * to the file when the pages are evicted, at Munmap, or at Exit.  The
+ * mapping outlives Close(id), and is not inherited by Fork.
+ */
+char *Mmap(OpenFileId id, int offset, int length);
+
+/* Unmap the region Mmap returned "addr" for, writing it back.
+ * Return 0, or -1 if "addr" is not such a region.
+ */
+int Munmap(char *addr);
+
+/* Attach the distributed shared memory region (nachos -dsm) and return
+ * its address; -1 if there is none, another process on this machine
+ * has it, or an Mmap region is in the way.  "*node" is set to this
+ * machine's number and "*numNodes" to the number of machines sharing
+ * the region.  Its MaxDsmPages pages start out zero; what one machine
+ * writes, the others read.  Writes are coherent per page, but there
+ * is no locking across machines.
+ */
+char *DsmAttach(int *node, int *numNodes);
+
+/* Move this process to machine "node" (nachos -mg) and go on running
+ * there, Migrate returning 0; its memory comes along, but not its
+ * open files.  A Join on it still works on the machine it came from.
+ * Return -1, staying here, if it can't move: e.g. it has a Mmap region
+ * or the DSM region.
+ */
+int Migrate(int node);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
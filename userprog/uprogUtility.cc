@@ -3,9 +3,36 @@
 #define TransferSize 100
 #define MAX_PATH_LEN 256
 
+//----------------------------------------------------------------------
+// SameContents
+// 	Is the Nachos file "file" byte for byte the "length" bytes of the
+//	UNIX file "fp"?
+//----------------------------------------------------------------------
+
+static bool
+SameContents(FILE *fp, OpenFile *file, int length)
+{
+    char unixBuf[TransferSize], nachosBuf[TransferSize];
+
+    for (int done = 0; done < length; ) {
+	int n = min(TransferSize, length - done);
+	if ((int) fread(unixBuf, sizeof(char), n, fp) != n
+		|| file->ReadAt(nachosBuf, n, done) != n
+		|| memcmp(unixBuf, nachosBuf, n) != 0)
+	    return false;
+	done += n;
+    }
+    return true;
+}
+
 //----------------------------------------------------------------------
 // CopyExecFile
 // 	Copy the contents of the UNIX file "from" to the Nachos file "to"
+//
+//	Nothing is copied if "to" is already there with the same contents,
+//	which is the case for every Exec of a program but the first.  A
+//	copy that differs (the program was rebuilt) is stale: it is
+//	removed, and its pages are dropped from the executable page cache.
 //----------------------------------------------------------------------
 
 void
@@ -22,6 +49,31 @@ CopyExecFile(char *from, char *to)
     int amountRead, fileLength;
     char *buffer;
 
+// Already copied?
+    struct stat unixStat;
+    if (stat(realPath, &unixStat) != 0) {
+	printf("Copy: couldn't open input file %s\n", realPath);
+	return;
+    }
+    openFile = fileSystem->Open(to);
+    if (openFile != NULL) {
+	int oldSector = openFile->GetHdrSector();
+	bool same = false;
+
+	if (openFile->Length() == unixStat.st_size
+		&& (fp = fopen(realPath, "r")) != NULL) {
+	    same = SameContents(fp, openFile, unixStat.st_size);
+	    fclose(fp);
+	}
+	delete openFile;
+	if (same) {
+	    DEBUG('f', "File %s already copied\n", to);
+	    return;
+	}
+	memManager->ForgetExecFile(oldSector);
+	fileSystem->Remove(to);
+    }
+
 // Open UNIX file
     if ((fp = fopen(realPath, "r")) == NULL) {
 	printf("Copy: couldn't open input file %s\n", realPath);
@@ -54,3 +106,237 @@ CopyExecFile(char *from, char *to)
     delete openFile;
     fclose(fp);
 }
+
+//----------------------------------------------------------------------
+// UserPage
+// 	Return where virtual page "vpn" of the current address space is
+//	in mainMemory, bringing it in first if it is not there.  If
+//	"writing", a copy-on-write page gets its private copy, and the
+//	page is marked dirty.  Return NULL and set "*error" if vpn is not
+//	part of the address space, or it cannot be brought in.
+//----------------------------------------------------------------------
+
+static char *
+UserPage(int vpn, bool writing, int *error)
+{
+    AddrSpace *space = currentThread->space;
+    TranslationEntry *pte;
+
+    if (!space->IsLegalPage(vpn)) {
+	*error = UserBadAddress;
+	return NULL;
+    }
+    pte = space->GetPTE(vpn);
+    if (pte == NULL || !pte->valid) {
+	if (machine->SwapPage(vpn * PageSize) < 0) {
+	    *error = UserNoMemory;
+	    return NULL;
+	}
+	pte = space->GetPTE(vpn);
+    }
+    if (writing) {
+	if (pte->readOnly && !space->CopyOnWrite(vpn)) {
+	    *error = UserNoMemory;
+	    return NULL;
+	}
+	// a cached TLB entry would write its clean dirty bit back over ours
+	machine->FlushTLBPage(space->GetASID(), vpn);
+	pte->dirty = TRUE;
+    }
+    pte->use = TRUE;
+    pte->lastUseTime = stats->totalTicks;
+    return &machine->mainMemory[pte->physicalPage * PageSize];
+}
+
+//----------------------------------------------------------------------
+// PinUserAddr
+// 	Bring in and pin the page of user address "addr", so that it stays
+//	at physical address "*physAddr" until unpinned.  A copy-on-write
+//	page gets its private copy first.
+//----------------------------------------------------------------------
+
+int
+PinUserAddr(int addr, int *physAddr)
+{
+    int error;
+
+    if (addr < 0)
+	return UserBadAddress;
+    char *page = UserPage(addr / PageSize, TRUE, &error);
+    if (page == NULL)
+	return error;
+    *physAddr = page - machine->mainMemory + addr % PageSize;
+    memManager->Pin(*physAddr / PageSize);
+    return 0;
+}
+
+//----------------------------------------------------------------------
+// CopyUser
+// 	Copy "size" bytes between user address "addr" and "buf", in
+//	chunks that do not cross a page.  The whole range is checked
+//	first, so a bad buffer fails before anything is copied.
+//----------------------------------------------------------------------
+
+static int
+CopyUser(int addr, char *buf, int size, bool toUser)
+{
+    int done, error;
+
+    if (addr < 0 || size < 0 || addr + size < addr)
+	return UserBadAddress;
+    for (int vpn = addr / PageSize; vpn < divRoundUp(addr + size, PageSize); vpn++)
+	if (!currentThread->space->IsLegalPage(vpn))
+	    return UserBadAddress;
+
+    for (done = 0; done < size; ) {
+	int offset = (addr + done) % PageSize;
+	int chunk = min(PageSize - offset, size - done);
+	char *page = UserPage((addr + done) / PageSize, toUser, &error);
+	if (page == NULL)
+	    return error;
+	if (toUser)
+	    memcpy(page + offset, buf + done, chunk);
+	else
+	    memcpy(buf + done, page + offset, chunk);
+	done += chunk;
+    }
+    return done;
+}
+
+int
+CopyFromUser(int addr, char *buf, int size)
+{
+    return CopyUser(addr, buf, size, FALSE);
+}
+
+int
+CopyToUser(int addr, char *buf, int size)
+{
+    return CopyUser(addr, buf, size, TRUE);
+}
+
+//----------------------------------------------------------------------
+// CopyStrFromUser
+// 	Copy the '\0' terminated string at user address "addr" into
+//	"buf", which holds "size" bytes, a page at a time.  The string
+//	may end anywhere, so pages are only checked as they are reached.
+//----------------------------------------------------------------------
+
+int
+CopyStrFromUser(int addr, char *buf, int size)
+{
+    int done, error;
+
+    if (size <= 0)
+	return UserStrTooLong;
+    buf[0] = '\0';
+    if (addr < 0)
+	return UserBadAddress;
+
+    for (done = 0; done < size; ) {
+	int offset = (addr + done) % PageSize;
+	int chunk = min(PageSize - offset, size - done);
+	char *page = UserPage((addr + done) / PageSize, FALSE, &error);
+	if (page == NULL) {
+	    buf[done] = '\0';
+	    return error;
+	}
+	char *end = (char *) memchr(page + offset, '\0', chunk);
+	if (end != NULL) {
+	    memcpy(buf + done, page + offset, end - (page + offset) + 1);
+	    return done + (end - (page + offset));
+	}
+	memcpy(buf + done, page + offset, chunk);
+	done += chunk;
+    }
+    buf[size - 1] = '\0';
+    return UserStrTooLong;
+}
+
+//----------------------------------------------------------------------
+// FileUser
+// 	Transfer between the open file "fp" and the "count" user buffers
+//	"bufs", in order, without a kernel buffer: the disk reads and
+//	writes the user pages in mainMemory directly.  The user pages are
+//	brought in and pinned, at most MaxPinnedPages at a time, so that
+//	they cannot be swapped out while the disk transfer blocks.  The
+//	first batch starts at "position" (as for OpenFile::Read), the
+//	following ones where the previous left off.
+//
+//	Return the number of bytes transferred, or one of the errors
+//	above if nothing was.
+//----------------------------------------------------------------------
+
+#define MaxPinnedPages	8	// leave most of the memory to the others
+
+static int
+FileUser(OpenFile *fp, UserBuf *bufs, int count, int position, bool toUser)
+{
+    IoVec iov[MaxPinnedPages];
+    int pinned[MaxPinnedPages];
+    int done = 0, error = 0;
+    int b = 0, bOff = 0;		// where the next batch starts
+
+    for (int i = 0; i < count; i++) {
+	int addr = bufs[i].addr, size = bufs[i].size;
+	if (addr < 0 || size < 0 || addr + size < addr)
+	    return UserBadAddress;
+	for (int vpn = addr / PageSize; vpn < divRoundUp(addr + size, PageSize); vpn++)
+	    if (!currentThread->space->IsLegalPage(vpn))
+		return UserBadAddress;
+    }
+
+    while (b < count) {
+	int n = 0, bytes = 0, result;
+
+	// pin the pages of the next batch
+	while (n < MaxPinnedPages && b < count) {
+	    if (bOff == bufs[b].size) {
+		b++;
+		bOff = 0;
+		continue;
+	    }
+	    int addr = bufs[b].addr + bOff;
+	    int chunk = min(PageSize - addr % PageSize, bufs[b].size - bOff);
+	    char *page = UserPage(addr / PageSize, toUser, &error);
+	    if (page == NULL)
+		break;
+	    pinned[n] = (page - machine->mainMemory) / PageSize;
+	    memManager->Pin(pinned[n]);
+	    iov[n].base = page + addr % PageSize;
+	    iov[n].len = chunk;
+	    n++;
+	    bytes += chunk;
+	    bOff += chunk;
+	}
+	if (n == 0)
+	    break;
+
+	if (toUser)
+	    result = fp->ReadV(iov, n, position);
+	else
+	    result = fp->WriteV(iov, n, position);
+	position = SEEK_POS_CUR;
+
+	while (n > 0)
+	    memManager->Unpin(pinned[--n]);
+	if (result < 0)
+	    return (done == 0) ? result : done;
+	done += result;
+	if (result < bytes || error != 0)
+	    break;		// end of file, or a page we could not get
+    }
+    return (done == 0 && error != 0) ? error : done;
+}
+
+int
+ReadFileToUserV(OpenFile *fp, UserBuf *bufs, int count, int position)
+{
+    return FileUser(fp, bufs, count, position, TRUE);
+}
+
+int
+WriteFileFromUserV(OpenFile *fp, UserBuf *bufs, int count, int position)
+{
+    return FileUser(fp, bufs, count, position, FALSE);
+}
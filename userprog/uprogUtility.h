@@ -3,6 +3,39 @@
 #include "filesys.h"
 #include "system.h"
 #include <unistd.h>
+#include <sys/stat.h>
 #include <string.h>
 
 extern void CopyExecFile(char *from, char *to);
+
+// Copying syscall arguments between the kernel and the address space
+// of the current thread.  Memory is copied a page at a time, straight
+// to and from mainMemory; missing pages are faulted in as needed.
+// They return the number of bytes copied (for strings, the length
+// without the '\0'), or one of these errors:
+
+#define UserBadAddress	-1	// not part of the address space
+#define UserNoMemory	-2	// a page could not be brought into memory
+#define UserStrTooLong	-3	// no '\0' within the buffer
+
+extern int CopyFromUser(int addr, char *buf, int size);
+extern int CopyToUser(int addr, char *buf, int size);
+extern int CopyStrFromUser(int addr, char *buf, int size);
+					// "buf" is always '\0' terminated
+
+// Read/Write syscalls: like OpenFile::Read/Write, but the disk transfers
+// straight to and from the user pages.  The user buffers "bufs" are
+// filled/drained in order, as if they were one.
+
+struct UserBuf {
+    int addr;			// user address
+    int size;
+};
+
+// Keep the page of user address "addr" in memory, e.g. a futex page,
+// breaking copy-on-write first; "*physAddr" is where "addr" is in
+// mainMemory.  Return 0 or an error.
+extern int PinUserAddr(int addr, int *physAddr);
+
+extern int ReadFileToUserV(OpenFile *fp, UserBuf *bufs, int count, int position);
+extern int WriteFileFromUserV(OpenFile *fp, UserBuf *bufs, int count, int position);
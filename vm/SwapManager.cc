@@ -10,6 +10,9 @@
 SwapManager::SwapManager()
 {
 	swappingSpaceMap = new BitMap(MAX_SWAP_SPACE);
+	refCount = new int[MAX_SWAP_SPACE];
+	for(int i = 0; i < MAX_SWAP_SPACE; i++)
+		refCount[i] = 0;
 
 	fileSystem->Create(SWAP_SPACE_NAME, MAX_SWAP_SPACE * PageSize);
 	swappingFile = fileSystem->Open(SWAP_SPACE_NAME);
@@ -18,6 +21,7 @@ SwapManager::SwapManager()
 SwapManager::~SwapManager()
 {
 	delete swappingSpaceMap;
+	delete[] refCount;
 	fileSystem->Remove(SWAP_SPACE_NAME);
 }
 
@@ -29,20 +33,26 @@ SwapManager::~SwapManager()
  * */
 int
 SwapManager::swapIntoDisk(int physicalPage)
+{
+	return WritePage(&(machine->mainMemory[physicalPage * PageSize]));
+}
+
+/*
+ * Function:		write the page at "from" into a free page of "disk",
+ * 					for a page that isn't in main memory (a process
+ * 					migrating here brings its pages along)
+ * return:			the page number in "disk", or -1 if it is full
+ * */
+int
+SwapManager::WritePage(char *from)
 {
 	int swappingPage;
-	int phyMemPosition;
-	int swappingPosition;
 
 	if (swappingSpaceMap->NumClear() != 0)
 	{
 		swappingPage = swappingSpaceMap->Find();
-		phyMemPosition = physicalPage * PageSize;
-		swappingPosition = swappingPage * PageSize;
-
-		swappingFile->WriteAt(&(machine->mainMemory[phyMemPosition]),
-								PageSize,
-								swappingPosition);
+		refCount[swappingPage] = 1;
+		swappingFile->WriteAt(from, PageSize, swappingPage * PageSize);
 	}
 	else
 	{
@@ -53,6 +63,17 @@ SwapManager::swapIntoDisk(int physicalPage)
 	return swappingPage;
 }
 
+/*
+ * Function:		read a copy of page "swappingPage" of "disk" into
+ * 					"into", keeping the page
+ * */
+void
+SwapManager::ReadPage(int swappingPage, char *into)
+{
+	ASSERT(swappingSpaceMap->Test(swappingPage));
+	swappingFile->ReadAt(into, PageSize, swappingPage * PageSize);
+}
+
 /*
  * Function: 		swap page from "disk" to memory
  * physicalPage: 	physical page number in memory
@@ -73,10 +94,9 @@ SwapManager::swapOutFromDisk(int physicalPage, int swappingPage, bool copy)
 							 swappingPosition);
 
 		if(!copy) {
-			// AddrSpace::CopyMemFromParent
-			// just copy from Swapping for child phyPage
-			// remain the Swapping for parent phyPage
-			swappingSpaceMap->Clear(swappingPage);
+			// the caller's PTE no longer refers to the swap page,
+			// other PTEs sharing it after a Fork still do
+			Clear(swappingPage);
 		}
 	}
 	else
@@ -85,34 +105,26 @@ SwapManager::swapOutFromDisk(int physicalPage, int swappingPage, bool copy)
 	}
 }
 
-int
-SwapManager::copySwapping(int copyPage)
+/*
+ * Function:		a copy-on-write Fork shares swap page "which" with
+ * 					the child instead of copying it
+ * */
+void
+SwapManager::Share(int which)
 {
-	int writePage;
-	char buf[PageSize];
-	int copyPosition; // orig copy
-	int writePosition;// final copy save
-
-	if (swappingSpaceMap->NumClear() != 0)
-	{
-		writePage = swappingSpaceMap->Find();
-		copyPosition = copyPage * PageSize;
-		writePosition = writePage * PageSize;
-
-		swappingFile->ReadAt(buf, PageSize, copyPosition);
-		swappingFile->WriteAt(buf, PageSize, writePosition);
-	}
-	else
-	{
-		printf("copy Swap Failed!\n");
-		writePage = -1;
-	}
-
-	return writePage;
+	ASSERT(swappingSpaceMap->Test(which));
+	refCount[which]++;
 }
 
+/*
+ * Function:		drop one reference to swap page "which", the page is
+ * 					free again once no PTE refers to it
+ * */
 void
 SwapManager::Clear(int which)
 {
+	if(refCount[which] > 0 && --refCount[which] > 0)
+		return;
+	refCount[which] = 0;
 	swappingSpaceMap->Clear(which);
 }
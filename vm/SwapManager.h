@@ -14,12 +14,15 @@ class SwapManager
 
 		int swapIntoDisk(int physicalPage);
 		void swapOutFromDisk(int physicalPage, int swappingPage, bool copy = false);
-		int copySwapping(int copyPage);
+		int WritePage(char *from);	// a page from outside main memory
+		void ReadPage(int swappingPage, char *into);	// a copy of it
 
-		void Clear(int which);
+		void Share(int which);		// one more PTE refers to swap page "which"
+		void Clear(int which);		// one PTE less, free it at the last one
 
 	private:
 		BitMap* swappingSpaceMap;
+		int* refCount;				// PTEs sharing each swap page
 		OpenFile* swappingFile;
 };
 